@@ -0,0 +1,107 @@
+#ifndef SEQLOCK_H
+# define SEQLOCK_H
+
+/***********************************************************************
+ * 
+ * Sequence lock for data shared between ISR and main loop.
+ * 
+ * ATmega328P (Arduino Uno), 16 MHz, PlatformIO
+ *
+ * This work is licensed under the terms of the MIT license.
+ *
+ **********************************************************************/
+
+/**
+ * @file 
+ * @defgroup seqlock Sequence Lock <seqlock.h>
+ * @code #include <seqlock.h> @endcode
+ *
+ * @brief Tear-free reading of multi-byte data written by an interrupt.
+ *
+ * The writer (an interrupt service routine) increments the counter
+ * before and after it changes the data, so the counter is odd while an
+ * update is in progress. The reader copies the data without disabling
+ * interrupts and repeats the copy if the counter changed meanwhile:
+ *
+ * @code
+ * uint8_t s;
+ * do {
+ *     s = seqlock_read_begin(&lock);
+ *     copy = shared;
+ * } while (seqlock_read_retry(&lock, s));
+ * @endcode
+ *
+ * @note The writer must not be interrupted by the reader, i.e. write from
+ *       an ISR and read from the main loop. No source file is needed.
+ * @{
+ */
+
+
+/* Includes ----------------------------------------------------------*/
+#include <stdint.h>
+
+
+/* Defines -----------------------------------------------------------*/
+/** @brief Compiler barrier, memory accesses are not moved across it */
+#define SEQLOCK_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+
+/* Types -------------------------------------------------------------*/
+/** @brief Sequence counter, odd while the data is being written */
+typedef volatile uint8_t seqlock_t;
+
+
+/* Functions ---------------------------------------------------------*/
+/**
+ * @brief  Mark beginning of an update.
+ * @param  sl Pointer to sequence counter
+ * @return none
+ */
+static inline void seqlock_write_begin(seqlock_t *sl)
+{
+    (*sl)++;
+    SEQLOCK_BARRIER();
+}
+
+
+/**
+ * @brief  Mark end of an update.
+ * @param  sl Pointer to sequence counter
+ * @return none
+ */
+static inline void seqlock_write_end(seqlock_t *sl)
+{
+    SEQLOCK_BARRIER();
+    (*sl)++;
+}
+
+
+/**
+ * @brief  Start reading of shared data.
+ * @param  sl Pointer to sequence counter
+ * @return Counter value to be passed to seqlock_read_retry()
+ */
+static inline uint8_t seqlock_read_begin(seqlock_t *sl)
+{
+    uint8_t start = *sl;
+
+    SEQLOCK_BARRIER();
+    return start;
+}
+
+
+/**
+ * @brief  Test if the data read since seqlock_read_begin() may be torn.
+ * @param  sl Pointer to sequence counter
+ * @param  start Value returned by seqlock_read_begin()
+ * @return 1 if the copy must be repeated, 0 if it is consistent
+ */
+static inline uint8_t seqlock_read_retry(seqlock_t *sl, uint8_t start)
+{
+    SEQLOCK_BARRIER();
+    return (start & 1) || (*sl != start);
+}
+
+/** @} */
+
+#endif
@@ -21,6 +21,8 @@
  * @brief Timer library for AVR-GCC.
  *
  * The library contains macros for controlling the timer modules.
+ * Overflow macros are named after rounded periods, CTC (Clear Timer on
+ * Compare match) macros give exact periods computed from F_CPU.
  *
  * @note Based on Microchip Atmel ATmega328P manual and no source file
  *       is needed for the library.
@@ -37,21 +39,34 @@
 
 
 /* Defines -----------------------------------------------------------*/
+#ifndef F_CPU
+# define F_CPU 16000000 /**< @brief CPU frequency in Hz required for CTC periods */
+#endif
+
+/**
+ * @brief Compare value (TOP) for CTC period
+ * @param us Period in microseconds
+ * @param prescaler Timer clock prescaler
+ * @note  Exact when F_CPU * us / 1000000 is divisible by prescaler.
+ */
+#define TIM_CTC_TOP(us, prescaler) ((uint16_t)(((F_CPU / 1000000UL) * (us)) / (prescaler) - 1))
+
+
 /**
  * @name  Definitions for 16-bit Timer/Counter1
  * @note  t_OVF = 1/F_CPU * prescaler * 2^n where n = 16, F_CPU = 16 MHz
  */
 /** @brief Stop timer, prescaler 000 --> STOP */
 #define TIM1_stop()           TCCR1B &= ~((1<<CS12) | (1<<CS11) | (1<<CS10));
-/** @brief Set overflow 4ms, prescaler 001 --> 1 */
+/** @brief Set overflow 4ms (4.096 ms), prescaler 001 --> 1 */
 #define TIM1_overflow_4ms()   TCCR1B &= ~((1<<CS12) | (1<<CS11)); TCCR1B |= (1<<CS10);
-/** @brief Set overflow 33ms, prescaler 010 --> 8 */
+/** @brief Set overflow 33ms (32.768 ms), prescaler 010 --> 8 */
 #define TIM1_overflow_33ms()  TCCR1B &= ~((1<<CS12) | (1<<CS10)); TCCR1B |= (1<<CS11);
-/** @brief Set overflow 262ms, prescaler 011 --> 64 */
+/** @brief Set overflow 262ms (262.144 ms), prescaler 011 --> 64 */
 #define TIM1_overflow_262ms() TCCR1B &= ~(1<<CS12); TCCR1B |= (1<<CS11) | (1<<CS10);
-/** @brief Set overflow 1s, prescaler 100 --> 256 */
+/** @brief Set overflow 1s (1.048576 s), prescaler 100 --> 256 */
 #define TIM1_overflow_1s()    TCCR1B &= ~((1<<CS11) | (1<<CS10)); TCCR1B |= (1<<CS12);
-/** @brief Set overflow 4s, prescaler // 101 --> 1024 */
+/** @brief Set overflow 4s (4.194304 s), prescaler // 101 --> 1024 */
 #define TIM1_overflow_4s()    TCCR1B &= ~(1<<CS11); TCCR1B |= (1<<CS12) | (1<<CS10);
 
 /** @brief Enable overflow interrupt, 1 --> enable */
@@ -59,21 +74,45 @@
 /** @brief Disable overflow interrupt, 0 --> disable */
 #define TIM1_overflow_interrupt_disable() TIMSK1 &= ~(1<<TOIE1);
 
+/**
+ * @name  CTC mode of Timer/Counter1
+ * @note  t = 1/F_CPU * prescaler * (OCR1A + 1), mode 4, TOP = OCR1A
+ */
+/** @brief Set CTC mode with compare value top and clock select cs */
+#define TIM1_ctc(top, cs)     TCCR1A &= ~((1<<WGM11) | (1<<WGM10)); TCCR1B = (TCCR1B & ~((1<<WGM13) | (1<<CS12) | (1<<CS11) | (1<<CS10))) | (1<<WGM12) | (cs); OCR1A = (top);
+/** @brief Set exact period 1ms, prescaler 001 --> 1 */
+#define TIM1_ctc_1ms()        TIM1_ctc(TIM_CTC_TOP(1000UL, 1), (1<<CS10))
+/** @brief Set exact period 10ms, prescaler 010 --> 8 */
+#define TIM1_ctc_10ms()       TIM1_ctc(TIM_CTC_TOP(10000UL, 8), (1<<CS11))
+/** @brief Set exact period 100ms, prescaler 011 --> 64 */
+#define TIM1_ctc_100ms()      TIM1_ctc(TIM_CTC_TOP(100000UL, 64), (1<<CS11) | (1<<CS10))
+/** @brief Set exact period 1s, prescaler 100 --> 256 */
+#define TIM1_ctc_1s()         TIM1_ctc(TIM_CTC_TOP(1000000UL, 256), (1<<CS12))
+/** @brief Set exact period 4s, prescaler 101 --> 1024 */
+#define TIM1_ctc_4s()         TIM1_ctc(TIM_CTC_TOP(4000000UL, 1024), (1<<CS12) | (1<<CS10))
+
+/** @brief Enable compare match A interrupt, 1 --> enable */
+#define TIM1_compare_interrupt_enable()  TIMSK1 |= (1<<OCIE1A);
+/** @brief Disable compare match A interrupt, 0 --> disable */
+#define TIM1_compare_interrupt_disable() TIMSK1 &= ~(1<<OCIE1A);
+
 
 /**
  * @name  Definitions for 8-bit Timer/Counter0
  * @note  t_OVF = 1/F_CPU * prescaler * 2^n where n = 8, F_CPU = 16 MHz
  */
-// WRITE YOUR CODE HERE
 /** @brief Stop timer, prescaler 000 --> STOP */
 #define TIM0_stop()  TCCR0B &= ~((1<<CS02) | (1<<CS01) | (1<<CS00));
-
-// #define TIM0_overflow_16us()  ...
-// #define TIM0_overflow_128us()  ...
-// #define TIM0_overflow_1ms()  ...
-// #define TIM0_overflow_4ms()  ...
-
-/** @brief Set overflow 16ms, prescaler // 101 --> 1024 */
+/** @brief Set overflow 16us, prescaler 001 --> 1 */
+#define TIM0_overflow_16us()  TCCR0B &= ~((1<<CS02) | (1<<CS01)); TCCR0B |= (1<<CS00);
+/** @brief Set overflow 128us, prescaler 010 --> 8 */
+#define TIM0_overflow_128us() TCCR0B &= ~((1<<CS02) | (1<<CS00)); TCCR0B |= (1<<CS01);
+/** @brief Set overflow 1ms (1.024 ms), prescaler 011 --> 64 */
+#define TIM0_overflow_1ms()   TCCR0B &= ~(1<<CS02); TCCR0B |= (1<<CS01) | (1<<CS00);
+/** @brief Set overflow 4ms (4.096 ms), prescaler 100 --> 256 */
+#define TIM0_overflow_4ms()   TCCR0B &= ~((1<<CS01) | (1<<CS00)); TCCR0B |= (1<<CS02);
+
+/** @brief Set overflow 16ms (16.384 ms), prescaler // 101 --> 1024 */
 #define TIM0_overflow_16ms()  TCCR0B &= ~(1<<CS01); TCCR0B |= (1<<CS02) | (1<<CS00);
 
 /** @brief Enable overflow interrupt, 1 --> enable */
@@ -81,6 +120,26 @@
 /** @brief Disable overflow interrupt, 0 --> disable */
 #define TIM0_overflow_interrupt_disable() TIMSK0 &= ~(1<<TOIE0);
 
+/**
+ * @name  CTC mode of Timer/Counter0
+ * @note  t = 1/F_CPU * prescaler * (OCR0A + 1), mode 2, TOP = OCR0A
+ */
+/** @brief Set CTC mode with compare value top and clock select cs */
+#define TIM0_ctc(top, cs)     TCCR0A = (TCCR0A & ~(1<<WGM00)) | (1<<WGM01); TCCR0B = (TCCR0B & ~((1<<WGM02) | (1<<CS02) | (1<<CS01) | (1<<CS00))) | (cs); OCR0A = (top);
+/** @brief Set exact period 10us, prescaler 001 --> 1 */
+#define TIM0_ctc_10us()       TIM0_ctc(TIM_CTC_TOP(10UL, 1), (1<<CS00))
+/** @brief Set exact period 100us, prescaler 010 --> 8 */
+#define TIM0_ctc_100us()      TIM0_ctc(TIM_CTC_TOP(100UL, 8), (1<<CS01))
+/** @brief Set exact period 1ms, prescaler 011 --> 64 */
+#define TIM0_ctc_1ms()        TIM0_ctc(TIM_CTC_TOP(1000UL, 64), (1<<CS01) | (1<<CS00))
+/** @brief Set exact period 4ms, prescaler 100 --> 256 */
+#define TIM0_ctc_4ms()        TIM0_ctc(TIM_CTC_TOP(4000UL, 256), (1<<CS02))
+
+/** @brief Enable compare match A interrupt, 1 --> enable */
+#define TIM0_compare_interrupt_enable()  TIMSK0 |= (1<<OCIE0A);
+/** @brief Disable compare match A interrupt, 0 --> disable */
+#define TIM0_compare_interrupt_disable() TIMSK0 &= ~(1<<OCIE0A);
+
 
 /**
  * @name  Definitions for 8-bit Timer/Counter2
@@ -96,6 +155,28 @@
 /** @brief Disable overflow interrupt, 0 --> disable */
 #define TIM2_overflow_interrupt_disable() TIMSK2 &= ~(1<<TOIE2);
 
+/**
+ * @name  CTC mode of Timer/Counter2
+ * @note  t = 1/F_CPU * prescaler * (OCR2A + 1), mode 2, TOP = OCR2A
+ */
+/** @brief Set CTC mode with compare value top and clock select cs */
+#define TIM2_ctc(top, cs)     TCCR2A = (TCCR2A & ~(1<<WGM20)) | (1<<WGM21); TCCR2B = (TCCR2B & ~((1<<WGM22) | (1<<CS22) | (1<<CS21) | (1<<CS20))) | (cs); OCR2A = (top);
+/** @brief Set exact period 10us, prescaler 001 --> 1 */
+#define TIM2_ctc_10us()       TIM2_ctc(TIM_CTC_TOP(10UL, 1), (1<<CS20))
+/** @brief Set exact period 100us, prescaler 010 --> 8 */
+#define TIM2_ctc_100us()      TIM2_ctc(TIM_CTC_TOP(100UL, 8), (1<<CS21))
+/** @brief Set exact period 1ms, prescaler 100 --> 64 */
+#define TIM2_ctc_1ms()        TIM2_ctc(TIM_CTC_TOP(1000UL, 64), (1<<CS22))
+/** @brief Set exact period 2ms, prescaler 101 --> 128 */
+#define TIM2_ctc_2ms()        TIM2_ctc(TIM_CTC_TOP(2000UL, 128), (1<<CS22) | (1<<CS20))
+/** @brief Set exact period 4ms, prescaler 110 --> 256 */
+#define TIM2_ctc_4ms()        TIM2_ctc(TIM_CTC_TOP(4000UL, 256), (1<<CS22) | (1<<CS21))
+
+/** @brief Enable compare match A interrupt, 1 --> enable */
+#define TIM2_compare_interrupt_enable()  TIMSK2 |= (1<<OCIE2A);
+/** @brief Disable compare match A interrupt, 0 --> disable */
+#define TIM2_compare_interrupt_disable() TIMSK2 &= ~(1<<OCIE2A);
+
 
 /** @} */
 
@@ -0,0 +1,637 @@
+/*
+ * Interrupt-driven ADC scanner for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware; host tests in test/test_adc.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <adc.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+#include "seqlock.h"
+#include <prof.h>
+
+
+// -- Defines --------------------------------------------------------
+// Scanning modes
+#define MODE_STOP       0
+#define MODE_CONTINUOUS 1  // Next conversion started from ISR
+#define MODE_TIMED      2  // Conversions started by Timer/Counter1
+#define MODE_SLEEP      3  // Conversions started by ADC Noise Reduction
+#define MODE_BURST      4  // Free running conversions into buffer
+
+
+// -- Global variables -----------------------------------------------
+static uint8_t adc_admux[ADC_MAX_CHANNELS];  // Reference, adjust, mux
+static uint8_t adc_count = 0;
+static uint8_t adc_os[ADC_MAX_CHANNELS];
+static uint8_t adc_discard[ADC_MAX_CHANNELS];
+static uint8_t adc_prescaler = ADC_PRESCALER_128;
+static volatile uint8_t adc_current = 0;
+static volatile uint8_t adc_mode = MODE_STOP;
+static volatile uint8_t adc_round_pending = 0;
+static volatile uint32_t adc_tick = 0;
+// Oversampling state of current channel
+static volatile uint16_t adc_os_acc = 0;
+static volatile uint8_t adc_os_count = 0;
+static volatile uint32_t adc_os_tick = 0;
+static volatile uint8_t adc_discard_left = 0;
+// Burst capture
+static uint8_t * volatile adc_burst_ptr;
+static volatile uint16_t adc_burst_left = 0;
+static volatile uint16_t adc_ring[ADC_MAX_CHANNELS][ADC_RING_SIZE];
+static volatile uint32_t adc_ring_tick[ADC_MAX_CHANNELS][ADC_RING_SIZE];
+static volatile uint16_t adc_seqs[ADC_MAX_CHANNELS];
+static filter_t adc_filters[ADC_MAX_CHANNELS];
+static seqlock_t adc_lock = 0;  // Odd while the ISR updates results
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: adc_init()
+ * Purpose:  Set AVcc reference, prescaler 128 and enable the ADC with
+ *           conversion complete interrupt.
+ * Returns:  none
+ */
+void adc_init(void)
+{
+    // Set the reference voltage to AVcc
+    ADMUX = ADC_REF_AVCC;
+    // Enable the ADC, its interrupt, and set the prescaler
+    adc_prescaler = ADC_PRESCALER_128;
+    ADCSRA = (1<<ADEN) | (1<<ADIE) | (adc_prescaler<<ADPS0);
+}
+
+
+/*
+ * Function: adc_set_prescaler()
+ * Purpose:  Set ADC clock prescaler used by scanning.
+ * Input(s): prescaler - ADC_PRESCALER_2 to ADC_PRESCALER_128
+ * Returns:  none
+ */
+void adc_set_prescaler(uint8_t prescaler)
+{
+    adc_prescaler = prescaler & 7;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        ADCSRA = (ADCSRA & ~(7<<ADPS0)) | (adc_prescaler<<ADPS0);
+    }
+}
+
+
+/*
+ * Function: adc_scan_init()
+ * Purpose:  Configure list of scanned channels.
+ * Input(s): channels - Multiplexer values (0 to 15)
+ *           count - Number of channels, at most ADC_MAX_CHANNELS
+ * Returns:  none
+ */
+void adc_scan_init(const uint8_t *channels, uint8_t count)
+{
+    adc_scan_stop();
+
+    if (count > ADC_MAX_CHANNELS)
+        count = ADC_MAX_CHANNELS;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        for (uint8_t i = 0; i < count; i++) {
+            adc_admux[i] = ADC_REF_AVCC | (channels[i] & 0x0f);
+            adc_os[i] = 0;
+            adc_discard[i] = 0;
+            filter_init(&adc_filters[i], FILTER_NONE, 0);
+            adc_seqs[i] = 0;
+            for (uint8_t j = 0; j < ADC_RING_SIZE; j++) {
+                adc_ring[i][j] = 0;
+                adc_ring_tick[i][j] = 0;
+            }
+        }
+        adc_count = count;
+        adc_current = 0;
+    }
+}
+
+
+/*
+ * Function: adc_restart()
+ * Purpose:  Reset scanning state and select the first channel.
+ * Input(s): mode - New scanning mode
+ * Returns:  none
+ * Note:     Called with interrupts disabled.
+ */
+static void adc_restart(uint8_t mode)
+{
+    adc_current = 0;
+    adc_mode = mode;
+    adc_tick = 0;
+    adc_os_acc = 0;
+    adc_os_count = 0;
+    adc_discard_left = adc_discard[0];
+    ADMUX = adc_admux[0];
+}
+
+
+/*
+ * Function: adc_scan_start()
+ * Purpose:  Start continuous scanning of the configured channels.
+ * Returns:  none
+ */
+void adc_scan_start(void)
+{
+    if (adc_count == 0)
+        return;
+
+    adc_scan_stop();
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        adc_restart(MODE_CONTINUOUS);
+        ADCSRA |= (1<<ADSC);
+    }
+}
+
+
+/*
+ * Function: adc_scan_start_timed()
+ * Purpose:  Start scanning triggered by Timer/Counter1 Compare Match B
+ *           at exact period.
+ * Input(s): period_us - Time between two conversions in microseconds
+ * Returns:  none
+ */
+void adc_scan_start_timed(uint32_t period_us)
+{
+    // Prescaler values selected by CS12:0 = 1, 2, 3, 4, 5
+    static const uint8_t shifts[] = {0, 3, 6, 8, 10};
+    uint32_t cycles;
+    uint8_t cs = 0;
+
+    if (adc_count == 0)
+        return;
+    // One conversion takes 13 ADC clock cycles, keep a margin
+    cycles = (uint32_t)15 << adc_prescaler;
+    if (period_us * (F_CPU / 1000000UL) < cycles)
+        period_us = cycles / (F_CPU / 1000000UL) + 1;
+
+    cycles = period_us * (F_CPU / 1000000UL);
+    while (cs < sizeof(shifts)-1 && (cycles >> shifts[cs]) > 65536UL)
+        cs++;
+    cycles >>= shifts[cs];
+    if (cycles > 65536UL)
+        cycles = 65536UL;
+
+    adc_scan_stop();
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        adc_restart(MODE_TIMED);
+
+        // Timer/Counter1 in CTC mode, TOP = OCR1A, trigger on OCR1B
+        TCCR1B = 0;
+        TCCR1A = 0;
+        TCNT1 = 0;
+        OCR1A = cycles - 1;
+        OCR1B = cycles - 1;
+        TIFR1 = (1<<OCF1B);
+        TCCR1B = (1<<WGM12) | ((cs + 1)<<CS10);
+
+        // Auto trigger source: Timer/Counter1 Compare Match B
+        ADCSRB = (ADCSRB & ~(7<<ADTS0)) | (5<<ADTS0);
+        ADCSRA |= (1<<ADATE);
+    }
+}
+
+
+/*
+ * Function: adc_scan_start_sleep()
+ * Purpose:  Prepare scanning in rounds converted during ADC Noise
+ *           Reduction sleep.
+ * Returns:  none
+ */
+void adc_scan_start_sleep(void)
+{
+    if (adc_count == 0)
+        return;
+
+    adc_scan_stop();
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        adc_restart(MODE_SLEEP);
+        adc_round_pending = 0;
+    }
+}
+
+
+/*
+ * Function: adc_scan_round()
+ * Purpose:  Request one round over all channels in sleep mode.
+ * Returns:  none
+ */
+void adc_scan_round(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        if (adc_mode == MODE_SLEEP && !adc_round_pending) {
+            adc_current = 0;
+            adc_discard_left = adc_discard[0];
+            ADMUX = adc_admux[0];
+            adc_round_pending = 1;
+        }
+    }
+}
+
+
+/*
+ * Function: adc_round_busy()
+ * Purpose:  Test if a requested round is not finished yet.
+ * Returns:  1 if conversions of the round are pending, 0 otherwise
+ */
+uint8_t adc_round_busy(void)
+{
+    return adc_round_pending;
+}
+
+
+/*
+ * Function: adc_scan_stop()
+ * Purpose:  Stop scanning and busy-wait for the conversion in progress.
+ * Returns:  none
+ */
+void adc_scan_stop(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        if (adc_mode == MODE_TIMED)
+            TCCR1B &= ~((1<<CS12) | (1<<CS11) | (1<<CS10));
+        ADCSRA &= ~(1<<ADATE);
+        ADCSRA = (ADCSRA & ~(7<<ADPS0)) | (adc_prescaler<<ADPS0);
+        adc_mode = MODE_STOP;
+        adc_round_pending = 0;
+        adc_burst_left = 0;
+    }
+
+    // Wait for a conversion in progress
+    while (ADCSRA & (1<<ADSC));
+}
+
+
+/*
+ * Function: adc_set_oversampling()
+ * Purpose:  Set oversampling of one channel.
+ * Input(s): idx - Index of channel in the scan list
+ *           n - Oversampling exponent, 4^n conversions per result
+ * Returns:  none
+ */
+void adc_set_oversampling(uint8_t idx, uint8_t n)
+{
+    if (idx >= ADC_MAX_CHANNELS)
+        return;
+    if (n > ADC_MAX_OVERSAMPLING)
+        n = ADC_MAX_OVERSAMPLING;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        adc_os[idx] = n;
+        if (idx == adc_current) {
+            adc_os_acc = 0;
+            adc_os_count = 0;
+        }
+    }
+}
+
+
+/*
+ * Function: adc_channel_config()
+ * Purpose:  Set conversion settings of one channel.
+ * Input(s): idx - Index of channel in the scan list
+ *           flags - Reference, optionally ORed with ADC_LEFT_ADJUST
+ *           discard - Conversions dropped after selecting the channel
+ * Returns:  none
+ */
+void adc_channel_config(uint8_t idx, uint8_t flags, uint8_t discard)
+{
+    if (idx >= ADC_MAX_CHANNELS)
+        return;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        adc_admux[idx] = (flags & 0xe0) | (adc_admux[idx] & 0x0f);
+        adc_discard[idx] = discard;
+    }
+}
+
+
+/*
+ * Function: adc_burst_start()
+ * Purpose:  Stop scanning and capture a burst of fast 8-bit conversions
+ *           of one input into buffer.
+ * Input(s): mux - Multiplexer value (0 to 15)
+ *           ref - Reference, ADC_REF_AREF, ADC_REF_AVCC or ADC_REF_1V1
+ *           buf - Destination buffer
+ *           len - Number of conversions
+ * Returns:  none
+ */
+void adc_burst_start(uint8_t mux, uint8_t ref, uint8_t *buf, uint16_t len)
+{
+    if (len == 0)
+        return;
+
+    adc_scan_stop();
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        adc_mode = MODE_BURST;
+        adc_burst_ptr = buf;
+        adc_burst_left = len;
+        ADMUX = (ref & 0xc0) | ADC_LEFT_ADJUST | (mux & 0x0f);
+        // Free running mode, prescaler 16
+        ADCSRB &= ~(7<<ADTS0);
+        ADCSRA = (ADCSRA & ~(7<<ADPS0)) | (ADC_PRESCALER_16<<ADPS0)
+               | (1<<ADATE) | (1<<ADSC);
+    }
+}
+
+
+/*
+ * Function: adc_burst_busy()
+ * Purpose:  Test if a burst capture is in progress.
+ * Returns:  1 if capture is running, 0 otherwise
+ */
+uint8_t adc_burst_busy(void)
+{
+    return adc_mode == MODE_BURST;
+}
+
+
+/*
+ * Function: adc_set_filter()
+ * Purpose:  Attach a streaming filter to one channel.
+ * Input(s): idx - Index of channel in the scan list
+ *           type - Filter type, see filter.h
+ *           n - Window length or EMA shift
+ * Returns:  none
+ */
+void adc_set_filter(uint8_t idx, uint8_t type, uint8_t n)
+{
+    if (idx >= ADC_MAX_CHANNELS)
+        return;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        filter_init(&adc_filters[idx], type, n);
+    }
+}
+
+
+/*
+ * Function: adc_filtered()
+ * Purpose:  Read filtered value of one channel.
+ * Input(s): idx - Index of channel in the scan list
+ * Returns:  Output of channel filter
+ */
+uint16_t adc_filtered(uint8_t idx)
+{
+    int16_t value;
+
+    if (idx >= ADC_MAX_CHANNELS)
+        return 0;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        value = filter_output(&adc_filters[idx]);
+    }
+    return value;
+}
+
+
+/*
+ * Function: adc_sleep()
+ * Purpose:  Put CPU to sleep until the next interrupt.
+ * Returns:  none
+ */
+void adc_sleep(void)
+{
+    cli();
+    if (adc_mode == MODE_SLEEP && adc_round_pending)
+        // Entering the sleep starts the conversion
+        set_sleep_mode(SLEEP_MODE_ADC);
+    else
+        set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+}
+
+
+/*
+ * Function: adc_latest()
+ * Purpose:  Read latest result of one channel.
+ * Input(s): idx - Index of channel in the scan list
+ * Returns:  Latest conversion result
+ */
+uint16_t adc_latest(uint8_t idx)
+{
+    return adc_history(idx, 0);
+}
+
+
+/*
+ * Function: adc_history()
+ * Purpose:  Read one of the recent results of one channel.
+ * Input(s): idx - Index of channel in the scan list
+ *           age - 0 for latest result, up to ADC_RING_SIZE-1 for older
+ * Returns:  Conversion result
+ */
+uint16_t adc_history(uint8_t idx, uint8_t age)
+{
+    uint16_t value;
+
+    if (idx >= ADC_MAX_CHANNELS)
+        return 0;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        value = adc_ring[idx][(adc_seqs[idx] - 1 - age) & (ADC_RING_SIZE-1)];
+    }
+    return value;
+}
+
+
+/*
+ * Function: adc_sample()
+ * Purpose:  Read one of the recent results of one channel together with
+ *           its timestamp.
+ * Input(s): idx - Index of channel in the scan list
+ *           age - 0 for latest result, up to ADC_RING_SIZE-1 for older
+ *           sample - Pointer to result structure
+ * Returns:  none
+ */
+void adc_sample(uint8_t idx, uint8_t age, adc_sample_t *sample)
+{
+    uint8_t pos;
+
+    if (idx >= ADC_MAX_CHANNELS) {
+        sample->value = 0;
+        sample->tick = 0;
+        return;
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        pos = (adc_seqs[idx] - 1 - age) & (ADC_RING_SIZE-1);
+        sample->value = adc_ring[idx][pos];
+        sample->tick = adc_ring_tick[idx][pos];
+    }
+}
+
+
+/*
+ * Function: adc_ticks()
+ * Purpose:  Read number of trigger periods since start of scanning.
+ * Returns:  Trigger counter
+ */
+uint32_t adc_ticks(void)
+{
+    uint32_t tick;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        tick = adc_tick;
+    }
+    return tick;
+}
+
+
+/*
+ * Function: adc_seq()
+ * Purpose:  Read sequence counter of one channel.
+ * Input(s): idx - Index of channel in the scan list
+ * Returns:  Number of stored results, modulo 2^16
+ */
+uint16_t adc_seq(uint8_t idx)
+{
+    uint16_t seq;
+
+    if (idx >= ADC_MAX_CHANNELS)
+        return 0;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        seq = adc_seqs[idx];
+    }
+    return seq;
+}
+
+
+/*
+ * Function: adc_snapshot()
+ * Purpose:  Copy latest and filtered results of all channels.
+ * Input(s): snap - Pointer to snapshot structure
+ * Returns:  none
+ */
+void adc_snapshot(adc_snapshot_t *snap)
+{
+    uint8_t i;
+    uint8_t start;
+
+    do {
+        start = seqlock_read_begin(&adc_lock);
+        for (i = 0; i < ADC_MAX_CHANNELS; i++) {
+            snap->value[i] = adc_ring[i][(adc_seqs[i] - 1) & (ADC_RING_SIZE-1)];
+            snap->filtered[i] = filter_output(&adc_filters[i]);
+            snap->seq[i] = adc_seqs[i];
+        }
+        snap->tick = adc_tick;
+    } while (seqlock_read_retry(&adc_lock, start));
+}
+
+
+// -- Interrupt service routines -------------------------------------
+/*
+ * Function: ADC conversion complete interrupt
+ * Purpose:  Accumulate oversampled results, store final result of
+ *           current channel with its timestamp and select the next one.
+ *           In continuous mode start the next conversion, in timed mode
+ *           re-arm the trigger.
+ */
+ISR(ADC_vect)
+{
+    uint8_t i;
+    uint8_t n;
+    uint16_t value;
+
+    if (adc_mode == MODE_BURST) {
+        // Keep this path short, next result comes after 13 ADC clocks
+        *adc_burst_ptr++ = ADCH;
+        if (--adc_burst_left == 0) {
+            ADCSRA = (ADCSRA & ~((1<<ADATE) | (7<<ADPS0)))
+                   | (adc_prescaler<<ADPS0);
+            adc_mode = MODE_STOP;
+        }
+        return;
+    }
+
+    PROF_BEGIN(ADC_ISR);
+    seqlock_write_begin(&adc_lock);
+    i = adc_current;
+    if (adc_admux[i] & ADC_LEFT_ADJUST)
+        value = ADCH;
+    else
+        value = ADC;
+
+    if (adc_discard_left != 0) {
+        // Input is still settling after change of channel
+        adc_discard_left--;
+        adc_tick++;
+        goto rearm;
+    }
+
+    if (adc_os_count == 0)
+        // Result is tagged with trigger of its first conversion
+        adc_os_tick = adc_tick;
+    adc_tick++;
+
+    n = adc_os[i];
+    if (n != 0) {
+        adc_os_acc += value;
+        adc_os_count++;
+        // 4^n conversions accumulated?
+        if (adc_os_count < (uint8_t)(1 << (2*n)))
+            goto rearm;
+        // Decimation, result has 10+n (8+n) bits
+        value = adc_os_acc >> n;
+        adc_os_acc = 0;
+    }
+    adc_os_count = 0;
+
+    uint16_t seq = adc_seqs[i];
+    uint8_t pos = seq & (ADC_RING_SIZE-1);
+    adc_ring[i][pos] = value;
+    adc_ring_tick[i][pos] = adc_os_tick;
+    adc_seqs[i] = seq + 1;
+    filter_update(&adc_filters[i], value);
+
+    if (++i >= adc_count) {
+        i = 0;
+        adc_round_pending = 0;
+    }
+    adc_current = i;
+
+    // New channel is used by the next conversion
+    adc_discard_left = adc_discard[i];
+    ADMUX = adc_admux[i];
+
+rearm:
+    seqlock_write_end(&adc_lock);
+    if (adc_mode == MODE_TIMED)
+        // Compare flag is not cleared by any ISR, clear it so the next
+        // compare match makes a new rising edge of the trigger
+        TIFR1 = (1<<OCF1B);
+    else if (adc_mode == MODE_CONTINUOUS)
+        ADCSRA |= (1<<ADSC);
+    PROF_END(ADC_ISR);
+}
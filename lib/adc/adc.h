@@ -0,0 +1,352 @@
+#ifndef ADC_H
+# define ADC_H
+
+/*
+ * Interrupt-driven ADC scanner for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware; host tests in test/test_adc.
+ */
+
+/**
+ * @file
+ * @defgroup adc_scan ADC Scanner Library <adc.h>
+ * @code #include <adc.h> @endcode
+ *
+ * @brief Interrupt-driven multi-channel ADC scanner for AVR-GCC.
+ *
+ * The conversion complete interrupt stores each result and switches the
+ * multiplexer to the next channel of a configured list, so the main loop
+ * only reads the latest values. The readers never wait for the converter;
+ * only adc_scan_stop() busy-waits on ADSC for the conversion in progress.
+ * Every channel keeps a small ring of recent results and a sequence
+ * counter incremented with each new result.
+ *
+ * In timed mode, conversions are started by hardware (auto trigger on
+ * Timer/Counter1 Compare Match B) at an exact period, and each result is
+ * tagged with the index of the trigger which started it. Timer/Counter1
+ * is then reserved for the ADC.
+ *
+ * Each channel can be oversampled: 4^n conversions are accumulated in
+ * the interrupt and the sum is shifted right by n, which gives a result
+ * with 10+n bits when the input carries some noise. In sleep mode the
+ * conversions run in ADC Noise Reduction sleep with the CPU halted.
+ * Final results can pass through a streaming filter of each channel.
+ * adc_snapshot() copies results of all channels from one moment without
+ * disabling interrupts.
+ *
+ * Reference, left adjusted 8-bit results and the number of conversions
+ * discarded after switching to a channel are set per channel. A burst
+ * capture mode converts one input in free running mode at prescaler 16
+ * (about 77 kSps, 8 bits) into a buffer, e.g. for motor current
+ * waveforms.
+ *
+ * @note Based on Microchip Atmel ATmega328P manual.
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <avr/io.h>
+#include <filter.h>
+
+
+// -- Defines --------------------------------------------------------
+/**
+ * @brief  Maximum number of scanned channels.
+ */
+#ifndef ADC_MAX_CHANNELS
+# define ADC_MAX_CHANNELS 4
+#endif
+
+/**
+ * @brief  Number of results kept per channel, must be power of 2.
+ */
+#ifndef ADC_RING_SIZE
+# define ADC_RING_SIZE 4
+#endif
+
+#if (ADC_RING_SIZE & (ADC_RING_SIZE - 1)) != 0
+# error "ADC_RING_SIZE must be power of 2"
+#endif
+
+/**
+ * @name  Voltage references, use in adc_channel_config() flags
+ */
+#define ADC_REF_AREF 0x00                        /**< @brief AREF pin */
+#define ADC_REF_AVCC (1<<REFS0)                  /**< @brief AVcc */
+#define ADC_REF_1V1  ((1<<REFS1) | (1<<REFS0))   /**< @brief Internal 1.1 V */
+/** @brief  Left adjusted result, only 8 most significant bits are used */
+#define ADC_LEFT_ADJUST (1<<ADLAR)
+
+/**
+ * @name  ADC clock prescalers, F_ADC = F_CPU / prescaler
+ * @note  Full 10-bit accuracy needs F_ADC from 50 kHz to 200 kHz.
+ */
+#define ADC_PRESCALER_2   1 /**< @brief 8 MHz at 16 MHz */
+#define ADC_PRESCALER_4   2 /**< @brief 4 MHz at 16 MHz */
+#define ADC_PRESCALER_8   3 /**< @brief 2 MHz at 16 MHz */
+#define ADC_PRESCALER_16  4 /**< @brief 1 MHz, about 77 kSps, 8 bits */
+#define ADC_PRESCALER_32  5 /**< @brief 500 kHz at 16 MHz */
+#define ADC_PRESCALER_64  6 /**< @brief 250 kHz at 16 MHz */
+#define ADC_PRESCALER_128 7 /**< @brief 125 kHz, about 9.6 kSps, 10 bits */
+
+/** @brief  Highest oversampling exponent, 4^3 conversions, 13 bits */
+#define ADC_MAX_OVERSAMPLING 3
+
+/** @brief  Multiplexer value of internal 1.1 V bandgap reference */
+#define ADC_MUX_BANDGAP 14
+/** @brief  Multiplexer value of 0 V (GND) */
+#define ADC_MUX_GND 15
+
+
+// -- Types ----------------------------------------------------------
+/**
+ * @brief  One conversion result with its timestamp.
+ */
+typedef struct {
+    uint16_t value;  /**< @brief Conversion result */
+    uint32_t tick;   /**< @brief Index of trigger which started it */
+} adc_sample_t;
+
+/**
+ * @brief  Consistent copy of all channels, see adc_snapshot().
+ */
+typedef struct {
+    uint16_t value[ADC_MAX_CHANNELS];     /**< @brief Latest results */
+    uint16_t filtered[ADC_MAX_CHANNELS];  /**< @brief Filter outputs */
+    uint16_t seq[ADC_MAX_CHANNELS];       /**< @brief Sequence counters */
+    uint32_t tick;                        /**< @brief Trigger counter */
+} adc_snapshot_t;
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Set AVcc reference, prescaler 128 and enable the ADC with
+ *         conversion complete interrupt.
+ * @return none
+ */
+void adc_init(void);
+
+
+/**
+ * @brief  Set ADC clock prescaler used by scanning.
+ * @param  prescaler ADC_PRESCALER_2 to ADC_PRESCALER_128
+ * @return none
+ */
+void adc_set_prescaler(uint8_t prescaler);
+
+
+/**
+ * @brief  Configure list of scanned channels.
+ * @param  channels Multiplexer values (0 to 15), such as 0 for ADC0
+ * @param  count Number of channels, at most ADC_MAX_CHANNELS
+ * @return none
+ * @note   Result index i belongs to channels[i]. Sequence counters and
+ *         stored results are cleared, all channels use AVcc reference,
+ *         10-bit results and no discarded conversions.
+ */
+void adc_scan_init(const uint8_t *channels, uint8_t count);
+
+
+/**
+ * @brief  Start continuous scanning of the configured channels.
+ * @return none
+ */
+void adc_scan_start(void);
+
+
+/**
+ * @brief  Start scanning triggered by Timer/Counter1 at exact period.
+ * @param  period_us Time between two conversions in microseconds, up to
+ *         4194304 (16 MHz); at least 15 ADC clock cycles, as one
+ *         conversion takes 13 and trigger edges during it are ignored
+ * @return none
+ * @par    Implementation notes:
+ *           - Timer/Counter1 runs in CTC mode with TOP = OCR1A and the
+ *             smallest prescaler which fits the period
+ *           - Compare Match B is the auto trigger source of the ADC
+ *           - Channels are converted round-robin, so one channel is
+ *             sampled every period_us * count microseconds
+ */
+void adc_scan_start_timed(uint32_t period_us);
+
+
+/**
+ * @brief  Prepare scanning in rounds converted during ADC Noise
+ *         Reduction sleep.
+ * @return none
+ * @par    Implementation notes:
+ *           - Each adc_scan_round() converts every channel once (with
+ *             its oversampling), conversions run while adc_sleep() is
+ *             called from the main loop
+ *           - The I/O clock is stopped in this sleep mode, so timers
+ *             (except asynchronous Timer/Counter2) and the UART are
+ *             halted during each conversion
+ */
+void adc_scan_start_sleep(void);
+
+
+/**
+ * @brief  Request one round over all channels in sleep mode.
+ * @return none
+ */
+void adc_scan_round(void);
+
+
+/**
+ * @brief  Test if a requested round is not finished yet.
+ * @return 1 if conversions of the round are pending, 0 otherwise
+ */
+uint8_t adc_round_busy(void);
+
+
+/**
+ * @brief  Stop scanning and wait for the conversion in progress.
+ * @return none
+ * @note   Blocks for up to one conversion, at most 25 ADC clocks
+ *         (200 us at prescaler 128). Do not call from an interrupt.
+ */
+void adc_scan_stop(void);
+
+
+/**
+ * @brief  Set oversampling of one channel.
+ * @param  idx Index of channel in the scan list
+ * @param  n Oversampling exponent from 0 to ADC_MAX_OVERSAMPLING;
+ *         4^n conversions make one result with 10+n bits
+ * @return none
+ * @note   In timed mode one result takes 4^n trigger periods.
+ */
+void adc_set_oversampling(uint8_t idx, uint8_t n);
+
+
+/**
+ * @brief  Set conversion settings of one channel.
+ * @param  idx Index of channel in the scan list
+ * @param  flags ADC_REF_AREF, ADC_REF_AVCC or ADC_REF_1V1, optionally
+ *         ORed with ADC_LEFT_ADJUST for 8-bit results
+ * @param  discard Number of conversions dropped after the channel is
+ *         selected, lets the input (or a new reference) settle
+ * @return none
+ * @note   Switching between references needs about 1 ms until the AREF
+ *         capacitor settles, prefer the same reference for all channels.
+ */
+void adc_channel_config(uint8_t idx, uint8_t flags, uint8_t discard);
+
+
+/**
+ * @brief  Stop scanning and capture a burst of fast 8-bit conversions
+ *         of one input into buffer.
+ * @param  mux Multiplexer value (0 to 15)
+ * @param  ref ADC_REF_AREF, ADC_REF_AVCC or ADC_REF_1V1
+ * @param  buf Destination buffer of len bytes
+ * @param  len Number of conversions
+ * @return none
+ * @par    Implementation notes:
+ *           - Free running mode with prescaler 16, one 8-bit result
+ *             every 13 us (about 77 kSps)
+ *           - Interrupts longer than 13 us (I2C work inside ISRs) make
+ *             gaps, the buffer then holds fewer distinct samples
+ *           - Scanning is not resumed automatically, start it again
+ *             when adc_burst_busy() returns 0
+ */
+void adc_burst_start(uint8_t mux, uint8_t ref, uint8_t *buf, uint16_t len);
+
+
+/**
+ * @brief  Test if a burst capture is in progress.
+ * @return 1 if capture is running, 0 otherwise
+ */
+uint8_t adc_burst_busy(void);
+
+
+/**
+ * @brief  Attach a streaming filter to one channel.
+ * @param  idx Index of channel in the scan list
+ * @param  type Filter type, such as FILTER_MEDIAN, see filter.h
+ * @param  n Window length or EMA shift
+ * @return none
+ * @note   The filter runs in the conversion complete interrupt with each
+ *         final (decimated) result. Its history is cleared.
+ */
+void adc_set_filter(uint8_t idx, uint8_t type, uint8_t n);
+
+
+/**
+ * @brief  Read filtered value of one channel.
+ * @param  idx Index of channel in the scan list
+ * @return Output of channel filter, latest result for FILTER_NONE
+ */
+uint16_t adc_filtered(uint8_t idx);
+
+
+/**
+ * @brief  Put CPU to sleep until the next interrupt.
+ * @return none
+ * @note   Call from the idle part of the main loop. Uses ADC Noise
+ *         Reduction mode while a round is pending in sleep mode, Idle
+ *         mode (timers and UART running) otherwise.
+ */
+void adc_sleep(void);
+
+
+/**
+ * @brief  Read latest result of one channel.
+ * @param  idx Index of channel in the scan list
+ * @return Latest conversion result, 0 if there is none yet
+ */
+uint16_t adc_latest(uint8_t idx);
+
+
+/**
+ * @brief  Read one of the recent results of one channel.
+ * @param  idx Index of channel in the scan list
+ * @param  age 0 for latest result, up to ADC_RING_SIZE-1 for older ones
+ * @return Conversion result
+ */
+uint16_t adc_history(uint8_t idx, uint8_t age);
+
+
+/**
+ * @brief  Read one of the recent results of one channel together with
+ *         its timestamp.
+ * @param  idx Index of channel in the scan list
+ * @param  age 0 for latest result, up to ADC_RING_SIZE-1 for older ones
+ * @param  sample Pointer to result structure
+ * @return none
+ * @note   In continuous mode the timestamp counts conversions instead of
+ *         trigger periods.
+ */
+void adc_sample(uint8_t idx, uint8_t age, adc_sample_t *sample);
+
+
+/**
+ * @brief  Read number of trigger periods since start of scanning.
+ * @return Trigger counter, same time base as adc_sample_t.tick
+ */
+uint32_t adc_ticks(void);
+
+
+/**
+ * @brief  Read sequence counter of one channel.
+ * @param  idx Index of channel in the scan list
+ * @return Number of results stored since adc_scan_init(), modulo 2^16
+ * @note   Compare with a previous value to detect new data.
+ */
+uint16_t adc_seq(uint8_t idx);
+
+
+/**
+ * @brief  Copy latest and filtered results of all channels.
+ * @param  snap Pointer to snapshot structure
+ * @return none
+ * @note   Interrupts stay enabled, the copy is repeated if a conversion
+ *         completes during it. All values belong to the same moment.
+ */
+void adc_snapshot(adc_snapshot_t *snap);
+
+
+/** @} */
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * AHT20 temperature and humidity sensor driver for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <aht20.h>
+#include <twi.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+
+
+// -- Defines --------------------------------------------------------
+#define AHT20_DATA_LEN   7     // Status, 5 data bytes, CRC
+#define AHT20_BUSY       0x80  // Status: measurement in progress
+#define AHT20_CALIBRATED 0x08  // Status: calibration loaded
+
+
+// -- Global variables -----------------------------------------------
+static const char aht20_name[] PROGMEM = "AHT20";
+static const uint8_t aht20_cmd_init[] = {0xbe, 0x08, 0x00};
+static const uint8_t aht20_cmd_measure[] = {0xac, 0x33, 0x00};
+static uint8_t aht20_raw[AHT20_DATA_LEN];  // Filled by TWI interrupt
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: aht20_probe()
+ * Purpose:  Test presence of the sensor and load its calibration.
+ * Returns:  1 if present, 0 otherwise
+ */
+static uint8_t aht20_probe(void)
+{
+    uint8_t status;
+
+    if (twi_test_address(AHT20_ADR) != 0)
+        return 0;
+    if (twi_transfer(AHT20_ADR, 0, 0, &status, 1) != 0)
+        return 0;
+
+    if ((status & AHT20_CALIBRATED) == 0) {
+        twi_transfer(AHT20_ADR, aht20_cmd_init, 3, 0, 0);
+        _delay_ms(10);
+    }
+    return 1;
+}
+
+
+/*
+ * Function: aht20_start()
+ * Purpose:  Send measurement command in background.
+ * Returns:  CLIMATE_BUSY if started
+ */
+static uint8_t aht20_start(void)
+{
+    return twi_async_start(AHT20_ADR, aht20_cmd_measure, 3, 0, 0);
+}
+
+
+/*
+ * Function: aht20_fetch()
+ * Purpose:  Start reading of status and results in background.
+ * Returns:  CLIMATE_BUSY if started
+ */
+static uint8_t aht20_fetch(void)
+{
+    return twi_async_start(AHT20_ADR, 0, 0, aht20_raw, AHT20_DATA_LEN);
+}
+
+
+/*
+ * Function: aht20_decode()
+ * Purpose:  Check and convert fetched results.
+ * Input(s): data - Pointer to sample structure
+ * Returns:  CLIMATE_OK, CLIMATE_BUSY or CLIMATE_CHECKSUM
+ */
+static uint8_t aht20_decode(climate_data_t *data)
+{
+    uint32_t raw_h;
+    uint32_t raw_t;
+
+    if (aht20_raw[0] & AHT20_BUSY)
+        return CLIMATE_BUSY;
+    if (climate_crc8(aht20_raw, 6) != aht20_raw[6])
+        return CLIMATE_CHECKSUM;
+
+    // Two 20-bit values, humidity first
+    raw_h = ((uint32_t)aht20_raw[1] << 12) | ((uint16_t)aht20_raw[2] << 4)
+          | (aht20_raw[3] >> 4);
+    raw_t = ((uint32_t)(aht20_raw[3] & 0x0f) << 16)
+          | ((uint16_t)aht20_raw[4] << 8) | aht20_raw[5];
+
+    // RH = 100 * raw / 2^20, T = 200 * raw / 2^20 - 50
+    data->humidity = (raw_h * 1000) >> 20;
+    data->temperature = (int16_t)((raw_t * 2000) >> 20) - 500;
+    return CLIMATE_OK;
+}
+
+
+const climate_driver_t aht20_driver PROGMEM = {
+    .name = aht20_name,
+    .probe = aht20_probe,
+    .start = aht20_start,
+    .fetch = aht20_fetch,
+    .decode = aht20_decode,
+    .conv_ms = 80,
+};
@@ -0,0 +1,41 @@
+#ifndef AHT20_H
+# define AHT20_H
+
+/*
+ * AHT20 temperature and humidity sensor driver for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup aht20 AHT20 Sensor Library <aht20.h>
+ * @code #include <aht20.h> @endcode
+ *
+ * @brief Driver of Aosong AHT20 sensor for the climate layer.
+ *
+ * A measurement takes about 80 ms; the busy bit of the status byte is
+ * tested before the 20-bit results are decoded. Data are protected by
+ * CRC-8. Use the driver through climate.h.
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <climate.h>
+
+
+// -- Defines --------------------------------------------------------
+/** @brief  I2C slave address of AHT20 */
+#define AHT20_ADR 0x38
+
+
+// -- Global variables -----------------------------------------------
+/** @brief  Operations of AHT20 for climate_init(), in program memory */
+extern const climate_driver_t aht20_driver;
+
+
+/** @} */
+
+#endif
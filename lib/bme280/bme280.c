@@ -0,0 +1,179 @@
+/*
+ * BME280 temperature and humidity sensor driver for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <bme280.h>
+#include <twi.h>
+#include <avr/pgmspace.h>
+
+
+// -- Defines --------------------------------------------------------
+// Registers
+#define BME280_REG_CALIB_T 0x88  // dig_T1 to dig_T3, 6 bytes
+#define BME280_REG_CALIB_H1 0xa1
+#define BME280_REG_CALIB_H2 0xe1  // dig_H2 to dig_H6, 7 bytes
+#define BME280_REG_ID      0xd0
+#define BME280_REG_DATA_T  0xfa  // Temperature and humidity, 5 bytes
+
+#define BME280_CHIP_ID     0x60
+#define BME280_DATA_LEN    5
+#define BME280_SKIPPED     0x80000  // Temperature not measured
+
+
+// -- Global variables -----------------------------------------------
+static const char bme280_name[] PROGMEM = "BME280";
+// ctrl_hum: humidity x1; ctrl_meas: temperature x1, pressure skipped,
+// forced mode (ctrl_hum is applied by the following write of ctrl_meas)
+static const uint8_t bme280_cmd_measure[] = {0xf2, 0x01, 0xf4, 0x21};
+static const uint8_t bme280_reg_data = BME280_REG_DATA_T;
+static uint8_t bme280_adr = BME280_ADR;
+static uint8_t bme280_raw[BME280_DATA_LEN];  // Filled by TWI interrupt
+
+// Calibration data
+static uint16_t dig_T1;
+static int16_t dig_T2;
+static int16_t dig_T3;
+static uint8_t dig_H1;
+static int16_t dig_H2;
+static uint8_t dig_H3;
+static int16_t dig_H4;
+static int16_t dig_H5;
+static int8_t dig_H6;
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: bme280_calibration()
+ * Purpose:  Read calibration data of temperature and humidity.
+ * Returns:  ACK/NACK received value
+ */
+static uint8_t bme280_calibration(void)
+{
+    uint8_t buf[7];
+
+    if (twi_readfrom_mem_into(bme280_adr, BME280_REG_CALIB_T, buf, 6) != 0)
+        return 1;
+    dig_T1 = (buf[1] << 8) | buf[0];
+    dig_T2 = (buf[3] << 8) | buf[2];
+    dig_T3 = (buf[5] << 8) | buf[4];
+
+    if (twi_readfrom_mem_into(bme280_adr, BME280_REG_CALIB_H1, &dig_H1, 1) != 0)
+        return 1;
+
+    if (twi_readfrom_mem_into(bme280_adr, BME280_REG_CALIB_H2, buf, 7) != 0)
+        return 1;
+    dig_H2 = (buf[1] << 8) | buf[0];
+    dig_H3 = buf[2];
+    // 12-bit values sharing the middle byte
+    dig_H4 = ((int8_t)buf[3] << 4) | (buf[4] & 0x0f);
+    dig_H5 = ((int8_t)buf[5] << 4) | (buf[4] >> 4);
+    dig_H6 = buf[6];
+
+    return 0;
+}
+
+
+/*
+ * Function: bme280_probe()
+ * Purpose:  Find the sensor on one of its addresses, check chip ID and
+ *           read calibration data.
+ * Returns:  1 if present, 0 otherwise
+ */
+static uint8_t bme280_probe(void)
+{
+    uint8_t id;
+
+    for (bme280_adr = BME280_ADR; bme280_adr <= BME280_ADR_ALT; bme280_adr++) {
+        if (twi_test_address(bme280_adr) != 0)
+            continue;
+        if (twi_readfrom_mem_into(bme280_adr, BME280_REG_ID, &id, 1) == 0
+            && id == BME280_CHIP_ID && bme280_calibration() == 0)
+            return 1;
+    }
+    return 0;
+}
+
+
+/*
+ * Function: bme280_start()
+ * Purpose:  Start measurement in forced mode in background.
+ * Returns:  CLIMATE_BUSY if started
+ */
+static uint8_t bme280_start(void)
+{
+    return twi_async_start(bme280_adr, bme280_cmd_measure,
+                           sizeof(bme280_cmd_measure), 0, 0);
+}
+
+
+/*
+ * Function: bme280_fetch()
+ * Purpose:  Start reading of results in background.
+ * Returns:  CLIMATE_BUSY if started
+ */
+static uint8_t bme280_fetch(void)
+{
+    return twi_async_start(bme280_adr, &bme280_reg_data, 1,
+                           bme280_raw, BME280_DATA_LEN);
+}
+
+
+/*
+ * Function: bme280_decode()
+ * Purpose:  Compensate fetched results.
+ * Input(s): data - Pointer to sample structure
+ * Returns:  CLIMATE_OK or CLIMATE_RANGE
+ */
+static uint8_t bme280_decode(climate_data_t *data)
+{
+    int32_t adc_T;
+    int32_t adc_H;
+    int32_t var1;
+    int32_t var2;
+    int32_t t_fine;
+    int32_t h;
+
+    adc_T = ((uint32_t)bme280_raw[0] << 12) | ((uint16_t)bme280_raw[1] << 4)
+          | (bme280_raw[2] >> 4);
+    adc_H = ((uint16_t)bme280_raw[3] << 8) | bme280_raw[4];
+    if (adc_T == BME280_SKIPPED)
+        return CLIMATE_RANGE;
+
+    // Temperature, datasheet section 4.2.3
+    var1 = ((((adc_T >> 3) - ((int32_t)dig_T1 << 1))) * dig_T2) >> 11;
+    var2 = (((((adc_T >> 4) - dig_T1) * ((adc_T >> 4) - dig_T1)) >> 12)
+            * dig_T3) >> 14;
+    t_fine = var1 + var2;
+    // Hundredths of deg C to tenths
+    data->temperature = ((t_fine * 5 + 128) >> 8) / 10;
+
+    // Humidity in Q22.10 percent
+    h = t_fine - 76800;
+    h = (((((adc_H << 14) - ((int32_t)dig_H4 << 20) - ((int32_t)dig_H5 * h))
+           + 16384) >> 15)
+         * (((((((h * dig_H6) >> 10) * (((h * dig_H3) >> 11) + 32768)) >> 10)
+              + 2097152) * dig_H2 + 8192) >> 14));
+    h = h - (((((h >> 15) * (h >> 15)) >> 7) * dig_H1) >> 4);
+    if (h < 0)
+        h = 0;
+    if (h > 419430400)
+        h = 419430400;
+    data->humidity = ((uint32_t)(h >> 12) * 10) >> 10;
+
+    return CLIMATE_OK;
+}
+
+
+const climate_driver_t bme280_driver PROGMEM = {
+    .name = bme280_name,
+    .probe = bme280_probe,
+    .start = bme280_start,
+    .fetch = bme280_fetch,
+    .decode = bme280_decode,
+    .conv_ms = 10,
+};
@@ -0,0 +1,46 @@
+#ifndef BME280_H
+# define BME280_H
+
+/*
+ * BME280 temperature and humidity sensor driver for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup bme280 BME280 Sensor Library <bme280.h>
+ * @code #include <bme280.h> @endcode
+ *
+ * @brief Driver of Bosch BME280 sensor for the climate layer.
+ *
+ * Each measurement runs in forced mode with oversampling x1 of
+ * temperature and humidity; pressure is skipped. Results are compensated
+ * with the 32-bit integer formulas of the datasheet using calibration
+ * data read by the probe. Use the driver through climate.h.
+ *
+ * @note BMP280 (chip ID 0x58) has no humidity sensor and is not detected.
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <climate.h>
+
+
+// -- Defines --------------------------------------------------------
+/** @brief  I2C slave address with SDO pin low */
+#define BME280_ADR     0x76
+/** @brief  I2C slave address with SDO pin high */
+#define BME280_ADR_ALT 0x77
+
+
+// -- Global variables -----------------------------------------------
+/** @brief  Operations of BME280 for climate_init(), in program memory */
+extern const climate_driver_t bme280_driver;
+
+
+/** @} */
+
+#endif
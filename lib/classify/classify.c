@@ -0,0 +1,66 @@
+/*
+ * Hysteresis threshold classifier for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware; host tests in test/test_app.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <classify.h>
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: class_init()
+ * Purpose:  Initialize classifier.
+ * Input(s): c - Pointer to classifier state
+ *           levels - Table of thresholds, one entry per state
+ *           count - Number of states
+ *           min_dwell - Shortest time between two changes of state
+ * Returns:  none
+ */
+void class_init(classifier_t *c, const class_level_t *levels,
+                uint8_t count, uint32_t min_dwell)
+{
+    c->levels = levels;
+    c->count = count;
+    c->state = 0;
+    c->valid = 0;
+    c->min_dwell = min_dwell;
+    c->since = 0;
+}
+
+
+/*
+ * Function: class_update()
+ * Purpose:  Classify a new value.
+ * Input(s): c - Pointer to classifier state
+ *           value - New value
+ *           now - Current time
+ * Returns:  1 if the state has changed, 0 otherwise
+ */
+uint8_t class_update(classifier_t *c, int16_t value, uint32_t now)
+{
+    uint8_t target = c->state;
+
+    // Go up while the value is above entry of the next state
+    while (target+1 < c->count && value > c->levels[target+1].enter)
+        target++;
+    // Go down while the value is below exit of the current one
+    if (target == c->state)
+        while (target > 0 && value < c->levels[target].exit)
+            target--;
+
+    if (c->valid) {
+        if (target == c->state)
+            return 0;
+        if (now - c->since < c->min_dwell)
+            return 0;
+    }
+
+    c->state = target;
+    c->valid = 1;
+    c->since = now;
+    return 1;
+}
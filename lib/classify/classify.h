@@ -0,0 +1,104 @@
+#ifndef CLASSIFY_H
+# define CLASSIFY_H
+
+/*
+ * Hysteresis threshold classifier for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware; host tests in test/test_app.
+ */
+
+/**
+ * @file
+ * @defgroup classify Classifier Library <classify.h>
+ * @code #include <classify.h> @endcode
+ *
+ * @brief Table-driven classifier of sensor values into discrete states.
+ *
+ * States are ordered by increasing value. Every state except the lowest
+ * one has two thresholds: the value must rise above `enter` to reach it
+ * from the state below and fall below `exit` to leave it downwards.
+ * With `exit` lower than `enter`, a value hovering near a boundary does
+ * not switch the state back and forth. A minimum dwell time further
+ * limits how often the state may change.
+ *
+ * @code
+ * static const class_level_t light_levels[] = {
+ *     {0, 0},      // 0: night
+ *     {720, 680},  // 1: day, above 720 to enter, below 680 to leave
+ * };
+ * classifier_t light;
+ * class_init(&light, light_levels, 2, 30);
+ * if (class_update(&light, value, seconds))
+ *     // state changed, update outputs
+ * @endcode
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdint.h>
+
+
+// -- Types ----------------------------------------------------------
+/**
+ * @brief  Thresholds of one state. Unused for the lowest state.
+ */
+typedef struct {
+    int16_t enter;  /**< @brief Value above it enters the state */
+    int16_t exit;   /**< @brief Value below it leaves the state down */
+} class_level_t;
+
+/**
+ * @brief  State of one classifier.
+ */
+typedef struct {
+    const class_level_t *levels;  /**< @brief Table of count states */
+    uint8_t count;                /**< @brief Number of states */
+    uint8_t state;                /**< @brief Current state */
+    uint8_t valid;                /**< @brief Set after first update */
+    uint32_t min_dwell;           /**< @brief Shortest time in a state */
+    uint32_t since;               /**< @brief Time of last change */
+} classifier_t;
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Initialize classifier.
+ * @param  c Pointer to classifier state
+ * @param  levels Table of thresholds, one entry per state; the table is
+ *         not copied and may be changed at run time
+ * @param  count Number of states
+ * @param  min_dwell Shortest time between two changes of state, in the
+ *         units of `now` passed to class_update()
+ * @return none
+ */
+void class_init(classifier_t *c, const class_level_t *levels,
+                uint8_t count, uint32_t min_dwell);
+
+
+/**
+ * @brief  Classify a new value.
+ * @param  c Pointer to classifier state
+ * @param  value New value
+ * @param  now Current time, any monotonic unit
+ * @return 1 if the state has changed (or was set by the first call),
+ *         0 otherwise
+ */
+uint8_t class_update(classifier_t *c, int16_t value, uint32_t now);
+
+
+/**
+ * @brief  Read current state.
+ * @param  c Pointer to classifier state
+ * @return Index of state in the table
+ */
+static inline uint8_t class_state(const classifier_t *c)
+{
+    return c->state;
+}
+
+
+/** @} */
+
+#endif
@@ -0,0 +1,229 @@
+/*
+ * Temperature and humidity sensor layer for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <climate.h>
+#include <twi.h>
+#include <avr/pgmspace.h>
+
+
+// -- Defines --------------------------------------------------------
+// Steps of one measurement
+#define PHASE_IDLE    0
+#define PHASE_START   1  // Start command is being sent
+#define PHASE_CONVERT 2  // Sensor converts
+#define PHASE_FETCH   3  // Result is being read
+
+// Operation of the selected driver, read from program memory
+#define DRV_OP(op) \
+    ((__typeof__(climate_drv->op))pgm_read_ptr(&climate_drv->op))
+
+
+// -- Global variables -----------------------------------------------
+static const climate_driver_t *climate_drv = 0;  // In program memory
+static uint8_t climate_phase = PHASE_IDLE;
+static uint8_t climate_retry = 0;   // Attempt within one period
+static uint8_t climate_fresh = 0;   // Not yet read by climate_read()
+static uint8_t climate_failed = 0;  // Periods without a sample
+static climate_data_t climate_data;
+static climate_stats_t climate_stats;
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: climate_init()
+ * Purpose:  Select the first sensor which responds, reset counters.
+ * Input(s): drivers - Drivers in order of preference, table and
+ *                     drivers in program memory
+ *           count - Number of drivers
+ * Returns:  Selected driver, 0 if none
+ */
+const climate_driver_t *climate_init(const climate_driver_t * const *drivers,
+                                     uint8_t count)
+{
+    climate_drv = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        const climate_driver_t *drv = pgm_read_ptr(&drivers[i]);
+        uint8_t (*probe)(void) =
+            (uint8_t (*)(void))pgm_read_ptr(&drv->probe);
+
+        if (probe()) {
+            climate_drv = drv;
+            break;
+        }
+    }
+
+    climate_phase = PHASE_IDLE;
+    climate_retry = 0;
+    climate_fresh = 0;
+    climate_failed = 0;
+    climate_data = (climate_data_t){0};
+    climate_stats = (climate_stats_t){0};
+
+    return climate_drv;
+}
+
+
+/*
+ * Function: climate_fail()
+ * Purpose:  Count an error and schedule the next attempt.
+ * Input(s): error - CLIMATE_BUSY to CLIMATE_RANGE
+ * Returns:  Time in milliseconds until the next call
+ */
+static uint16_t climate_fail(uint8_t error)
+{
+    switch (error) {
+    case CLIMATE_BUSY:
+        climate_stats.busy++;
+        break;
+    case CLIMATE_NACK:
+        climate_stats.nack++;
+        break;
+    case CLIMATE_CHECKSUM:
+        climate_stats.checksum++;
+        break;
+    case CLIMATE_RANGE:
+        climate_stats.range++;
+        break;
+    default:
+        climate_stats.bus++;
+        break;
+    }
+
+    if (climate_retry < CLIMATE_MAX_RETRIES) {
+        climate_stats.retries++;
+        // Fetch again while the sensor converts, otherwise start anew
+        climate_phase = (error == CLIMATE_BUSY) ? PHASE_CONVERT : PHASE_IDLE;
+        return CLIMATE_RETRY_MS << climate_retry++;
+    }
+
+    // Give up this period, keep previous sample
+    climate_phase = PHASE_IDLE;
+    climate_retry = 0;
+    climate_stats.stale++;
+    if (climate_failed < 255)
+        climate_failed++;
+    return CLIMATE_PERIOD_MS;
+}
+
+
+/*
+ * Function: climate_update()
+ * Purpose:  Run one step of a measurement.
+ * Returns:  Time in milliseconds until the next call
+ */
+uint16_t climate_update(void)
+{
+    uint8_t status = twi_async_status();
+    uint8_t result;
+
+    if (climate_drv == 0)
+        return CLIMATE_PERIOD_MS;
+    if (status == TWI_ASYNC_BUSY)
+        // Bus used by this or another transaction
+        return CLIMATE_TRANSFER_MS;
+
+    switch (climate_phase) {
+    case PHASE_IDLE:
+        if (DRV_OP(start) != 0) {
+            if (DRV_OP(start)() == CLIMATE_BUSY)
+                climate_phase = PHASE_START;
+            return CLIMATE_TRANSFER_MS;
+        }
+        // Sensor converts on its own, fetch the result
+        if (DRV_OP(fetch)() == CLIMATE_BUSY)
+            climate_phase = PHASE_FETCH;
+        return CLIMATE_TRANSFER_MS;
+
+    case PHASE_START:
+        if (status != TWI_ASYNC_OK)
+            return climate_fail(status);
+        climate_phase = PHASE_CONVERT;
+        return pgm_read_word(&climate_drv->conv_ms);
+
+    case PHASE_CONVERT:
+        if (DRV_OP(fetch)() == CLIMATE_BUSY)
+            climate_phase = PHASE_FETCH;
+        return CLIMATE_TRANSFER_MS;
+    }
+
+    // PHASE_FETCH
+    if (status != TWI_ASYNC_OK)
+        return climate_fail(status);
+
+    // CLIMATE_BUSY, conversion not finished in time, uses the retries too
+    result = DRV_OP(decode)(&climate_data);
+    if (result != CLIMATE_OK)
+        return climate_fail(result);
+
+    climate_phase = PHASE_IDLE;
+    climate_stats.samples++;
+    climate_fresh = 1;
+    climate_failed = 0;
+    climate_retry = 0;
+    return CLIMATE_PERIOD_MS;
+}
+
+
+/*
+ * Function: climate_read()
+ * Purpose:  Read latest valid sample.
+ * Input(s): data - Pointer to sample structure
+ * Returns:  1 if the sample is new, 0 otherwise
+ */
+uint8_t climate_read(climate_data_t *data)
+{
+    uint8_t fresh = climate_fresh;
+
+    *data = climate_data;
+    climate_fresh = 0;
+    return fresh;
+}
+
+
+/*
+ * Function: climate_age()
+ * Purpose:  Read number of sampling periods without a new sample.
+ * Returns:  0 if the latest sample is fresh
+ */
+uint8_t climate_age(void)
+{
+    return climate_failed;
+}
+
+
+/*
+ * Function: climate_get_stats()
+ * Purpose:  Read error and stale-data counters.
+ * Input(s): stats - Pointer to counter structure
+ * Returns:  none
+ */
+void climate_get_stats(climate_stats_t *stats)
+{
+    *stats = climate_stats;
+}
+
+
+/*
+ * Function: climate_crc8()
+ * Purpose:  Compute CRC-8 used by Sensirion and Aosong sensors.
+ * Input(s): data - Bytes to check
+ *           len - Number of bytes
+ * Returns:  CRC with polynomial 0x31 and initial value 0xff
+ */
+uint8_t climate_crc8(const uint8_t *data, uint8_t len)
+{
+    uint8_t crc = 0xff;
+
+    while (len--) {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : (crc << 1);
+    }
+    return crc;
+}
@@ -0,0 +1,179 @@
+#ifndef CLIMATE_H
+# define CLIMATE_H
+
+/*
+ * Temperature and humidity sensor layer for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup climate Climate Sensor Library <climate.h>
+ * @code #include <climate.h> @endcode
+ *
+ * @brief Common interface of I2C temperature and humidity sensors.
+ *
+ * Each sensor library provides a climate_driver_t with operations to
+ * probe the sensor, start a measurement, fetch its result and decode it.
+ * Drivers and the table passed to climate_init() are kept in program
+ * memory. climate_init() selects the first sensor present on the bus. Then
+ * climate_update() runs one step of a measurement each time it is
+ * called. Bus transfers run in background (see twi_async_start()) and
+ * the conversion time is returned to the caller, so other work overlaps
+ * with it.
+ *
+ * A sample is accepted only if its checksum and range are valid.
+ * Otherwise the measurement is retried after CLIMATE_RETRY_MS, and the
+ * delay doubles with each attempt. A sensor still busy after the
+ * conversion time is fetched again within the same attempts. When all attempts fail, the previous
+ * sample is kept and counted as stale.
+ *
+ * @code
+ * static const climate_driver_t * const sensors[] PROGMEM = {
+ *     &sht3x_driver, &bme280_driver, &aht20_driver, &dht12_driver,
+ * };
+ * climate_init(sensors, 4);
+ * // Task called after the returned number of milliseconds
+ * delay = climate_update();
+ * if (climate_read(&data))
+ *     // new sample, data.temperature in tenths of deg C
+ * @endcode
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdint.h>
+
+
+// -- Defines --------------------------------------------------------
+/** @brief  Time between two samples in milliseconds */
+#ifndef CLIMATE_PERIOD_MS
+# define CLIMATE_PERIOD_MS 2000
+#endif
+
+/** @brief  Delay before the first retry, doubled with each next one */
+#ifndef CLIMATE_RETRY_MS
+# define CLIMATE_RETRY_MS 50
+#endif
+
+/** @brief  Number of retries before the sample is given up */
+#ifndef CLIMATE_MAX_RETRIES
+# define CLIMATE_MAX_RETRIES 3
+#endif
+
+/** @brief  Time to wait for the end of a bus transfer */
+#define CLIMATE_TRANSFER_MS 2
+
+/**
+ * @name  Results of driver operations, the first ones equal TWI_ASYNC_*
+ */
+#define CLIMATE_OK       0  /**< @brief Done, sample is valid */
+#define CLIMATE_BUSY     1  /**< @brief Transfer or conversion running */
+#define CLIMATE_NACK     2  /**< @brief Sensor did not respond */
+#define CLIMATE_BUS      3  /**< @brief Bus error */
+#define CLIMATE_CHECKSUM 4  /**< @brief Wrong checksum */
+#define CLIMATE_RANGE    5  /**< @brief Values out of sensor range */
+
+
+// -- Types ----------------------------------------------------------
+/**
+ * @brief  One decoded sample.
+ */
+typedef struct {
+    int16_t temperature;  /**< @brief Temperature in tenths of deg C */
+    uint16_t humidity;    /**< @brief Relative humidity in tenths of % */
+} climate_data_t;
+
+/**
+ * @brief  Operations of one sensor type, defined in program memory.
+ */
+typedef struct {
+    const char *name;  /**< @brief Sensor name in program memory */
+    /** @brief Detect and set up the sensor, blocking; 1 if present */
+    uint8_t (*probe)(void);
+    /** @brief Start conversion in background, 0 if not needed */
+    uint8_t (*start)(void);
+    /** @brief Start reading of result in background */
+    uint8_t (*fetch)(void);
+    /** @brief Decode fetched result, CLIMATE_BUSY if not converted yet */
+    uint8_t (*decode)(climate_data_t *data);
+    uint16_t conv_ms;  /**< @brief Conversion time in milliseconds */
+} climate_driver_t;
+
+/**
+ * @brief  Error and stale-data counters.
+ */
+typedef struct {
+    uint16_t samples;   /**< @brief Accepted samples */
+    uint16_t nack;      /**< @brief Sensor did not respond */
+    uint16_t bus;       /**< @brief Bus errors */
+    uint16_t checksum;  /**< @brief Wrong checksum */
+    uint16_t range;     /**< @brief Values out of sensor range */
+    uint16_t busy;      /**< @brief Conversion not finished in time */
+    uint16_t retries;   /**< @brief Repeated measurements */
+    uint16_t stale;     /**< @brief Periods without a new sample */
+} climate_stats_t;
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Select the first sensor which responds, reset counters.
+ * @param  drivers Drivers in order of preference, table and drivers in
+ *         program memory
+ * @param  count Number of drivers
+ * @return Selected driver, 0 if no sensor has been found
+ * @note   Probing uses blocking bus transfers, call it at start-up after
+ *         twi_init().
+ */
+const climate_driver_t *climate_init(const climate_driver_t * const *drivers,
+                                     uint8_t count);
+
+
+/**
+ * @brief  Run one step of a measurement: start a conversion, fetch or
+ *         decode its result.
+ * @return Time in milliseconds until the next call
+ * @note   Global interrupts must be enabled.
+ */
+uint16_t climate_update(void);
+
+
+/**
+ * @brief  Read latest valid sample.
+ * @param  data Pointer to sample structure
+ * @return 1 if the sample is new since the previous call, 0 otherwise
+ *         (data then holds the previous sample, or zeros before the first)
+ */
+uint8_t climate_read(climate_data_t *data);
+
+
+/**
+ * @brief  Read number of sampling periods without a new sample in a row.
+ * @return 0 if the latest sample is fresh
+ */
+uint8_t climate_age(void);
+
+
+/**
+ * @brief  Read error and stale-data counters.
+ * @param  stats Pointer to counter structure
+ * @return none
+ */
+void climate_get_stats(climate_stats_t *stats);
+
+
+/**
+ * @brief  Compute CRC-8 used by Sensirion and Aosong sensors.
+ * @param  data Bytes to check
+ * @param  len Number of bytes
+ * @return CRC with polynomial 0x31 and initial value 0xff
+ */
+uint8_t climate_crc8(const uint8_t *data, uint8_t len);
+
+
+/** @} */
+
+#endif
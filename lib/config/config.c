@@ -0,0 +1,184 @@
+/*
+ * Persistent configuration in EEPROM for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <string.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+#include <config.h>
+#include <eeq.h>
+
+
+// -- Defines --------------------------------------------------------
+#define SLOT_ADDR(s) (CONFIG_START + (uint16_t)(s) * CONFIG_SLOT_SIZE)
+#define HEADER 2    // Version and sequence number
+#define NO_WRITE 0xff
+
+
+// -- Global variables -----------------------------------------------
+static uint8_t *cfg_data;
+static uint8_t cfg_size;
+static uint8_t cfg_version;
+static uint8_t cfg_slot;          // Slot with the newest copy
+static uint8_t cfg_seq;           // Its sequence number
+static uint8_t cfg_offset = NO_WRITE;  // Next byte of write in progress
+static uint8_t cfg_header[HEADER];
+static uint8_t cfg_crc[2];
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: config_crc()
+ * Purpose:  CRC-16/MODBUS of header and data of one slot.
+ * Input(s): header - Version and sequence number
+ *           data - Settings
+ *           size - Size of settings
+ * Returns:  CRC
+ */
+static uint16_t config_crc(const uint8_t *header, const uint8_t *data,
+                           uint8_t size)
+{
+    uint16_t crc = 0xffff;
+
+    crc = _crc16_update(crc, header[0]);
+    crc = _crc16_update(crc, header[1]);
+    while (size--)
+        crc = _crc16_update(crc, *data++);
+    return crc;
+}
+
+
+/*
+ * Function: slot_valid()
+ * Purpose:  Check version and CRC of a slot read from EEPROM.
+ * Input(s): slot - Slot contents
+ * Returns:  1 if valid, 0 otherwise
+ */
+static uint8_t slot_valid(const uint8_t *slot)
+{
+    uint16_t crc;
+
+    if (slot[0] != cfg_version)
+        return 0;
+    crc = config_crc(slot, slot + HEADER, cfg_size);
+    return (slot[HEADER + cfg_size] == (crc & 0xff) &&
+            slot[HEADER + cfg_size + 1] == (crc >> 8));
+}
+
+
+/*
+ * Function: config_load()
+ * Purpose:  Copy newest valid slot, or defaults, into settings.
+ * Input(s): data - Settings structure
+ *           size - Its size
+ *           version - Layout version
+ *           defaults - Default settings in program memory
+ * Returns:  Source of the settings
+ */
+uint8_t config_load(void *data, uint8_t size, uint8_t version,
+                    const void *defaults)
+{
+    uint8_t image[2*CONFIG_SLOT_SIZE];
+    uint8_t *a = image;
+    uint8_t *b = image + CONFIG_SLOT_SIZE;
+    uint8_t valid_a, valid_b;
+
+    cfg_data = data;
+    cfg_size = (size > CONFIG_DATA_MAX) ? CONFIG_DATA_MAX : size;
+    cfg_version = version;
+    cfg_offset = NO_WRITE;
+
+    eeprom_read_block(image, (const void *)CONFIG_START, sizeof(image));
+    valid_a = slot_valid(a);
+    valid_b = slot_valid(b);
+
+    // Both valid: the newer one, sequence numbers wrap around
+    if (valid_a && valid_b)
+        cfg_slot = ((int8_t)(b[1] - a[1]) > 0) ? CONFIG_SLOT_B : CONFIG_SLOT_A;
+    else if (valid_a)
+        cfg_slot = CONFIG_SLOT_A;
+    else if (valid_b)
+        cfg_slot = CONFIG_SLOT_B;
+    else {
+        // Next save goes to slot A
+        cfg_slot = CONFIG_SLOT_B;
+        cfg_seq = 0;
+        memcpy_P(data, defaults, cfg_size);
+        return CONFIG_DEFAULTS;
+    }
+
+    a = (cfg_slot == CONFIG_SLOT_A) ? a : b;
+    cfg_seq = a[1];
+    memcpy(data, a + HEADER, cfg_size);
+    return cfg_slot;
+}
+
+
+/*
+ * Function: config_save()
+ * Purpose:  Start writing the settings into the older slot.
+ * Returns:  none
+ */
+void config_save(void)
+{
+    uint16_t crc;
+
+    // Restarted write goes to the same slot, the newest one stays intact
+    if (cfg_offset == NO_WRITE) {
+        cfg_slot ^= 1;
+        cfg_seq++;
+    }
+    cfg_header[0] = cfg_version;
+    cfg_header[1] = cfg_seq;
+    crc = config_crc(cfg_header, cfg_data, cfg_size);
+    cfg_crc[0] = crc & 0xff;
+    cfg_crc[1] = crc >> 8;
+    cfg_offset = 0;
+}
+
+
+/*
+ * Function: config_update()
+ * Purpose:  Queue as many bytes of the write as the EEPROM queue takes.
+ * Returns:  1 while the write is in progress, 0 when done
+ */
+uint8_t config_update(void)
+{
+    const uint8_t *src;
+    uint8_t len;
+    uint8_t n;
+
+    while (cfg_offset != NO_WRITE) {
+        // Header, data and CRC follow each other in the slot
+        if (cfg_offset < HEADER) {
+            src = cfg_header + cfg_offset;
+            len = HEADER - cfg_offset;
+        }
+        else if (cfg_offset < HEADER + cfg_size) {
+            src = cfg_data + cfg_offset - HEADER;
+            len = HEADER + cfg_size - cfg_offset;
+        }
+        else {
+            src = cfg_crc + cfg_offset - HEADER - cfg_size;
+            len = HEADER + cfg_size + 2 - cfg_offset;
+        }
+
+        n = eeq_free();
+        if (n == 0)
+            return 1;
+        if (len > n)
+            len = n;
+        eeq_write(SLOT_ADDR(cfg_slot) + cfg_offset, src, len);
+        cfg_offset += len;
+
+        if (cfg_offset == HEADER + cfg_size + 2)
+            cfg_offset = NO_WRITE;
+    }
+    return 0;
+}
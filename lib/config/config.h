@@ -0,0 +1,108 @@
+#ifndef CONFIG_H
+# define CONFIG_H
+
+/*
+ * Persistent configuration in EEPROM for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup config Configuration Library <config.h>
+ * @code #include <config.h> @endcode
+ *
+ * @brief Application settings kept in two EEPROM copies with CRC.
+ *
+ * The settings are one structure of the application. EEPROM holds two
+ * slots (A and B), each with a copy of the structure:
+ *
+ *   | version | sequence | data     | CRC-16 |
+ *   | 1 B     | 1 B      | size B   | 2 B    |
+ *
+ * The CRC (CRC-16/MODBUS, as telem.h) covers version, sequence and data.
+ * config_load() reads both slots with one eeprom_read_block() and takes
+ * the valid slot with the newer sequence number; without one, or with
+ * another version, it copies the defaults from program memory.
+ *
+ * config_save() writes the structure into the other slot, so the newest
+ * complete copy always stays intact: when power fails during the write,
+ * the CRC of the new copy does not match and the old one is loaded. The
+ * bytes go through the EEPROM queue (eeq.h) a few at a time from
+ * config_update(), called from a task, and the program never waits for
+ * the EEPROM.
+ *
+ * @code
+ * config_load(&cfg, sizeof(cfg), CFG_VERSION, &cfg_defaults);
+ * cfg.threshold = 700;
+ * config_save();
+ * // in a task
+ * config_update();
+ * @endcode
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdint.h>
+
+
+// -- Defines --------------------------------------------------------
+/** @brief  EEPROM address of slot A, slot B follows */
+#ifndef CONFIG_START
+# define CONFIG_START 960
+#endif
+
+/** @brief  Size of one slot in bytes */
+#ifndef CONFIG_SLOT_SIZE
+# define CONFIG_SLOT_SIZE 32
+#endif
+
+/** @brief  Largest settings structure */
+#define CONFIG_DATA_MAX (CONFIG_SLOT_SIZE - 4)
+
+/** @brief  First EEPROM address after both slots */
+#define CONFIG_END (CONFIG_START + 2*CONFIG_SLOT_SIZE)
+
+/**
+ * @name  Source of loaded settings
+ */
+#define CONFIG_SLOT_A   0  /**< @brief Slot A */
+#define CONFIG_SLOT_B   1  /**< @brief Slot B */
+#define CONFIG_DEFAULTS 2  /**< @brief Defaults, no valid slot */
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Load settings from the newest valid slot.
+ * @param  data Settings structure, kept for config_save()
+ * @param  size Size of structure, at most CONFIG_DATA_MAX
+ * @param  version Layout version, increment when the structure changes
+ * @param  defaults Default settings in program memory
+ * @return CONFIG_SLOT_A, CONFIG_SLOT_B or CONFIG_DEFAULTS
+ * @note   Call before other EEPROM writes are queued (eeq.h), the
+ *         read does not share the EEPROM with the queue interrupt.
+ */
+uint8_t config_load(void *data, uint8_t size, uint8_t version,
+                    const void *defaults);
+
+
+/**
+ * @brief  Start writing the settings into the older slot.
+ * @return none
+ * @note   A write in progress starts again with the current values.
+ */
+void config_save(void);
+
+
+/**
+ * @brief  Pass next bytes of a started write to the EEPROM queue.
+ * @return 1 while the write is in progress, 0 otherwise
+ */
+uint8_t config_update(void);
+
+
+/** @} */
+
+#endif
@@ -0,0 +1,174 @@
+/*
+ * Command line console over UART for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdlib.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include <console.h>
+#include <uart.h>
+
+
+// -- Global variables -----------------------------------------------
+static const console_cmd_t *con_commands = 0;
+static uint8_t con_count;
+
+// Written by console_rx() in the interrupt until con_ready is set, then
+// read by console_poll() until it clears con_ready
+static char con_line[CONSOLE_LINE_MAX + 1];
+static char *con_argv[CONSOLE_MAX_ARGS];
+static uint8_t con_len = 0;
+static uint8_t con_argc = 0;
+static uint8_t con_in_token = 0;
+static uint8_t con_overflow = 0;
+static volatile uint8_t con_ready = 0;
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: console_init()
+ * Purpose:  Set command table and start accepting lines.
+ * Input(s): commands - Table in program memory
+ *           count - Number of commands
+ * Returns:  none
+ */
+void console_init(const console_cmd_t *commands, uint8_t count)
+{
+    con_count = count;
+    con_commands = commands;
+}
+
+
+/*
+ * Function: console_rx()
+ * Purpose:  Store one byte into the line and split it into tokens.
+ *           Runs in the UART receive interrupt.
+ * Input(s): data - Received byte
+ * Returns:  1 if taken, 0 if the console is not started
+ */
+uint8_t console_rx(uint8_t data)
+{
+    if (con_commands == 0)
+        return 0;
+    if (con_ready)
+        return 1;
+
+    if (data == '\r' || data == '\n') {
+        // Empty lines, also LF of CR LF, are ignored
+        if (con_argc == 0 && !con_overflow)
+            return 1;
+        con_line[con_len] = '\0';
+        con_ready = 1;
+        return 1;
+    }
+
+    if (data == ' ' || data == '\t') {
+        if (con_in_token) {
+            con_line[con_len++] = '\0';
+            con_in_token = 0;
+        }
+        return 1;
+    }
+
+    // Keep room for terminating zero, more tokens than argv overflow too
+    if (con_len >= CONSOLE_LINE_MAX - 1 ||
+        (!con_in_token && con_argc == CONSOLE_MAX_ARGS)) {
+        con_overflow = 1;
+        return 1;
+    }
+    if (!con_in_token) {
+        con_argv[con_argc++] = &con_line[con_len];
+        con_in_token = 1;
+    }
+    con_line[con_len++] = data;
+    return 1;
+}
+
+
+/*
+ * Function: console_help()
+ * Purpose:  Send names of all commands.
+ * Returns:  none
+ */
+static void console_help(void)
+{
+    for (uint8_t i = 0; i < con_count; i++) {
+        if (i > 0)
+            uart_putc(' ');
+        uart_puts_p(con_commands[i].name);
+    }
+    uart_puts_p(PSTR("\r\n"));
+}
+
+
+/*
+ * Function: console_poll()
+ * Purpose:  Find the command of a completed line and run it.
+ * Returns:  1 if a line was handled, 0 otherwise
+ */
+uint8_t console_poll(void)
+{
+    uint8_t result = CONSOLE_USAGE;
+    uint8_t i;
+
+    if (!con_ready)
+        return 0;
+
+    if (con_overflow) {
+        uart_puts_p(PSTR("ERR too long\r\n"));
+    }
+    else if (strcmp_P(con_argv[0], PSTR("help")) == 0) {
+        console_help();
+    }
+    else {
+        for (i = 0; i < con_count; i++) {
+            if (strcmp_P(con_argv[0], con_commands[i].name) == 0)
+                break;
+        }
+        if (i == con_count) {
+            uart_puts_p(PSTR("ERR unknown\r\n"));
+        }
+        else {
+            console_fn_t fn = (console_fn_t)pgm_read_ptr(&con_commands[i].fn);
+
+            result = fn(con_argc, con_argv);
+            if (result == CONSOLE_OK)
+                uart_puts_p(PSTR("OK\r\n"));
+            else if (result == CONSOLE_USAGE)
+                uart_puts_p(PSTR("ERR usage\r\n"));
+            else if (result == CONSOLE_RANGE)
+                uart_puts_p(PSTR("ERR range\r\n"));
+        }
+    }
+
+    // Next line; the interrupt writes again once con_ready is cleared,
+    // so the other variables must be reset before it
+    con_len = 0;
+    con_argc = 0;
+    con_in_token = 0;
+    con_overflow = 0;
+    __asm__ __volatile__ ("" ::: "memory");
+    con_ready = 0;
+    return 1;
+}
+
+
+/*
+ * Function: console_number()
+ * Purpose:  Convert decimal token to number.
+ * Input(s): arg - Token
+ *           value - Pointer to result
+ * Returns:  1 if the whole token is a number, 0 otherwise
+ */
+uint8_t console_number(const char *arg, int32_t *value)
+{
+    char *end;
+
+    *value = strtol(arg, &end, 10);
+    return (end != arg && *end == '\0');
+}
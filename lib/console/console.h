@@ -0,0 +1,124 @@
+#ifndef CONSOLE_H
+# define CONSOLE_H
+
+/*
+ * Command line console over UART for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup console Console Library <console.h>
+ * @code #include <console.h> @endcode
+ *
+ * @brief Text commands received over UART, dispatched from a table.
+ *
+ * console_rx() is called by the UART receive interrupt with each byte
+ * (build flag -DUART_RX_HOOK=console_rx, see uart.c). It tokenizes the
+ * line as the bytes arrive: each byte is stored once into the line
+ * buffer, spaces end the tokens and the start of each token is recorded.
+ * A CR or LF completes the line. Until console_poll() has run its
+ * command, further bytes are dropped.
+ *
+ * console_poll(), called from a task, looks up the first token in a
+ * command table in program memory and calls the handler with the
+ * tokens as argc/argv. "OK" or "ERR <reason>" is sent after each
+ * command; "help" lists the commands.
+ *
+ * @code
+ * uint8_t cmd_led(uint8_t argc, char *argv[]);
+ * static const console_cmd_t commands[] PROGMEM = {
+ *     {"led", cmd_led},
+ * };
+ * console_init(commands, 1);
+ * // in a task
+ * console_poll();
+ * @endcode
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdint.h>
+
+
+// -- Defines --------------------------------------------------------
+/** @brief  Longest line in characters, longer lines are rejected */
+#ifndef CONSOLE_LINE_MAX
+# define CONSOLE_LINE_MAX 32
+#endif
+
+/** @brief  Most tokens of one line, including the command */
+#ifndef CONSOLE_MAX_ARGS
+# define CONSOLE_MAX_ARGS 4
+#endif
+
+/** @brief  Size of command name, including terminating zero */
+#define CONSOLE_NAME_SIZE 8
+
+/**
+ * @name  Results of command handlers
+ */
+#define CONSOLE_OK    0  /**< @brief Done, "OK" is sent */
+#define CONSOLE_USAGE 1  /**< @brief Wrong arguments */
+#define CONSOLE_RANGE 2  /**< @brief Value out of range */
+#define CONSOLE_QUIET 3  /**< @brief Done, handler sent its own reply */
+
+
+// -- Types ----------------------------------------------------------
+/**
+ * @brief  Command handler.
+ * @param  argc Number of tokens, at least 1
+ * @param  argv Tokens, argv[0] is the command name
+ * @return CONSOLE_OK or other result
+ */
+typedef uint8_t (*console_fn_t)(uint8_t argc, char *argv[]);
+
+/**
+ * @brief  One entry of the command table, stored in program memory.
+ */
+typedef struct {
+    char name[CONSOLE_NAME_SIZE];  /**< @brief Command name */
+    console_fn_t fn;               /**< @brief Handler */
+} console_cmd_t;
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Set command table and start accepting lines.
+ * @param  commands Table in program memory
+ * @param  count Number of commands
+ * @return none
+ */
+void console_init(const console_cmd_t *commands, uint8_t count);
+
+
+/**
+ * @brief  Tokenize one received byte, called from UART receive interrupt.
+ * @param  data Received byte
+ * @return 1 if the byte was taken by the console, 0 before console_init()
+ */
+uint8_t console_rx(uint8_t data);
+
+
+/**
+ * @brief  Run the command of a completed line.
+ * @return 1 if a line was handled, 0 if none is complete
+ */
+uint8_t console_poll(void);
+
+
+/**
+ * @brief  Convert decimal argument to number.
+ * @param  arg Token
+ * @param  value Pointer to result
+ * @return 1 if the whole token is a number, 0 otherwise
+ */
+uint8_t console_number(const char *arg, int32_t *value);
+
+
+/** @} */
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * Main screen of the plant monitor on the OLED for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <avr/pgmspace.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <dashboard.h>
+#include <oled.h>
+
+
+// -- Global variables -----------------------------------------------
+static const char light_names[][5] PROGMEM = {"Noc ", "Den "};
+static const char soil_names[][5] PROGMEM = {"Wet ", "Dry ", "Out "};
+static const char water_names[][7] PROGMEM = {"Zalito", "Zalij "};
+static const char window_names[][14] PROGMEM = {"Okno zavreno ", "Okno otevreno"};
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: sprint_tenths()
+ * Purpose:  Print value in tenths with one decimal; the sign is printed
+ *           separately as -0.5 has zero integer part.
+ * Input(s): s - Destination string
+ *           value - Value in tenths
+ * Returns:  Pointer to the terminating zero
+ */
+static char *sprint_tenths(char *s, int16_t value)
+{
+    return s + sprintf_P(s, PSTR("%s%d.%d"), value < 0 ? "-" : "",
+                         abs(value) / 10, abs(value) % 10);
+}
+
+
+/*
+ * Function: dashboard_setup()
+ * Purpose:  Clear the screen, draw title and labels, update display.
+ * Returns:  none
+ */
+void dashboard_setup(void)
+{
+    oled_clrscr();
+
+    // Title in normal size, second line shows 1-h temperature range
+    oled_charMode(NORMALSIZE);
+    oled_puts_p(PSTR("KYTKA DATA"));
+
+    oled_gotoxy(0, 2);
+    oled_puts_p(PSTR("Svetlo: "));
+    oled_gotoxy(0, 3);
+    oled_puts_p(PSTR("Vlh. pudy: "));
+    oled_gotoxy(0, 4);
+    oled_puts_p(PSTR("Tep. vzduch: "));
+    oled_gotoxy(0, 5);
+    oled_puts_p(PSTR("Vlh. vzduch: "));
+    oled_gotoxy(0, 6);
+    oled_puts_p(PSTR("STAV: "));
+
+#ifdef GRAPHICMODE
+    // Copy buffer to display RAM
+    oled_display();
+#endif
+}
+
+
+/*
+ * Function: dashboard_draw()
+ * Purpose:  Redraw value fields and update display.
+ * Input(s): d - Values
+ *           fields - Fields to redraw, DASH_* flags
+ * Returns:  none
+ */
+void dashboard_draw(const dashboard_t *d, uint8_t fields)
+{
+    char msg[24];
+
+    if (fields == 0)
+        return;
+
+    if (fields & DASH_LIGHT) {
+        oled_gotoxy(14, 2);
+        oled_puts_p(light_names[d->light]);
+    }
+    if (fields & DASH_SOIL) {
+        oled_gotoxy(14, 3);
+        oled_puts_p(soil_names[d->soil]);
+    }
+    if (fields & DASH_TEMP) {
+        oled_gotoxy(14, 4);
+        strcpy_P(sprint_tenths(msg, d->temperature), PSTR(" C  "));
+        oled_puts(msg);
+    }
+    if (fields & DASH_HUM) {
+        oled_gotoxy(14, 5);
+        strcpy_P(sprint_tenths(msg, d->humidity), PSTR(" %  "));
+        oled_puts(msg);
+    }
+    if (fields & DASH_WATER) {
+        oled_gotoxy(14, 6);
+        oled_puts_p(water_names[d->water]);
+    }
+    if (fields & DASH_WINDOW) {
+        oled_gotoxy(5, 7);
+        oled_puts_p(window_names[d->window]);
+    }
+    if ((fields & DASH_RANGE) && d->range_valid) {
+        char *p;
+
+        oled_gotoxy(0, 1);
+        strcpy_P(msg, PSTR("1h "));
+        p = sprint_tenths(msg + 3, d->range_min);
+        strcpy_P(p, PSTR(".."));
+        p = sprint_tenths(p + 2, d->range_max);
+        strcpy_P(p, PSTR(" C  "));
+        oled_puts(msg);
+    }
+
+#ifdef GRAPHICMODE
+    // Update OLED display
+    oled_display();
+#endif
+}
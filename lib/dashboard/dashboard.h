@@ -0,0 +1,84 @@
+#ifndef DASHBOARD_H
+# define DASHBOARD_H
+
+/*
+ * Main screen of the plant monitor on the OLED for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup dashboard Dashboard Library <dashboard.h>
+ * @code #include <dashboard.h> @endcode
+ *
+ * @brief Labels and value fields of the main screen.
+ *
+ * dashboard_setup() draws the fixed labels once. dashboard_draw()
+ * redraws only the fields given by a mask of DASH_* flags. In
+ * GRAPHICMODE of the OLED library it then copies the buffer to the
+ * display; the firmware builds with TEXTMODE, where characters go to the
+ * display directly and no 1 KB buffer is kept. The firmware and the
+ * simavr benchmark (test/bench) both draw through this library, so the
+ * benchmark measures the real screen.
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdint.h>
+
+
+// -- Defines --------------------------------------------------------
+/** @brief  Fields of dashboard_draw() */
+#define DASH_LIGHT  (1<<0)  /**< @brief Day/night */
+#define DASH_SOIL   (1<<1)  /**< @brief Soil state */
+#define DASH_TEMP   (1<<2)  /**< @brief Air temperature */
+#define DASH_HUM    (1<<3)  /**< @brief Air humidity */
+#define DASH_WATER  (1<<4)  /**< @brief Watering state */
+#define DASH_WINDOW (1<<5)  /**< @brief Window state */
+#define DASH_RANGE  (1<<6)  /**< @brief 1-h temperature range */
+#define DASH_ALL    0x7f
+
+
+// -- Types ----------------------------------------------------------
+/**
+ * @brief  Values shown on the screen.
+ */
+typedef struct {
+    uint8_t light;        /**< @brief 0 night, 1 day */
+    uint8_t soil;         /**< @brief 0 wet, 1 dry, 2 out of soil */
+    uint8_t water;        /**< @brief 0 watered, 1 watering needed */
+    uint8_t window;       /**< @brief 0 closed, 1 open */
+    int16_t temperature;  /**< @brief Air temperature in tenths of deg C */
+    int16_t humidity;     /**< @brief Air humidity in tenths of percent */
+    uint8_t range_valid;  /**< @brief Range below is known */
+    int16_t range_min;    /**< @brief 1-h minimum temperature in tenths */
+    int16_t range_max;    /**< @brief 1-h maximum temperature in tenths */
+} dashboard_t;
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Clear the screen, draw title and labels, update display.
+ * @return none
+ * @note   oled_init() must be called first.
+ */
+void dashboard_setup(void);
+
+
+/**
+ * @brief  Redraw value fields and update display.
+ * @param  d Values
+ * @param  fields Fields to redraw, DASH_* flags
+ * @return none
+ * @note   The range field keeps its last content while range_valid is
+ *         0. Nothing is sent to the display if fields is 0.
+ */
+void dashboard_draw(const dashboard_t *d, uint8_t fields);
+
+
+/** @} */
+
+#endif
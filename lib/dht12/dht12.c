@@ -0,0 +1,106 @@
+/*
+ * DHT12 temperature and humidity sensor driver for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <dht12.h>
+#include <twi.h>
+#include <avr/pgmspace.h>
+
+
+// -- Defines --------------------------------------------------------
+// Internal memory of the sensor
+#define DHT12_MEM_HUM   0  // First of the 5 data bytes
+#define DHT12_DATA_LEN  5
+
+// Sensor range in tenths, -20 to 60 deg C and 20 to 95 % with margin
+#define DHT12_TEMP_MIN (-250)
+#define DHT12_TEMP_MAX 650
+#define DHT12_HUM_MAX  1000
+
+
+// -- Global variables -----------------------------------------------
+static const char dht12_name[] PROGMEM = "DHT12";
+static const uint8_t dht12_mem = DHT12_MEM_HUM;
+static uint8_t dht12_raw[DHT12_DATA_LEN];  // Filled by TWI interrupt
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: dht12_probe()
+ * Purpose:  Test presence of the sensor.
+ * Returns:  1 if present, 0 otherwise
+ */
+static uint8_t dht12_probe(void)
+{
+    return twi_test_address(DHT12_ADR) == 0;
+}
+
+
+/*
+ * Function: dht12_fetch()
+ * Purpose:  Start reading of all data bytes in background.
+ * Returns:  CLIMATE_BUSY if started
+ */
+static uint8_t dht12_fetch(void)
+{
+    return twi_async_start(DHT12_ADR, &dht12_mem, 1,
+                           dht12_raw, DHT12_DATA_LEN);
+}
+
+
+/*
+ * Function: dht12_result()
+ * Purpose:  Decode fetched data bytes.
+ * Input(s): data - Pointer to sample structure
+ * Returns:  CLIMATE_OK, CLIMATE_CHECKSUM or CLIMATE_RANGE
+ */
+static uint8_t dht12_result(climate_data_t *data)
+{
+    return dht12_decode(dht12_raw, data);
+}
+
+
+/*
+ * Function: dht12_decode()
+ * Purpose:  Decode 5 raw data bytes.
+ * Input(s): raw - Data bytes in order of sensor memory
+ *           data - Pointer to sample structure
+ * Returns:  CLIMATE_OK, CLIMATE_CHECKSUM or CLIMATE_RANGE
+ */
+uint8_t dht12_decode(const uint8_t *raw, climate_data_t *data)
+{
+    uint16_t humidity;
+    int16_t temperature;
+
+    if ((uint8_t)(raw[0] + raw[1] + raw[2] + raw[3]) != raw[4])
+        return CLIMATE_CHECKSUM;
+
+    // Decimal parts are 0 to 9, bit 7 of temperature decimal is sign
+    humidity = raw[0]*10 + raw[1];
+    temperature = raw[2]*10 + (raw[3] & 0x7f);
+    if (raw[3] & 0x80)
+        temperature = -temperature;
+
+    if ((raw[1] > 9) || ((raw[3] & 0x7f) > 9) || (humidity > DHT12_HUM_MAX)
+        || (temperature < DHT12_TEMP_MIN) || (temperature > DHT12_TEMP_MAX))
+        return CLIMATE_RANGE;
+
+    data->temperature = temperature;
+    data->humidity = humidity;
+    return CLIMATE_OK;
+}
+
+
+const climate_driver_t dht12_driver PROGMEM = {
+    .name = dht12_name,
+    .probe = dht12_probe,
+    .start = 0,
+    .fetch = dht12_fetch,
+    .decode = dht12_result,
+    .conv_ms = 0,
+};
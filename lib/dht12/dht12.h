@@ -0,0 +1,53 @@
+#ifndef DHT12_H
+# define DHT12_H
+
+/*
+ * DHT12 temperature and humidity sensor driver for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup dht12 DHT12 Sensor Library <dht12.h>
+ * @code #include <dht12.h> @endcode
+ *
+ * @brief Driver of DHT12 sensor on I2C bus for the climate layer.
+ *
+ * The sensor converts on its own. All 5 data bytes (humidity,
+ * temperature and checksum) are read in one background TWI transaction.
+ * A sample is valid only with a correct checksum and plausible values.
+ * Use the driver through climate.h.
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <climate.h>
+
+
+// -- Defines --------------------------------------------------------
+/** @brief  I2C slave address of DHT12 */
+#define DHT12_ADR 0x5c
+
+
+// -- Global variables -----------------------------------------------
+/** @brief  Operations of DHT12 for climate_init(), in program memory */
+extern const climate_driver_t dht12_driver;
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Decode 5 raw data bytes.
+ * @param  raw Humidity integer and decimal, temperature integer and
+ *         decimal (bit 7 set for negative values), checksum
+ * @param  data Pointer to sample structure, changed only if valid
+ * @return CLIMATE_OK, CLIMATE_CHECKSUM or CLIMATE_RANGE
+ */
+uint8_t dht12_decode(const uint8_t *raw, climate_data_t *data);
+
+
+/** @} */
+
+#endif
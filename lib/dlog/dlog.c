@@ -0,0 +1,125 @@
+/*
+ * Deferred binary log for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <dlog.h>
+#include <telem.h>
+#include <timebase.h>
+#include <uart.h>
+
+
+// -- Defines --------------------------------------------------------
+#define DLOG_MASK (DLOG_SIZE - 1)
+#define RECORD_VALUES 4     // Identifier, time and two arguments
+#define FRAME_RECORDS (TELEM_MAX_CHANNELS / RECORD_VALUES)
+
+
+// -- Types ----------------------------------------------------------
+typedef struct {
+    uint8_t id;
+    uint16_t time;
+    uint16_t arg[2];
+} dlog_record_t;
+
+
+// -- Global variables -----------------------------------------------
+static dlog_record_t dlog_ring[DLOG_SIZE];
+static volatile uint8_t dlog_head = 0;  // Next record to write
+static volatile uint8_t dlog_tail = 0;  // Next record to send
+static volatile uint16_t dlog_dropped = 0;
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: dlog_put()
+ * Purpose:  Store one record. Interrupts are disabled while it is
+ *           written, an interrupt logging meanwhile would take the
+ *           same slot; the record is published by moving the head.
+ * Input(s): id - Message identifier
+ *           a, b - Arguments
+ * Returns:  none
+ */
+void dlog_put(uint8_t id, uint16_t a, uint16_t b)
+{
+    uint16_t time = millis();
+    uint8_t sreg = SREG;
+    uint8_t head;
+    dlog_record_t *r;
+
+    cli();
+    head = dlog_head;
+    if (((head + 1) & DLOG_MASK) == dlog_tail) {
+        if (dlog_dropped != 0xffff)
+            dlog_dropped++;
+    }
+    else {
+        r = &dlog_ring[head];
+        r->id = id;
+        r->time = time;
+        r->arg[0] = a;
+        r->arg[1] = b;
+        dlog_head = (head + 1) & DLOG_MASK;
+    }
+    SREG = sreg;
+}
+
+
+/*
+ * Function: dlog_flush()
+ * Purpose:  Send records as telemetry frames while the UART has room,
+ *           first the number of dropped records if there are any.
+ * Input(s): none
+ * Returns:  Number of records still waiting
+ */
+uint8_t dlog_flush(void)
+{
+    int16_t values[TELEM_MAX_CHANNELS];
+    uint8_t tail = dlog_tail;
+    uint8_t n;
+
+    while (1) {
+        if (tail == dlog_head && dlog_dropped == 0)
+            return 0;
+        // Room for a whole frame, nothing is taken from the ring before
+        if (uart_tx_free() < TELEM_FRAME_MAX(TELEM_MAX_CHANNELS))
+            return (dlog_head - tail) & DLOG_MASK;
+
+        // Only this function moves the tail, records up to the head
+        // are complete
+        n = 0;
+        if (dlog_dropped) {
+            uint16_t dropped;
+            uint8_t sreg = SREG;
+
+            cli();
+            dropped = dlog_dropped;
+            dlog_dropped = 0;
+            SREG = sreg;
+            values[0] = DLOG_DROPPED;
+            values[1] = millis();
+            values[2] = dropped;
+            values[3] = 0;
+            n = 1;
+        }
+        while (n < FRAME_RECORDS && tail != dlog_head) {
+            const dlog_record_t *r = &dlog_ring[tail];
+            int16_t *v = &values[n * RECORD_VALUES];
+
+            v[0] = r->id;
+            v[1] = r->time;
+            v[2] = r->arg[0];
+            v[3] = r->arg[1];
+            tail = (tail + 1) & DLOG_MASK;
+            n++;
+        }
+        telem_send(TELEM_TYPE_LOG, millis(), values, n * RECORD_VALUES);
+        dlog_tail = tail;
+    }
+}
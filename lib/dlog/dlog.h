@@ -0,0 +1,95 @@
+#ifndef DLOG_H
+# define DLOG_H
+
+/*
+ * Deferred binary log for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup dlog Deferred Log Library <dlog.h>
+ * @code #include <dlog.h> @endcode
+ *
+ * @brief Log records formatted on the host, not on the microcontroller.
+ *
+ * A log statement stores only a message identifier, a 16-bit timestamp
+ * in milliseconds and two 16-bit arguments into a ring of records,
+ * which takes a few dozen cycles and keeps the timing of the calling
+ * code. Messages are listed in include/dlog_messages.def; the firmware
+ * gets identifiers from it, the host decoder gets format strings, so no
+ * text is stored in flash:
+ *
+ * @code
+ * // dlog_messages.def
+ * DLOG_MSG(CLASS, "classifier %u changed to state %u")
+ *
+ * DLOG(CLASS, 2, state);
+ * @endcode
+ *
+ * dlog_flush(), called by a low-priority task, sends records as
+ * telemetry frames of type TELEM_TYPE_LOG, two records per frame, while
+ * the UART has room. tools/telem_decode.c prints them as text.
+ *
+ * A record is written with interrupts disabled for a few cycles, so
+ * interrupt service routines may log too; dlog_flush() reads the ring
+ * without disabling interrupts. When the ring is full, records are
+ * dropped and counted, the count is sent as message DLOG_DROPPED.
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdint.h>
+
+
+// -- Defines --------------------------------------------------------
+/** @brief  Records in the ring, power of 2 up to 128; each takes 7 B */
+#ifndef DLOG_SIZE
+# define DLOG_SIZE 16
+#endif
+
+#if DLOG_SIZE > 128 || (DLOG_SIZE & (DLOG_SIZE - 1))
+# error "DLOG_SIZE must be a power of 2 up to 128"
+#endif
+
+/** @brief  Message identifiers, DLOG_<name> of dlog_messages.def */
+enum {
+    DLOG_DROPPED = 0,  /**< @brief Records lost, ring was full */
+#define DLOG_MSG(name, format) DLOG_##name,
+#include "dlog_messages.def"
+#undef DLOG_MSG
+    DLOG_COUNT
+};
+
+/**
+ * @brief  Log one message with two arguments.
+ * @param  name Message name from dlog_messages.def, without DLOG_
+ */
+#define DLOG(name, a, b) dlog_put(DLOG_##name, (a), (b))
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Store one record, or count it as dropped if the ring is full.
+ * @param  id Message identifier
+ * @param  a First argument
+ * @param  b Second argument
+ * @return none
+ * @note   May be called from interrupt service routines.
+ */
+void dlog_put(uint8_t id, uint16_t a, uint16_t b);
+
+
+/**
+ * @brief  Send stored records while the UART has room.
+ * @return Number of records still waiting
+ */
+uint8_t dlog_flush(void);
+
+
+/** @} */
+
+#endif
@@ -0,0 +1,371 @@
+/*
+ * Circular EEPROM data logger for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <eelog.h>
+#include <eeq.h>
+
+
+// -- Defines --------------------------------------------------------
+#define SEQ_NONE    0xffff  // Erased or invalidated block
+#define NIBBLE_ESC  14      // Delta follows as varint
+#define END_MARK    0xff    // No more records in block
+#define NIBBLE_BYTES ((EELOG_CHANNELS + 1) / 2)
+// Nibbles and a 3-byte varint of each channel
+#define RECORD_MAX  (NIBBLE_BYTES + 3*EELOG_CHANNELS)
+
+#define BLOCK_ADDR(b) (EELOG_START + (uint16_t)(b) * EELOG_BLOCK_SIZE)
+
+// Queued bytes of write_header(): invalidated sequence number, body with
+// end mark and cleared byte, sequence number
+#define HEADER_WRITE (EELOG_HEADER + 4)
+
+// A record can follow a new block header while it is still queued
+_Static_assert(HEADER_WRITE + RECORD_MAX + 1 <= EEQ_SIZE,
+               "EEQ_SIZE too small for a block header and one record");
+
+
+// -- Global variables -----------------------------------------------
+static uint8_t log_block;          // Block being filled
+static uint8_t log_offset;         // Next free byte, 0 for new block
+static uint16_t log_seq;           // Sequence number of log_block
+static uint8_t log_boot;
+static uint16_t log_index = 0;     // Samples since boot
+static int16_t log_prev[EELOG_CHANNELS];
+static uint16_t log_dropped = 0;
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: seq_next()
+ * Purpose:  Increment block sequence number, skip the invalid value.
+ * Input(s): seq - Sequence number
+ * Returns:  Following sequence number
+ */
+static uint16_t seq_next(uint16_t seq)
+{
+    seq++;
+    return (seq == SEQ_NONE) ? 0 : seq;
+}
+
+
+/*
+ * Function: block_seq()
+ * Purpose:  Read sequence number of one block.
+ * Input(s): block - Block number
+ * Returns:  Sequence number, SEQ_NONE for unused block
+ */
+static uint16_t block_seq(uint8_t block)
+{
+    uint8_t buf[2];
+
+    eeq_read(BLOCK_ADDR(block), buf, 2);
+    return buf[0] | (buf[1] << 8);
+}
+
+
+/*
+ * Function: newest_block()
+ * Purpose:  Find the last written block, the one whose follower does not
+ *           continue its sequence.
+ * Input(s): seq - Pointer to sequence number of the found block
+ * Returns:  Block number, EELOG_BLOCKS if the log is empty
+ */
+static uint8_t newest_block(uint16_t *seq)
+{
+    uint16_t s;
+    uint16_t next = block_seq(0);
+
+    for (uint8_t b = 0; b < EELOG_BLOCKS; b++) {
+        s = next;
+        next = block_seq((b + 1) % EELOG_BLOCKS);
+        if (s != SEQ_NONE && next != seq_next(s)) {
+            *seq = s;
+            return b;
+        }
+    }
+    return EELOG_BLOCKS;
+}
+
+
+/*
+ * Function: eelog_init()
+ * Purpose:  Find the newest block and prepare a new one for this boot.
+ * Returns:  none
+ */
+void eelog_init(void)
+{
+    uint16_t seq = SEQ_NONE;
+    uint8_t newest = newest_block(&seq);
+
+    if (newest == EELOG_BLOCKS) {
+        // Empty log, first block follows
+        log_block = EELOG_BLOCKS - 1;
+        log_seq = SEQ_NONE;
+        log_boot = 0;
+    }
+    else {
+        log_block = newest;
+        log_seq = seq;
+        eeq_read(BLOCK_ADDR(newest) + 2, &log_boot, 1);
+        log_boot++;
+    }
+    log_offset = 0;
+    log_index = 0;
+    log_dropped = 0;
+}
+
+
+/*
+ * Function: write_header()
+ * Purpose:  Start next block with a keyframe of the sample.
+ * Input(s): value - Values of all channels
+ * Returns:  0 if queued, 1 if the write queue is full
+ */
+static uint8_t write_header(const int16_t *value)
+{
+    static const uint8_t none[2] = {0xff, 0xff};
+    uint8_t buf[EELOG_HEADER + 2];
+    uint8_t block = (log_block + 1) % EELOG_BLOCKS;
+    uint16_t seq = seq_next(log_seq);
+    uint8_t i;
+
+    // Invalidate, write body and end mark, then validate the block, so a
+    // reset in between never leaves old sequence number with new data
+    if (eeq_free() < HEADER_WRITE)
+        return 1;
+
+    buf[0] = seq;
+    buf[1] = seq >> 8;
+    buf[2] = log_boot;
+    buf[3] = log_index;
+    buf[4] = log_index >> 8;
+    for (i = 0; i < EELOG_CHANNELS; i++) {
+        buf[5 + 2*i] = value[i];
+        buf[6 + 2*i] = value[i] >> 8;
+    }
+    // Clear the byte after the end mark too, no data of the previous use
+    // of the block follows the keyframe
+    buf[EELOG_HEADER] = END_MARK;
+    buf[EELOG_HEADER + 1] = END_MARK;
+
+    eeq_write(BLOCK_ADDR(block), none, 2);
+    eeq_write(BLOCK_ADDR(block) + 2, &buf[2], sizeof(buf) - 2);
+    eeq_write(BLOCK_ADDR(block), buf, 2);
+
+    log_block = block;
+    log_seq = seq;
+    log_offset = EELOG_HEADER;
+    return 0;
+}
+
+
+/*
+ * Function: encode()
+ * Purpose:  Encode deltas of one sample into record.
+ * Input(s): value - Values of all channels
+ *           rec - Buffer of RECORD_MAX bytes
+ * Returns:  Length of record
+ */
+static uint8_t encode(const int16_t *value, uint8_t *rec)
+{
+    uint8_t len = NIBBLE_BYTES;
+    uint8_t nibble;
+    uint16_t zz;
+    int16_t d;
+
+    for (uint8_t i = 0; i < NIBBLE_BYTES; i++)
+        rec[i] = 0;
+
+    for (uint8_t i = 0; i < EELOG_CHANNELS; i++) {
+        d = value[i] - log_prev[i];
+        // Zig-zag: 0, -1, 1, -2, ... to 0, 1, 2, 3, ...
+        zz = ((uint16_t)d << 1) ^ (uint16_t)(d >> 15);
+        if (zz < NIBBLE_ESC) {
+            nibble = zz;
+        }
+        else {
+            nibble = NIBBLE_ESC;
+            while (zz >= 0x80) {
+                rec[len++] = (zz & 0x7f) | 0x80;
+                zz >>= 7;
+            }
+            rec[len++] = zz;
+        }
+        rec[i/2] |= (i & 1) ? nibble : (nibble << 4);
+    }
+    return len;
+}
+
+
+/*
+ * Function: eelog_append()
+ * Purpose:  Append one sample to the log.
+ * Input(s): value - Values of all channels
+ * Returns:  0 if queued, 1 if the write queue is full
+ */
+uint8_t eelog_append(const int16_t *value)
+{
+    uint8_t rec[RECORD_MAX + 1];
+    uint8_t len = 0;
+
+    if (log_offset != 0) {
+        len = encode(value, rec);
+        if (log_offset + len + 1 > EELOG_BLOCK_SIZE)
+            // Record and end mark do not fit, start new block
+            log_offset = 0;
+    }
+
+    if (log_offset == 0) {
+        if (write_header(value)) {
+            log_dropped++;
+            return 1;
+        }
+    }
+    else {
+        rec[len] = END_MARK;
+        if (eeq_write(BLOCK_ADDR(log_block) + log_offset, rec, len + 1)) {
+            log_dropped++;
+            return 1;
+        }
+        log_offset += len;
+    }
+
+    for (uint8_t i = 0; i < EELOG_CHANNELS; i++)
+        log_prev[i] = value[i];
+    log_index++;
+    return 0;
+}
+
+
+/*
+ * Function: eelog_dropped()
+ * Purpose:  Read number of samples lost because of full write queue.
+ * Returns:  Number of lost samples
+ */
+uint16_t eelog_dropped(void)
+{
+    return log_dropped;
+}
+
+
+/*
+ * Function: eelog_rewind()
+ * Purpose:  Start reading from the oldest sample.
+ * Input(s): it - Pointer to reading position
+ * Returns:  none
+ */
+void eelog_rewind(eelog_iter_t *it)
+{
+    uint16_t seq;
+    uint8_t newest;
+
+    eeq_flush();
+    newest = newest_block(&seq);
+    it->block = (newest + 1) % EELOG_BLOCKS;
+    it->left = (newest == EELOG_BLOCKS) ? 0 : EELOG_BLOCKS;
+    it->offset = 0;
+}
+
+
+/*
+ * Function: read_header()
+ * Purpose:  Read keyframe of current block.
+ * Input(s): it - Pointer to reading position
+ * Returns:  1 if the block is valid, 0 otherwise
+ */
+static uint8_t read_header(eelog_iter_t *it)
+{
+    uint8_t buf[EELOG_HEADER];
+
+    eeq_read(BLOCK_ADDR(it->block), buf, EELOG_HEADER);
+    if ((buf[0] | (buf[1] << 8)) == SEQ_NONE)
+        return 0;
+
+    it->s.boot = buf[2];
+    it->s.index = buf[3] | (buf[4] << 8);
+    for (uint8_t i = 0; i < EELOG_CHANNELS; i++)
+        it->s.value[i] = buf[5 + 2*i] | (buf[6 + 2*i] << 8);
+    it->offset = EELOG_HEADER;
+    return 1;
+}
+
+
+/*
+ * Function: read_record()
+ * Purpose:  Decode one record and apply its deltas.
+ * Input(s): it - Pointer to reading position
+ * Returns:  1 if a record has been read, 0 at the end of block
+ */
+static uint8_t read_record(eelog_iter_t *it)
+{
+    uint16_t addr = BLOCK_ADDR(it->block);
+    uint8_t nibbles[NIBBLE_BYTES];
+    uint8_t offset = it->offset;
+    uint8_t nibble;
+    uint8_t b;
+    uint8_t shift;
+    uint16_t zz;
+
+    if (offset + NIBBLE_BYTES > EELOG_BLOCK_SIZE)
+        return 0;
+    eeq_read(addr + offset, nibbles, NIBBLE_BYTES);
+    if (nibbles[0] == END_MARK)
+        return 0;
+    offset += NIBBLE_BYTES;
+
+    for (uint8_t i = 0; i < EELOG_CHANNELS; i++) {
+        nibble = (i & 1) ? (nibbles[i/2] & 0x0f) : (nibbles[i/2] >> 4);
+        if (nibble == NIBBLE_ESC) {
+            zz = 0;
+            shift = 0;
+            do {
+                eeq_read(addr + offset++, &b, 1);
+                zz |= (uint16_t)(b & 0x7f) << shift;
+                shift += 7;
+            } while ((b & 0x80) && offset < EELOG_BLOCK_SIZE);
+        }
+        else
+            zz = nibble;
+        it->s.value[i] += (int16_t)((zz >> 1) ^ -(zz & 1));
+    }
+
+    it->s.index++;
+    it->offset = offset;
+    return 1;
+}
+
+
+/*
+ * Function: eelog_next()
+ * Purpose:  Read next sample.
+ * Input(s): it - Pointer to reading position
+ *           sample - Pointer to sample structure
+ * Returns:  1 if a sample has been read, 0 at the end of the log
+ */
+uint8_t eelog_next(eelog_iter_t *it, eelog_sample_t *sample)
+{
+    uint8_t found;
+
+    while (it->left != 0) {
+        if (it->offset == 0)
+            found = read_header(it);
+        else
+            found = read_record(it);
+
+        if (found) {
+            *sample = it->s;
+            return 1;
+        }
+        // End of block
+        it->block = (it->block + 1) % EELOG_BLOCKS;
+        it->left--;
+        it->offset = 0;
+    }
+    return 0;
+}
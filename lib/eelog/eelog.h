@@ -0,0 +1,143 @@
+#ifndef EELOG_H
+# define EELOG_H
+
+/*
+ * Circular EEPROM data logger for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup eelog EEPROM Logger Library <eelog.h>
+ * @code #include <eelog.h> @endcode
+ *
+ * @brief Periodic samples of several channels stored in EEPROM.
+ *
+ * The log area is divided into blocks which are filled in a circle, so
+ * every cell is written about once per turn of the log (wear leveling).
+ * Each block starts with a header: block sequence number, boot counter,
+ * index of the sample since boot and full values of all channels
+ * (keyframe). Each following sample is stored as a record of deltas to
+ * the previous one:
+ *
+ *   - one nibble per channel (two channels per byte, high nibble first)
+ *     with zig-zag delta 0 to 13 (delta -7 to +6)
+ *   - nibble 14 is an escape, the zig-zag delta follows after the
+ *     nibbles as a varint (7 bits per byte, LSB first)
+ *   - nibble 15 never occurs, so byte 0xff marks the end of records
+ *
+ * Each record is written together with a trailing 0xff, which is
+ * overwritten by the next record. All writes go through eeq.h and do not
+ * block. A new block is started after each reset, so samples of one
+ * block are always consecutive.
+ *
+ * @code
+ * eelog_init();
+ * eelog_append(values);   // every 10 minutes
+ *
+ * eelog_iter_t it;
+ * eelog_rewind(&it);
+ * while (eelog_next(&it, &sample))
+ *     // oldest sample first
+ * @endcode
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdint.h>
+
+
+// -- Defines --------------------------------------------------------
+/** @brief  Number of logged channels */
+#ifndef EELOG_CHANNELS
+# define EELOG_CHANNELS 4
+#endif
+
+/** @brief  EEPROM address of the log area */
+#ifndef EELOG_START
+# define EELOG_START 0
+#endif
+
+/** @brief  Number of blocks, the log takes EELOG_BLOCKS * 64 bytes */
+#ifndef EELOG_BLOCKS
+# define EELOG_BLOCKS 15
+#endif
+
+/** @brief  Size of one block in bytes */
+#define EELOG_BLOCK_SIZE 64
+
+/** @brief  Size of block header with keyframe */
+#define EELOG_HEADER (5 + 2*EELOG_CHANNELS)
+
+
+// -- Types ----------------------------------------------------------
+/**
+ * @brief  One logged sample.
+ */
+typedef struct {
+    uint8_t boot;                     /**< @brief Boot counter */
+    uint16_t index;                   /**< @brief Sample number since boot */
+    int16_t value[EELOG_CHANNELS];    /**< @brief Channel values */
+} eelog_sample_t;
+
+/**
+ * @brief  Position of reading, see eelog_rewind().
+ */
+typedef struct {
+    uint8_t block;     /**< @brief Current block */
+    uint8_t left;      /**< @brief Blocks left to read */
+    uint8_t offset;    /**< @brief Next byte in block, 0 for header */
+    eelog_sample_t s;  /**< @brief Previous sample */
+} eelog_iter_t;
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Find the newest block and prepare a new one for this boot.
+ * @return none
+ * @note   Reads EEPROM synchronously; the header of the new block is
+ *         written with the first sample.
+ */
+void eelog_init(void);
+
+
+/**
+ * @brief  Append one sample to the log.
+ * @param  value Values of all channels
+ * @return 0 if queued for writing, 1 if the write queue is full (the
+ *         sample is lost)
+ */
+uint8_t eelog_append(const int16_t *value);
+
+
+/**
+ * @brief  Start reading from the oldest sample.
+ * @param  it Pointer to reading position
+ * @return none
+ * @note   Waits for queued EEPROM writes.
+ */
+void eelog_rewind(eelog_iter_t *it);
+
+
+/**
+ * @brief  Read next sample.
+ * @param  it Pointer to reading position
+ * @param  sample Pointer to sample structure
+ * @return 1 if a sample has been read, 0 at the end of the log
+ */
+uint8_t eelog_next(eelog_iter_t *it, eelog_sample_t *sample);
+
+
+/**
+ * @brief  Read number of samples lost because of full write queue.
+ * @return Number of lost samples
+ */
+uint16_t eelog_dropped(void);
+
+
+/** @} */
+
+#endif
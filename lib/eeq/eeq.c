@@ -0,0 +1,160 @@
+/*
+ * Interrupt-driven EEPROM write queue for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <eeq.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+
+// -- Global variables -----------------------------------------------
+static uint16_t eeq_addr[EEQ_SIZE];
+static uint8_t eeq_data[EEQ_SIZE];
+static volatile uint8_t eeq_head = 0;  // Next free place
+static volatile uint8_t eeq_tail = 0;  // Next byte to write
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: eeq_free()
+ * Purpose:  Read number of free places in the queue.
+ * Returns:  Number of bytes which can be queued
+ */
+uint8_t eeq_free(void)
+{
+    uint8_t used;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        used = (eeq_head - eeq_tail) & (2*EEQ_SIZE - 1);
+    }
+    return EEQ_SIZE - used;
+}
+
+
+/*
+ * Function: eeq_write()
+ * Purpose:  Queue bytes to be written to EEPROM.
+ * Input(s): addr - EEPROM address of the first byte
+ *           data - Bytes to write
+ *           len - Number of bytes
+ * Returns:  0 if queued, 1 if there is not enough free space
+ */
+uint8_t eeq_write(uint16_t addr, const uint8_t *data, uint8_t len)
+{
+    uint8_t head;
+
+    if (eeq_free() < len)
+        return 1;
+
+    // Only this function moves the head, the ISR sees new entries when
+    // the head is stored
+    head = eeq_head;
+    while (len--) {
+        eeq_addr[head & (EEQ_SIZE-1)] = addr++;
+        eeq_data[head & (EEQ_SIZE-1)] = *data++;
+        head = (head + 1) & (2*EEQ_SIZE - 1);
+    }
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        eeq_head = head;
+        // Interrupt fires as soon as no write is in progress
+        EECR |= (1<<EERIE);
+    }
+    return 0;
+}
+
+
+/*
+ * Function: eeq_busy()
+ * Purpose:  Test if queued bytes are still being written.
+ * Returns:  1 if the queue is not empty, 0 otherwise
+ */
+uint8_t eeq_busy(void)
+{
+    return (eeq_free() != EEQ_SIZE) || (EECR & (1<<EEPE));
+}
+
+
+/*
+ * Function: eeq_flush()
+ * Purpose:  Wait until all queued bytes have been written.
+ * Returns:  none
+ */
+void eeq_flush(void)
+{
+    while (eeq_busy());
+}
+
+
+/*
+ * Function: eeq_read()
+ * Purpose:  Read bytes from EEPROM.
+ * Input(s): addr - EEPROM address of the first byte
+ *           buf - Destination buffer
+ *           len - Number of bytes
+ * Returns:  none
+ */
+void eeq_read(uint16_t addr, uint8_t *buf, uint8_t len)
+{
+    uint8_t done;
+
+    while (len--) {
+        do {
+            // Wait with interrupts enabled, a write takes about 3.4 ms
+            while (EECR & (1<<EEPE));
+            done = 0;
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+            {
+                // Address must not change while a write is in progress,
+                // the ISR may have started the next one meanwhile
+                if (!(EECR & (1<<EEPE))) {
+                    EEAR = addr;
+                    EECR |= (1<<EERE);
+                    *buf = EEDR;
+                    done = 1;
+                }
+            }
+        } while (!done);
+        addr++;
+        buf++;
+    }
+}
+
+
+// -- Interrupt service routines -------------------------------------
+/*
+ * Function: EEPROM ready interrupt
+ * Purpose:  Start writing of the next queued byte which differs from
+ *           EEPROM content, disable the interrupt when the queue is empty.
+ */
+ISR(EE_READY_vect)
+{
+    uint8_t tail = eeq_tail;
+    uint8_t data;
+
+    while (tail != eeq_head) {
+        EEAR = eeq_addr[tail & (EEQ_SIZE-1)];
+        data = eeq_data[tail & (EEQ_SIZE-1)];
+        tail = (tail + 1) & (2*EEQ_SIZE - 1);
+
+        EECR |= (1<<EERE);
+        if (EEDR == data)
+            continue;
+
+        // Erase and write in one operation, EEPE within 4 cycles
+        EEDR = data;
+        EECR |= (1<<EEMPE);
+        EECR |= (1<<EEPE);
+        eeq_tail = tail;
+        return;
+    }
+    eeq_tail = tail;
+    EECR &= ~(1<<EERIE);
+}
@@ -0,0 +1,96 @@
+#ifndef EEQ_H
+# define EEQ_H
+
+/*
+ * Interrupt-driven EEPROM write queue for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup eeq EEPROM Write Queue Library <eeq.h>
+ * @code #include <eeq.h> @endcode
+ *
+ * @brief Non-blocking EEPROM writes for AVR-GCC.
+ *
+ * eeq_write() only copies bytes with their addresses into a queue. The
+ * EEPROM Ready interrupt writes one byte each time the previous write
+ * (about 3.4 ms) has finished. Bytes equal to the EEPROM content are
+ * skipped, which saves time and wear. Reading through eeq_read() does
+ * not disturb a write in progress.
+ *
+ * @note Based on Microchip Atmel ATmega328P manual.
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdint.h>
+
+
+// -- Defines --------------------------------------------------------
+/**
+ * @brief  Number of queued bytes, must be power of 2. Each byte takes
+ *         3 bytes of RAM; 32 holds a block header and one record of
+ *         the EEPROM log (eelog.h) at the same time.
+ */
+#ifndef EEQ_SIZE
+# define EEQ_SIZE 32
+#endif
+
+#if (EEQ_SIZE & (EEQ_SIZE - 1)) != 0
+# error "EEQ_SIZE must be power of 2"
+#endif
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Queue bytes to be written to EEPROM.
+ * @param  addr EEPROM address of the first byte
+ * @param  data Bytes to write, copied into the queue
+ * @param  len Number of bytes
+ * @return 0 if queued, 1 if there is not enough free space (nothing is
+ *         queued then)
+ */
+uint8_t eeq_write(uint16_t addr, const uint8_t *data, uint8_t len);
+
+
+/**
+ * @brief  Read number of free places in the queue.
+ * @return Number of bytes which can be queued
+ */
+uint8_t eeq_free(void);
+
+
+/**
+ * @brief  Test if queued bytes are still being written.
+ * @return 1 if the queue is not empty, 0 otherwise
+ */
+uint8_t eeq_busy(void);
+
+
+/**
+ * @brief  Wait until all queued bytes have been written.
+ * @return none
+ * @note   Global interrupts must be enabled.
+ */
+void eeq_flush(void);
+
+
+/**
+ * @brief  Read bytes from EEPROM.
+ * @param  addr EEPROM address of the first byte
+ * @param  buf Destination buffer
+ * @param  len Number of bytes
+ * @return none
+ * @note   Bytes still waiting in the queue are not seen, call
+ *         eeq_flush() first if it matters.
+ */
+void eeq_read(uint16_t addr, uint8_t *buf, uint8_t len);
+
+
+/** @} */
+
+#endif
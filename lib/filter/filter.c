@@ -0,0 +1,128 @@
+/*
+ * Streaming fixed-point filters for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware; host tests in test/test_app.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <filter.h>
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: filter_init()
+ * Purpose:  Initialize filter and clear its history.
+ * Input(s): f - Pointer to filter state
+ *           type - One of filter types
+ *           n - Window length or EMA shift
+ * Returns:  none
+ */
+void filter_init(filter_t *f, uint8_t type, uint8_t n)
+{
+    if (type == FILTER_EMA) {
+        if (n > 14)
+            n = 14;
+    }
+    else {
+        if (n > FILTER_MAX_WINDOW)
+            n = FILTER_MAX_WINDOW;
+        if (n == 0)
+            n = 1;
+    }
+
+    f->type = type;
+    f->n = n;
+    f->pos = 0;
+    f->count = 0;
+    f->out = 0;
+    f->s.avg.sum = 0;
+    f->s.ema.acc = 0;
+}
+
+
+/*
+ * Function: median_update()
+ * Purpose:  Replace oldest sample of median window by a new one and keep
+ *           the window sorted.
+ * Input(s): f - Pointer to filter state
+ *           x - New sample
+ * Returns:  Median of the window
+ */
+static int16_t median_update(filter_t *f, int16_t x)
+{
+    int16_t *sorted = f->s.med.sorted;
+    uint8_t len = f->count;
+    uint8_t i;
+
+    if (len == f->n) {
+        // Remove oldest sample from sorted array
+        int16_t old = f->s.med.window[f->pos];
+        for (i = 0; sorted[i] != old; i++);
+        for (; i < len-1; i++)
+            sorted[i] = sorted[i+1];
+        len--;
+    }
+    else {
+        f->count++;
+    }
+
+    // Insert new sample into sorted array
+    for (i = len; i > 0 && sorted[i-1] > x; i--)
+        sorted[i] = sorted[i-1];
+    sorted[i] = x;
+
+    f->s.med.window[f->pos] = x;
+    if (++f->pos >= f->n)
+        f->pos = 0;
+
+    return sorted[f->count / 2];
+}
+
+
+/*
+ * Function: filter_update()
+ * Purpose:  Process one new sample.
+ * Input(s): f - Pointer to filter state
+ *           x - New sample
+ * Returns:  Filtered value
+ */
+int16_t filter_update(filter_t *f, int16_t x)
+{
+    switch (f->type) {
+    case FILTER_MOVING_AVERAGE:
+        if (f->count == f->n)
+            f->s.avg.sum -= f->s.avg.window[f->pos];
+        else
+            f->count++;
+        f->s.avg.sum += x;
+        f->s.avg.window[f->pos] = x;
+        if (++f->pos >= f->n)
+            f->pos = 0;
+        f->out = f->s.avg.sum / f->count;
+        break;
+
+    case FILTER_MEDIAN:
+        f->out = median_update(f, x);
+        break;
+
+    case FILTER_EMA:
+        if (f->count == 0) {
+            f->count = 1;
+            f->s.ema.acc = (int32_t)x << f->n;
+        }
+        else {
+            f->s.ema.acc += x - (f->s.ema.acc >> f->n);
+        }
+        // Rounded output
+        f->out = (f->s.ema.acc + ((1L << f->n) >> 1)) >> f->n;
+        break;
+
+    default:
+        f->out = x;
+        break;
+    }
+
+    return f->out;
+}
@@ -0,0 +1,114 @@
+#ifndef FILTER_H
+# define FILTER_H
+
+/*
+ * Streaming fixed-point filters for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware; host tests in test/test_app.
+ */
+
+/**
+ * @file
+ * @defgroup filter Filter Library <filter.h>
+ * @code #include <filter.h> @endcode
+ *
+ * @brief Streaming fixed-point filters for sensor values.
+ *
+ * Each filter takes one new sample per update and returns the filtered
+ * value. The update cost does not depend on the length of the history:
+ *   - Moving average keeps a running sum of the window
+ *   - Median keeps the window sorted, one removal and one insertion of
+ *     at most FILTER_MAX_WINDOW values per sample
+ *   - Exponential moving average uses alpha = 1/2^n, only shifts
+ *
+ * @note No floating point is used, values are 16-bit signed integers in
+ *       any fixed-point scale of the caller.
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdint.h>
+
+
+// -- Defines --------------------------------------------------------
+/**
+ * @brief  Longest window of moving average and median filters.
+ */
+#ifndef FILTER_MAX_WINDOW
+# define FILTER_MAX_WINDOW 8
+#endif
+
+/**
+ * @name  Filter types
+ */
+#define FILTER_NONE           0 /**< @brief Output follows input */
+#define FILTER_MOVING_AVERAGE 1 /**< @brief Mean of last n samples */
+#define FILTER_MEDIAN         2 /**< @brief Median of last n samples */
+#define FILTER_EMA            3 /**< @brief y += (x - y) / 2^n */
+
+
+// -- Types ----------------------------------------------------------
+/**
+ * @brief  State of one filter.
+ */
+typedef struct {
+    uint8_t type;   /**< @brief One of filter types */
+    uint8_t n;      /**< @brief Window length or EMA shift */
+    uint8_t pos;    /**< @brief Position of oldest sample in window */
+    uint8_t count;  /**< @brief Number of samples in window */
+    int16_t out;    /**< @brief Last output value */
+    union {
+        struct {
+            int32_t sum;
+            int16_t window[FILTER_MAX_WINDOW];
+        } avg;
+        struct {
+            int16_t window[FILTER_MAX_WINDOW];
+            int16_t sorted[FILTER_MAX_WINDOW];
+        } med;
+        struct {
+            int32_t acc;  // Output scaled by 2^n
+        } ema;
+    } s;
+} filter_t;
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Initialize filter and clear its history.
+ * @param  f Pointer to filter state
+ * @param  type One of filter types
+ * @param  n Window length from 1 to FILTER_MAX_WINDOW, median should use
+ *         an odd length such as 5 or 7; EMA shift from 0 to 14
+ * @return none
+ */
+void filter_init(filter_t *f, uint8_t type, uint8_t n);
+
+
+/**
+ * @brief  Process one new sample.
+ * @param  f Pointer to filter state
+ * @param  x New sample
+ * @return Filtered value
+ * @note   Until the window is full, the output is computed from the
+ *         samples received so far. EMA starts from the first sample.
+ */
+int16_t filter_update(filter_t *f, int16_t x);
+
+
+/**
+ * @brief  Read last filtered value.
+ * @param  f Pointer to filter state
+ * @return Filtered value, 0 before the first sample
+ */
+static inline int16_t filter_output(const filter_t *f)
+{
+    return f->out;
+}
+
+
+/** @} */
+
+#endif
@@ -0,0 +1,219 @@
+/*
+ * Modbus RTU slave for AVR-GCC, protocol part without hardware access.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware; host tests in test/test_app.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <modbus.h>
+#ifdef __AVR__
+# include <avr/pgmspace.h>
+#else
+// Host build, see tools/modbus_pty.c
+# define PROGMEM
+# define pgm_read_word(p) (*(p))
+#endif
+
+
+// -- Defines --------------------------------------------------------
+#define REGS_MAX ((MODBUS_FRAME_MAX - 9) / 2)  // Limit of function 16
+
+// modbus_request() returns a length or an exception code with bit 7 set
+_Static_assert(MODBUS_FRAME_MAX < 128, "MODBUS_FRAME_MAX must be below 128");
+
+
+// -- Global variables -----------------------------------------------
+// CRC-16/MODBUS of every byte value (polynomial 0xa001 reflected)
+static const uint16_t crc_table[256] PROGMEM = {
+    0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241,
+    0xc601, 0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1, 0xc481, 0x0440,
+    0xcc01, 0x0cc0, 0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40,
+    0x0a00, 0xcac1, 0xcb81, 0x0b40, 0xc901, 0x09c0, 0x0880, 0xc841,
+    0xd801, 0x18c0, 0x1980, 0xd941, 0x1b00, 0xdbc1, 0xda81, 0x1a40,
+    0x1e00, 0xdec1, 0xdf81, 0x1f40, 0xdd01, 0x1dc0, 0x1c80, 0xdc41,
+    0x1400, 0xd4c1, 0xd581, 0x1540, 0xd701, 0x17c0, 0x1680, 0xd641,
+    0xd201, 0x12c0, 0x1380, 0xd341, 0x1100, 0xd1c1, 0xd081, 0x1040,
+    0xf001, 0x30c0, 0x3180, 0xf141, 0x3300, 0xf3c1, 0xf281, 0x3240,
+    0x3600, 0xf6c1, 0xf781, 0x3740, 0xf501, 0x35c0, 0x3480, 0xf441,
+    0x3c00, 0xfcc1, 0xfd81, 0x3d40, 0xff01, 0x3fc0, 0x3e80, 0xfe41,
+    0xfa01, 0x3ac0, 0x3b80, 0xfb41, 0x3900, 0xf9c1, 0xf881, 0x3840,
+    0x2800, 0xe8c1, 0xe981, 0x2940, 0xeb01, 0x2bc0, 0x2a80, 0xea41,
+    0xee01, 0x2ec0, 0x2f80, 0xef41, 0x2d00, 0xedc1, 0xec81, 0x2c40,
+    0xe401, 0x24c0, 0x2580, 0xe541, 0x2700, 0xe7c1, 0xe681, 0x2640,
+    0x2200, 0xe2c1, 0xe381, 0x2340, 0xe101, 0x21c0, 0x2080, 0xe041,
+    0xa001, 0x60c0, 0x6180, 0xa141, 0x6300, 0xa3c1, 0xa281, 0x6240,
+    0x6600, 0xa6c1, 0xa781, 0x6740, 0xa501, 0x65c0, 0x6480, 0xa441,
+    0x6c00, 0xacc1, 0xad81, 0x6d40, 0xaf01, 0x6fc0, 0x6e80, 0xae41,
+    0xaa01, 0x6ac0, 0x6b80, 0xab41, 0x6900, 0xa9c1, 0xa881, 0x6840,
+    0x7800, 0xb8c1, 0xb981, 0x7940, 0xbb01, 0x7bc0, 0x7a80, 0xba41,
+    0xbe01, 0x7ec0, 0x7f80, 0xbf41, 0x7d00, 0xbdc1, 0xbc81, 0x7c40,
+    0xb401, 0x74c0, 0x7580, 0xb541, 0x7700, 0xb7c1, 0xb681, 0x7640,
+    0x7200, 0xb2c1, 0xb381, 0x7340, 0xb101, 0x71c0, 0x7080, 0xb041,
+    0x5000, 0x90c1, 0x9181, 0x5140, 0x9301, 0x53c0, 0x5280, 0x9241,
+    0x9601, 0x56c0, 0x5780, 0x9741, 0x5500, 0x95c1, 0x9481, 0x5440,
+    0x9c01, 0x5cc0, 0x5d80, 0x9d41, 0x5f00, 0x9fc1, 0x9e81, 0x5e40,
+    0x5a00, 0x9ac1, 0x9b81, 0x5b40, 0x9901, 0x59c0, 0x5880, 0x9841,
+    0x8801, 0x48c0, 0x4980, 0x8941, 0x4b00, 0x8bc1, 0x8a81, 0x4a40,
+    0x4e00, 0x8ec1, 0x8f81, 0x4f40, 0x8d01, 0x4dc0, 0x4c80, 0x8c41,
+    0x4400, 0x84c1, 0x8581, 0x4540, 0x8701, 0x47c0, 0x4680, 0x8641,
+    0x8201, 0x42c0, 0x4380, 0x8341, 0x4100, 0x81c1, 0x8081, 0x4040,
+};
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: modbus_crc()
+ * Purpose:  CRC-16/MODBUS, one table lookup per byte.
+ * Input(s): data - Bytes
+ *           len - Number of bytes
+ * Returns:  CRC
+ */
+uint16_t modbus_crc(const uint8_t *data, uint8_t len)
+{
+    uint16_t crc = 0xffff;
+
+    while (len--)
+        crc = (crc >> 8) ^ pgm_read_word(&crc_table[(crc ^ *data++) & 0xff]);
+    return crc;
+}
+
+
+/*
+ * Function: get_word()
+ * Purpose:  Read 16-bit field of frame, big endian.
+ * Input(s): p - First byte
+ * Returns:  Value
+ */
+static uint16_t get_word(const uint8_t *p)
+{
+    return ((uint16_t)p[0] << 8) | p[1];
+}
+
+
+/*
+ * Function: put_word()
+ * Purpose:  Write 16-bit field of frame, big endian.
+ * Input(s): p - First byte
+ *           value - Value
+ * Returns:  none
+ */
+static void put_word(uint8_t *p, uint16_t value)
+{
+    p[0] = value >> 8;
+    p[1] = value & 0xff;
+}
+
+
+/*
+ * Function: modbus_request()
+ * Purpose:  Run one request and build the response without CRC.
+ * Input(s): map - Register map
+ *           frame - Request, replaced by response
+ *           len - Length of request without CRC
+ * Returns:  Length of response, or exception code with bit 7 set
+ */
+static uint8_t modbus_request(const modbus_map_t *map, uint8_t *frame,
+                              uint8_t len)
+{
+    uint16_t start = get_word(&frame[2]);
+    uint16_t count = get_word(&frame[4]);
+    uint16_t value;
+    uint8_t result;
+
+    switch (frame[1]) {
+    case MODBUS_READ_HOLDING:
+    case MODBUS_READ_INPUT:
+        if (len != 6)
+            return 0x80 | MODBUS_ILLEGAL_VALUE;
+        if (count == 0 || count > (MODBUS_FRAME_MAX - 5) / 2)
+            return 0x80 | MODBUS_ILLEGAL_VALUE;
+        // Request fields are read, the response overwrites them
+        for (uint8_t i = 0; i < count; i++) {
+            if (frame[1] == MODBUS_READ_HOLDING)
+                result = map->read_holding(start + i, &value);
+            else
+                result = map->read_input(start + i, &value);
+            if (result != MODBUS_OK)
+                return 0x80 | result;
+            put_word(&frame[3 + 2*i], value);
+        }
+        frame[2] = 2 * count;
+        return 3 + 2 * count;
+
+    case MODBUS_WRITE_SINGLE:
+        if (len != 6)
+            return 0x80 | MODBUS_ILLEGAL_VALUE;
+        result = map->write_holding(start, count);
+        if (result != MODBUS_OK)
+            return 0x80 | result;
+        // Response repeats the request
+        return 6;
+
+    case MODBUS_WRITE_MULTIPLE:
+        if (len < 7 || count == 0 || count > REGS_MAX ||
+            frame[6] != 2 * count || len != 7 + 2 * count)
+            return 0x80 | MODBUS_ILLEGAL_VALUE;
+        // Registers before a failing one stay written
+        for (uint8_t i = 0; i < count; i++) {
+            result = map->write_holding(start + i, get_word(&frame[7 + 2*i]));
+            if (result != MODBUS_OK)
+                return 0x80 | result;
+        }
+        // Response is address, function, start and count
+        return 6;
+
+    default:
+        return 0x80 | MODBUS_ILLEGAL_FUNCTION;
+    }
+}
+
+
+/*
+ * Function: modbus_process()
+ * Purpose:  Check address and CRC of a request, run it and build the
+ *           response in the same buffer.
+ * Input(s): address - Address of this slave
+ *           map - Register map
+ *           frame - Buffer with request
+ *           len - Length of request with CRC
+ * Returns:  Length of response with CRC, 0 for no response
+ */
+uint8_t modbus_process(uint8_t address, const modbus_map_t *map,
+                       uint8_t *frame, uint8_t len)
+{
+    uint16_t crc;
+    uint8_t result;
+
+    // Address, function and CRC at least
+    if (len < 4 || len > MODBUS_FRAME_MAX)
+        return 0;
+    if (frame[0] != address && frame[0] != MODBUS_BROADCAST)
+        return 0;
+    crc = modbus_crc(frame, len - 2);
+    if (frame[len - 2] != (crc & 0xff) || frame[len - 1] != (crc >> 8))
+        return 0;
+
+    // Reads make no sense as broadcast
+    if (frame[0] == MODBUS_BROADCAST &&
+        (frame[1] == MODBUS_READ_HOLDING || frame[1] == MODBUS_READ_INPUT))
+        return 0;
+
+    // Fields beyond a short request are stale, but each function
+    // checks the length before using them
+    result = modbus_request(map, frame, len - 2);
+
+    if (frame[0] == MODBUS_BROADCAST)
+        return 0;
+    if (result & 0x80) {
+        frame[1] |= 0x80;
+        frame[2] = result & 0x7f;
+        result = 3;
+    }
+
+    crc = modbus_crc(frame, result);
+    frame[result] = crc & 0xff;
+    frame[result + 1] = crc >> 8;
+    return result + 2;
+}
@@ -0,0 +1,164 @@
+#ifndef MODBUS_H
+# define MODBUS_H
+
+/*
+ * Modbus RTU slave for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware; host tests in test/test_app.
+ */
+
+/**
+ * @file
+ * @defgroup modbus Modbus RTU Slave Library <modbus.h>
+ * @code #include <modbus.h> @endcode
+ *
+ * @brief Modbus RTU slave with function codes 03, 04, 06 and 16.
+ *
+ * Received bytes are collected by modbus_rx(), called by the UART
+ * receive interrupt (build flag -DUART_RX_HOOK=...). Each byte restarts
+ * Timer/Counter2, which expires after 3.5 character times of silence
+ * (1.75 ms above 19200 Bd) and marks the end of the frame. modbus_poll(),
+ * called from a task, checks address and CRC, runs the request against
+ * the register map of the application, and writes the response into
+ * the UART transmit buffer only when it fits, so it never waits. Bytes
+ * arriving before the response is sent are dropped, as the master has
+ * to wait for it anyway.
+ *
+ * Registers are read and written through callbacks; they return 0 or a
+ * Modbus exception code, which is then sent back to the master.
+ *
+ * Optional RS-485 direction control: define MODBUS_DE_PORT (e.g. PORTD)
+ * and MODBUS_DE_PIN. The driver is enabled before the response and
+ * released by the USART Transmit Complete interrupt after its last
+ * stop bit.
+ *
+ * modbus_process() and modbus_crc() do not touch the hardware (file
+ * modbus.c), tools/modbus_pty.c runs them on Linux behind a pseudo
+ * terminal for tests with any Modbus master.
+ *
+ * @note   Timer/Counter2 is reserved for the frame gap.
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdint.h>
+
+
+// -- Defines --------------------------------------------------------
+/** @brief  Largest request or response in bytes (at most 15 registers
+ *          per request with function code 16) */
+#ifndef MODBUS_FRAME_MAX
+# define MODBUS_FRAME_MAX 40
+#endif
+
+/** @brief  Lowest UART speed, 3.5 characters of silence must fit
+ *          Timer/Counter2 with prescaler 1024 */
+#define MODBUS_BAUD_MIN 2400
+
+/** @brief  Address of broadcast requests, executed without response */
+#define MODBUS_BROADCAST 0
+
+/**
+ * @name  Function codes
+ */
+#define MODBUS_READ_HOLDING   0x03  /**< @brief Read holding registers */
+#define MODBUS_READ_INPUT     0x04  /**< @brief Read input registers */
+#define MODBUS_WRITE_SINGLE   0x06  /**< @brief Write single register */
+#define MODBUS_WRITE_MULTIPLE 0x10  /**< @brief Write multiple registers */
+
+/**
+ * @name  Exception codes, returned by register callbacks
+ */
+#define MODBUS_OK               0  /**< @brief No exception */
+#define MODBUS_ILLEGAL_FUNCTION 1  /**< @brief Function not supported */
+#define MODBUS_ILLEGAL_ADDRESS  2  /**< @brief No such register */
+#define MODBUS_ILLEGAL_VALUE    3  /**< @brief Value out of range */
+#define MODBUS_DEVICE_FAILURE   4  /**< @brief Request failed */
+
+
+// -- Types ----------------------------------------------------------
+/**
+ * @brief  Register map of the application.
+ */
+typedef struct {
+    /** @brief Read input register (function 04) */
+    uint8_t (*read_input)(uint16_t reg, uint16_t *value);
+    /** @brief Read holding register (function 03) */
+    uint8_t (*read_holding)(uint16_t reg, uint16_t *value);
+    /** @brief Write holding register (functions 06 and 16) */
+    uint8_t (*write_holding)(uint16_t reg, uint16_t value);
+} modbus_map_t;
+
+/**
+ * @brief  Counters of received frames.
+ */
+typedef struct {
+    uint16_t requests;    /**< @brief Valid requests for this slave */
+    uint16_t exceptions;  /**< @brief Exception responses */
+    uint16_t crc_errors;  /**< @brief Frames with wrong CRC or too short */
+    uint16_t dropped;     /**< @brief Frames too long or arrived busy */
+} modbus_stats_t;
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  CRC-16/MODBUS by table lookup.
+ * @param  data Bytes
+ * @param  len Number of bytes
+ * @return CRC, sent low byte first
+ */
+uint16_t modbus_crc(const uint8_t *data, uint8_t len);
+
+
+/**
+ * @brief  Check one received frame and build the response in its place.
+ * @param  address Address of this slave, 1 to 247
+ * @param  map Register map
+ * @param  frame Buffer of MODBUS_FRAME_MAX bytes with the request
+ * @param  len Length of request including CRC
+ * @return Length of response including CRC, 0 if none is to be sent
+ *         (other address, broadcast or damaged frame)
+ */
+uint8_t modbus_process(uint8_t address, const modbus_map_t *map,
+                       uint8_t *frame, uint8_t len);
+
+
+/**
+ * @brief  Set address, register map and Timer/Counter2 for the frame gap.
+ * @param  address Address of this slave, 1 to 247
+ * @param  baud UART speed, the UART is set up by uart_init()
+ * @param  map Register map
+ * @return 1 if started, 0 if baud is below MODBUS_BAUD_MIN
+ */
+uint8_t modbus_init(uint8_t address, uint32_t baud, const modbus_map_t *map);
+
+
+/**
+ * @brief  Store one received byte, called from UART receive interrupt.
+ * @param  data Received byte
+ * @return 1 if the byte was taken, 0 before modbus_init()
+ */
+uint8_t modbus_rx(uint8_t data);
+
+
+/**
+ * @brief  Answer a completed request, or send a pending response.
+ * @return 1 if a request was handled, 0 otherwise
+ * @note   Call every few milliseconds.
+ */
+uint8_t modbus_poll(void);
+
+
+/**
+ * @brief  Copy counters of received frames.
+ * @param  stats Pointer to counters
+ * @return none
+ */
+void modbus_get_stats(modbus_stats_t *stats);
+
+
+/** @} */
+
+#endif
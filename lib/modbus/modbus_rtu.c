@@ -0,0 +1,247 @@
+/*
+ * Modbus RTU slave for AVR-GCC, frame gap and UART.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <modbus.h>
+#include <uart.h>
+
+
+// -- Defines --------------------------------------------------------
+#define GAP_FAST_US 1750    // t3.5 fixed above 19200 Bd by the standard
+
+// Frame gap at the lowest speed within 256 counts of prescaler 1024
+_Static_assert((F_CPU * 35UL + MODBUS_BAUD_MIN * 5UL) /
+               (MODBUS_BAUD_MIN * 10UL) * 11UL / 1024 <= 256,
+               "MODBUS_BAUD_MIN too low for F_CPU");
+
+#if defined(MODBUS_DE_PORT) && defined(MODBUS_DE_PIN)
+# define MODBUS_DE_DDR (*(&MODBUS_DE_PORT - 1))  // DDRx below PORTx
+# define de_on()  (MODBUS_DE_PORT |= _BV(MODBUS_DE_PIN))
+# define de_off() (MODBUS_DE_PORT &= ~_BV(MODBUS_DE_PIN))
+#endif
+
+
+// -- Global variables -----------------------------------------------
+static const modbus_map_t *mb_map;
+static uint8_t mb_address;
+static uint8_t mb_cs;               // Clock select bits of Timer/Counter2
+
+static uint8_t mb_frame[MODBUS_FRAME_MAX];
+static volatile uint8_t mb_len;     // Bytes received or to be sent
+static volatile uint8_t mb_state;   // Owner of mb_frame, see below
+static volatile modbus_stats_t mb_stats;
+
+enum {
+    MB_RECEIVE = 0,                 // ISR collects bytes
+    MB_READY,                       // Gap after frame, modbus_poll() next
+    MB_SEND,                        // Response waits for UART buffer
+};
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: modbus_init()
+ * Purpose:  Set address, register map and Timer/Counter2 to CTC mode
+ *           with compare match after 3.5 character times.
+ * Input(s): address - Address of this slave
+ *           baud - UART speed
+ *           map - Register map
+ * Returns:  1 if started, 0 if the gap does not fit the timer
+ */
+uint8_t modbus_init(uint8_t address, uint32_t baud, const modbus_map_t *map)
+{
+    static const uint16_t prescalers[] = {1, 8, 32, 64, 128, 256, 1024};
+    uint32_t cycles;
+    uint8_t i;
+
+    // Slower speeds would cut the gap short, Modbus stays off
+    if (baud < MODBUS_BAUD_MIN)
+        return 0;
+
+    // 11 bits per character, 1.75 ms fixed at high speed
+    if (baud > 19200)
+        cycles = (F_CPU / 1000000UL) * GAP_FAST_US;
+    else
+        cycles = (F_CPU * 35UL + baud * 5UL) / (baud * 10UL) * 11UL;
+
+    // Smallest prescaler within 8 bits, clock select 1 to 7
+    for (i = 0; i < 6 && cycles / prescalers[i] > 256; i++)
+        ;
+    cycles /= prescalers[i];
+    mb_cs = i + 1;
+
+    TCCR2B = 0;                     // Stopped until the first byte
+    TCCR2A = _BV(WGM21);            // CTC, TOP = OCR2A
+    OCR2A = cycles > 256 ? 255 : cycles - 1;
+    TIFR2 = _BV(OCF2A);
+    TIMSK2 = _BV(OCIE2A);
+
+#ifdef MODBUS_DE_DDR
+    de_off();
+    MODBUS_DE_DDR |= _BV(MODBUS_DE_PIN);
+#endif
+
+    mb_len = 0;
+    mb_state = MB_RECEIVE;
+    mb_address = address;
+    mb_map = map;
+    return 1;
+}
+
+
+/*
+ * Function: modbus_rx()
+ * Purpose:  Store received byte and restart the frame gap timer.
+ * Input(s): data - Received byte
+ * Returns:  1 if taken, 0 if Modbus is not in use
+ * Note:     Called from UART receive interrupt.
+ */
+uint8_t modbus_rx(uint8_t data)
+{
+    if (mb_map == 0)
+        return 0;
+
+    if (mb_state != MB_RECEIVE) {
+        // Master did not wait for the response
+        if (mb_stats.dropped != 0xffff)
+            mb_stats.dropped++;
+        return 1;
+    }
+
+    TCNT2 = 0;
+    TIFR2 = _BV(OCF2A);
+    TCCR2B = mb_cs;
+
+    // Overlong frame is counted when the gap ends
+    if (mb_len < 0xff) {
+        if (mb_len < MODBUS_FRAME_MAX)
+            mb_frame[mb_len] = data;
+        mb_len++;
+    }
+    return 1;
+}
+
+
+/*
+ * Function: Interrupt service routine.
+ * Purpose:  Silence of 3.5 characters ends the frame.
+ */
+ISR(TIMER2_COMPA_vect)
+{
+    TCCR2B = 0;
+
+    if (mb_len > MODBUS_FRAME_MAX) {
+        if (mb_stats.dropped != 0xffff)
+            mb_stats.dropped++;
+        mb_len = 0;
+    }
+    else if (mb_len > 0)
+        mb_state = MB_READY;
+}
+
+
+#ifdef MODBUS_DE_DDR
+/*
+ * Function: Interrupt service routine.
+ * Purpose:  Release RS-485 driver after the last stop bit.
+ */
+ISR(USART_TX_vect)
+{
+    UCSR0B &= ~_BV(TXCIE0);
+    de_off();
+}
+#endif
+
+
+/*
+ * Function: modbus_send()
+ * Purpose:  Copy response to UART buffer if it fits as a whole.
+ * Input(s): none
+ * Returns:  none
+ */
+static void modbus_send(void)
+{
+    if (uart_tx_free() < mb_len)
+        return;
+
+#ifdef MODBUS_DE_DDR
+    // Stale TX Complete flag would release the driver at once
+    de_on();
+    UCSR0A = (UCSR0A & _BV(U2X0)) | _BV(TXC0);
+    uart_write(mb_frame, mb_len);
+    UCSR0B |= _BV(TXCIE0);
+#else
+    uart_write(mb_frame, mb_len);
+#endif
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        mb_len = 0;
+        mb_state = MB_RECEIVE;
+    }
+}
+
+
+/*
+ * Function: modbus_poll()
+ * Purpose:  Answer a received frame or send pending response.
+ * Input(s): none
+ * Returns:  1 if a request was handled, 0 otherwise
+ */
+uint8_t modbus_poll(void)
+{
+    uint8_t len;
+
+    if (mb_state == MB_SEND) {
+        modbus_send();
+        return 0;
+    }
+    if (mb_state != MB_READY)
+        return 0;
+
+    // ISR leaves the buffer alone until the state goes back
+    len = modbus_process(mb_address, mb_map, mb_frame, mb_len);
+    if (len == 0) {
+        if (mb_frame[0] == mb_address || mb_frame[0] == MODBUS_BROADCAST) {
+            // Damaged frame, or a broadcast that needs no response
+            if (mb_len < 4 || modbus_crc(mb_frame, mb_len) != 0)
+                mb_stats.crc_errors++;
+            else
+                mb_stats.requests++;
+        }
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            mb_len = 0;
+            mb_state = MB_RECEIVE;
+        }
+        return 0;
+    }
+
+    mb_stats.requests++;
+    if (mb_frame[1] & 0x80)
+        mb_stats.exceptions++;
+    mb_len = len;
+    mb_state = MB_SEND;
+    modbus_send();
+    return 1;
+}
+
+
+/*
+ * Function: modbus_get_stats()
+ * Purpose:  Copy counters of received frames.
+ * Input(s): stats - Pointer to counters
+ * Returns:  none
+ */
+void modbus_get_stats(modbus_stats_t *stats)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        *stats = *(modbus_stats_t *)&mb_stats;
+    }
+}
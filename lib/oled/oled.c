@@ -48,6 +48,7 @@
 #include "oled.h"
 #include "font.h"
 #include <string.h>
+#include <prof.h>
 
 #if defined SPI
 # include <util/delay.h>
@@ -226,6 +227,7 @@ void oled_set_contrast(uint8_t contrast){
     oled_command(commandSequence, sizeof(commandSequence));
 }
 void oled_putc(char c){
+    PROF_BEGIN(OLED_PUTC);
     switch (c) {
         case '\b':
             // backspace
@@ -374,7 +376,7 @@ void oled_putc(char c){
 #endif
             break;
     }
-    
+    PROF_END(OLED_PUTC);
 }
 void oled_charMode(uint8_t mode){
     charMode = mode;
@@ -533,6 +535,7 @@ uint8_t oled_drawBitmap(uint8_t x, uint8_t y, const uint8_t *picture, uint8_t wi
     return result;
 }
 void oled_display() {
+    PROF_BEGIN_LONG(OLED_DISPLAY);
 #if defined (SSD1306) || defined (SSD1309)
     oled_gotoxy(0,0);
     oled_data(&displayBuffer[0][0], DISPLAY_WIDTH*DISPLAY_HEIGHT/8);
@@ -542,6 +545,7 @@ void oled_display() {
         oled_data(displayBuffer[i], sizeof(displayBuffer[i]));
     }
 #endif
+    PROF_END_LONG(OLED_DISPLAY);
 }
 void oled_clear_buffer() {
     for (uint8_t i = 0; i < DISPLAY_HEIGHT/8; i++){
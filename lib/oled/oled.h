@@ -60,9 +60,11 @@ extern "C" {
 #define I2C  // I2C or SPI	
     /* TODO: define displaycontroller */
 #define SH1106  // or SSD1306, check datasheet of your display
-    /* TODO: define displaymode */
-#define GRAPHICMODE  // for text and graphic
-    // TEXTMODE // for only text to display,
+    /* TODO: define displaymode, or build with -DTEXTMODE */
+#if !defined GRAPHICMODE && !defined TEXTMODE
+# define GRAPHICMODE  // for text and graphic
+#endif
+    // TEXTMODE // for only text to display, no buffer in SRAM
     /* TODO: define font */
 #define FONT  ssd1306oled_font  // Refer font-name at font.h
     
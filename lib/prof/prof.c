@@ -0,0 +1,191 @@
+/*
+ * Cycle-counting profiler for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <prof.h>
+
+#ifdef PROF_ENABLE
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+#include <string.h>
+
+
+// -- Defines --------------------------------------------------------
+#ifndef F_CPU
+# define F_CPU 16000000UL
+#endif
+
+
+// -- Types ----------------------------------------------------------
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t total;
+    uint32_t n;         // Runs summed in total, halved with it
+} prof_region_t;
+
+
+// -- Global variables -----------------------------------------------
+static const char prof_labels[PROF_COUNT][13] PROGMEM = {
+#define PROF_REGION(name, label) label,
+#include "prof_regions.def"
+#undef PROF_REGION
+};
+static prof_region_t prof_regions[PROF_COUNT];
+static uint8_t prof_overhead = 0;   // Cycles of an empty region
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: prof_top()
+ * Purpose:  Get last count of Timer/Counter1 before it restarts.
+ * Returns:  OCR1A in CTC mode, 0xffff otherwise
+ */
+static uint16_t prof_top(void)
+{
+    return (TCCR1B & (1<<WGM12)) ? OCR1A : 0xffff;
+}
+
+
+/*
+ * Function: prof_cycles()
+ * Purpose:  Cycles between two counts of Timer/Counter1, which may
+ *           have been cleared at TOP once in between.
+ * Input(s): start, end - Counts
+ * Returns:  Cycles
+ */
+static uint16_t prof_cycles(uint16_t start, uint16_t end)
+{
+    uint16_t top = prof_top();
+    uint16_t cycles = end - start;
+
+    if (cycles > top)
+        cycles += top + 1;
+    return cycles;
+}
+
+
+/*
+ * Function: prof_add()
+ * Purpose:  Add one run to statistics of a region. A region is
+ *           updated either from interrupts or from the main loop, so
+ *           only readers disable interrupts.
+ * Input(s): id - Region identifier
+ *           cycles - Length of run including cost of measurement
+ * Returns:  none
+ */
+static void prof_add(uint8_t id, uint32_t cycles)
+{
+    prof_region_t *r = &prof_regions[id];
+
+    cycles = cycles > prof_overhead ? cycles - prof_overhead : 0;
+    if (r->count == 0 || cycles < r->min)
+        r->min = cycles;
+    if (cycles > r->max)
+        r->max = cycles;
+    r->count++;
+
+    // Keep the mean when the sum overflows
+    if (r->total + cycles < r->total) {
+        r->total >>= 1;
+        r->n >>= 1;
+    }
+    r->total += cycles;
+    r->n++;
+}
+
+
+/*
+ * Function: prof_init()
+ * Purpose:  Clear statistics, measure cost of an empty region.
+ * Returns:  none
+ */
+void prof_init(void)
+{
+    uint16_t start;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        memset(prof_regions, 0, sizeof(prof_regions));
+        start = TCNT1;
+        prof_overhead = prof_cycles(start, TCNT1);
+    }
+}
+
+
+/*
+ * Function: prof_end()
+ * Purpose:  Add run of region shorter than one timer period.
+ * Input(s): id - Region identifier
+ *           start, end - TCNT1 at start and end
+ * Returns:  none
+ */
+void prof_end(uint8_t id, uint16_t start, uint16_t end)
+{
+    prof_add(id, prof_cycles(start, end));
+}
+
+
+/*
+ * Function: prof_end_long()
+ * Purpose:  Add run of region of any length. TCNT1 gives cycles since
+ *           the last restart of the timer, micros() the number of
+ *           whole timer periods, which it knows to a few microseconds.
+ * Input(s): id - Region identifier
+ *           start, end - TCNT1 at start and end
+ *           start_us - micros() at start
+ * Returns:  none
+ */
+void prof_end_long(uint8_t id, uint16_t start, uint16_t end,
+                   uint32_t start_us)
+{
+    uint32_t approx = (micros() - start_us) * (F_CPU / 1000000UL);
+    uint32_t period = (uint32_t)prof_top() + 1;
+    uint32_t cycles = prof_cycles(start, end);
+
+    // Division only for runs of more than half a period
+    if (approx > cycles + period / 2)
+        cycles += (approx - cycles + period / 2) / period * period;
+    prof_add(id, cycles);
+}
+
+
+/*
+ * Function: prof_get()
+ * Purpose:  Copy statistics of one region.
+ * Input(s): id - Region identifier
+ *           stats - Pointer to statistics
+ * Returns:  none
+ */
+void prof_get(uint8_t id, prof_stats_t *stats)
+{
+    prof_region_t r;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        r = prof_regions[id];
+    }
+    stats->count = r.count;
+    stats->min = r.min;
+    stats->max = r.max;
+    stats->mean = r.n ? r.total / r.n : 0;
+}
+
+
+/*
+ * Function: prof_label()
+ * Purpose:  Get label of region.
+ * Input(s): id - Region identifier
+ * Returns:  Label in program memory
+ */
+const char *prof_label(uint8_t id)
+{
+    return prof_labels[id];
+}
+#endif
@@ -0,0 +1,143 @@
+#ifndef PROF_H
+# define PROF_H
+
+/*
+ * Cycle-counting profiler for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup prof Profiler Library <prof.h>
+ * @code #include <prof.h> @endcode
+ *
+ * @brief Number of calls and minimum, maximum and mean CPU cycles of
+ *        named code regions.
+ *
+ * Regions are listed in include/prof_regions.def and marked in code:
+ *
+ * @code
+ * PROF_BEGIN(ADC_ISR);
+ * ...
+ * PROF_END(ADC_ISR);
+ * @endcode
+ *
+ * Time is read from TCNT1 of Timer/Counter1, which must run with
+ * prescaler 1, either in CTC mode with TOP = OCR1A (ADC sampling of
+ * adc_scan_start_timed() with period up to 4096 us) or free running.
+ * PROF_BEGIN() and PROF_END() take a few cycles and measure regions
+ * shorter than one timer period, e.g. interrupt service routines.
+ * PROF_BEGIN_LONG() and PROF_END_LONG() add micros() to count whole
+ * timer periods, for regions of any length up to minutes; their
+ * reading of micros() lies outside of the measured cycles. The cost of
+ * an empty region is measured by prof_init() and subtracted.
+ *
+ * Without build flag PROF_ENABLE all macros compile to nothing and
+ * no RAM is used.
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <avr/io.h>
+#include <stdint.h>
+
+
+// -- Defines --------------------------------------------------------
+/** @brief  Region identifiers, PROF_<name> of prof_regions.def */
+enum {
+#define PROF_REGION(name, label) PROF_##name,
+#include "prof_regions.def"
+#undef PROF_REGION
+    PROF_COUNT
+};
+
+#ifdef PROF_ENABLE
+# include <timebase.h>
+
+/** @brief  Start region shorter than one period of Timer/Counter1 */
+# define PROF_BEGIN(name) uint16_t prof_t_##name = TCNT1
+/** @brief  End region started by PROF_BEGIN() */
+# define PROF_END(name) prof_end(PROF_##name, prof_t_##name, TCNT1)
+/** @brief  Start region of any length */
+# define PROF_BEGIN_LONG(name) \
+    uint32_t prof_us_##name = micros(); \
+    uint16_t prof_t_##name = TCNT1
+/** @brief  End region started by PROF_BEGIN_LONG() */
+# define PROF_END_LONG(name) \
+    prof_end_long(PROF_##name, prof_t_##name, TCNT1, prof_us_##name)
+#else
+# define PROF_BEGIN(name)
+# define PROF_END(name)
+# define PROF_BEGIN_LONG(name)
+# define PROF_END_LONG(name)
+#endif
+
+
+// -- Types ----------------------------------------------------------
+/**
+ * @brief  Statistics of one region in CPU cycles.
+ */
+typedef struct {
+    uint32_t count;    /**< @brief Number of runs */
+    uint32_t min;      /**< @brief Shortest run */
+    uint32_t max;      /**< @brief Longest run */
+    uint32_t mean;     /**< @brief Average run */
+} prof_stats_t;
+
+
+// -- Function prototypes --------------------------------------------
+#ifdef PROF_ENABLE
+/**
+ * @brief  Clear statistics and measure cost of an empty region.
+ * @return none
+ * @note   Timer/Counter1 must be running.
+ */
+void prof_init(void);
+
+
+/**
+ * @brief  Add run of short region, called by PROF_END().
+ * @param  id Region identifier
+ * @param  start TCNT1 at start of region
+ * @param  end TCNT1 at end of region
+ * @return none
+ */
+void prof_end(uint8_t id, uint16_t start, uint16_t end);
+
+
+/**
+ * @brief  Add run of long region, called by PROF_END_LONG().
+ * @param  id Region identifier
+ * @param  start TCNT1 at start of region
+ * @param  end TCNT1 at end of region
+ * @param  start_us micros() at start of region
+ * @return none
+ */
+void prof_end_long(uint8_t id, uint16_t start, uint16_t end,
+                   uint32_t start_us);
+
+
+/**
+ * @brief  Copy statistics of one region.
+ * @param  id Region identifier
+ * @param  stats Pointer to statistics
+ * @return none
+ */
+void prof_get(uint8_t id, prof_stats_t *stats);
+
+
+/**
+ * @brief  Get label of region.
+ * @param  id Region identifier
+ * @return Label in program memory
+ */
+const char *prof_label(uint8_t id);
+#endif
+
+
+/** @} */
+
+#endif
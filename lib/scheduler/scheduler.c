@@ -0,0 +1,188 @@
+/*
+ * Cooperative task scheduler for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <scheduler.h>
+
+
+// -- Types ----------------------------------------------------------
+typedef struct {
+    void (*fn)(void);
+    uint16_t period;
+    uint8_t priority;
+    uint32_t due;
+    sched_stats_t stats;
+} sched_task_t;
+
+
+// -- Global variables -----------------------------------------------
+static sched_task_t sched_tasks[SCHED_MAX_TASKS];
+static uint8_t sched_count = 0;
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: sched_init()
+ * Purpose:  Clear the task table.
+ * Returns:  none
+ */
+void sched_init(void)
+{
+    sched_count = 0;
+}
+
+
+/*
+ * Function: sched_add()
+ * Purpose:  Register a periodic task.
+ * Input(s): fn - Task function
+ *           period_ms - Period in milliseconds
+ *           priority - Lowest value runs first
+ * Returns:  Task identifier, SCHED_NO_TASK if the table is full
+ */
+uint8_t sched_add(void (*fn)(void), uint16_t period_ms, uint8_t priority)
+{
+    sched_task_t *t;
+
+    if (sched_count >= SCHED_MAX_TASKS)
+        return SCHED_NO_TASK;
+    if (period_ms == 0)
+        period_ms = 1;
+
+    t = &sched_tasks[sched_count];
+    t->fn = fn;
+    t->period = period_ms;
+    t->priority = priority;
+    t->due = millis() + period_ms;
+    t->stats.runs = 0;
+    t->stats.total_us = 0;
+    t->stats.max_us = 0;
+    t->stats.late = 0;
+
+    return sched_count++;
+}
+
+
+/*
+ * Function: sched_set_period()
+ * Purpose:  Change period of a task.
+ * Input(s): id - Task identifier
+ *           period_ms - New period in milliseconds
+ * Returns:  none
+ */
+void sched_set_period(uint8_t id, uint16_t period_ms)
+{
+    if (id >= sched_count)
+        return;
+    if (period_ms == 0)
+        period_ms = 1;
+
+    sched_tasks[id].period = period_ms;
+    sched_tasks[id].due = millis() + period_ms;
+}
+
+
+/*
+ * Function: sched_delay()
+ * Purpose:  Move the next run of a task, keep its period.
+ * Input(s): id - Task identifier
+ *           delay_ms - Time from now to the next run in milliseconds
+ * Returns:  none
+ */
+void sched_delay(uint8_t id, uint16_t delay_ms)
+{
+    if (id >= sched_count)
+        return;
+
+    sched_tasks[id].due = millis() + delay_ms;
+}
+
+
+/*
+ * Function: sched_dispatch()
+ * Purpose:  Run all tasks which are due, in order of priority.
+ * Returns:  Number of tasks run
+ */
+uint8_t sched_dispatch(void)
+{
+    uint8_t n_runs = 0;
+
+    while (1) {
+        uint32_t now = millis();
+        sched_task_t *next = 0;
+
+        // Highest priority task which is due
+        for (uint8_t i = 0; i < sched_count; i++) {
+            sched_task_t *t = &sched_tasks[i];
+            if ((int32_t)(now - t->due) >= 0 &&
+                (next == 0 || t->priority < next->priority))
+                next = t;
+        }
+        if (next == 0)
+            break;
+
+        // Keep fixed rate, skip periods missed as a whole
+        if (now - next->due >= next->period) {
+            next->due = now + next->period;
+            if (next->stats.late != UINT16_MAX)
+                next->stats.late++;
+        }
+        else {
+            next->due += next->period;
+        }
+
+        uint32_t start = micros();
+        next->fn();
+        uint32_t elapsed = micros() - start;
+
+        // Saturate rather than wrap, the average stays meaningful
+        if (next->stats.runs != UINT16_MAX) {
+            next->stats.runs++;
+            next->stats.total_us += elapsed;
+        }
+        if (elapsed > UINT16_MAX)
+            elapsed = UINT16_MAX;
+        if (elapsed > next->stats.max_us)
+            next->stats.max_us = elapsed;
+        n_runs++;
+    }
+
+    return n_runs;
+}
+
+
+/*
+ * Function: sched_get_stats()
+ * Purpose:  Read run-time statistics of one task.
+ * Input(s): id - Task identifier
+ *           stats - Pointer to statistics structure
+ * Returns:  none
+ */
+void sched_get_stats(uint8_t id, sched_stats_t *stats)
+{
+    if (id >= sched_count)
+        return;
+    *stats = sched_tasks[id].stats;
+}
+
+
+/*
+ * Function: sched_reset_stats()
+ * Purpose:  Clear run-time statistics of all tasks.
+ * Returns:  none
+ */
+void sched_reset_stats(void)
+{
+    for (uint8_t i = 0; i < sched_count; i++) {
+        sched_tasks[i].stats.runs = 0;
+        sched_tasks[i].stats.total_us = 0;
+        sched_tasks[i].stats.max_us = 0;
+        sched_tasks[i].stats.late = 0;
+    }
+}
+
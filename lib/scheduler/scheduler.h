@@ -0,0 +1,134 @@
+#ifndef SCHEDULER_H
+# define SCHEDULER_H
+
+/*
+ * Cooperative task scheduler for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup sched Scheduler Library <scheduler.h>
+ * @code #include <scheduler.h> @endcode
+ *
+ * @brief Cooperative scheduler of periodic tasks with 1 ms tick.
+ *
+ * The 1 ms tick of the time base library (Timer/Counter0) drives the
+ * scheduler. Tasks are plain functions registered with their own period
+ * and priority; they run to completion from the main loop, never from an
+ * interrupt. The run time of every task is measured with micros().
+ *
+ * @code
+ * timebase_init();
+ * sched_init();
+ * sched_add(task_display, 500, 2);
+ * sei();
+ * while (1) {
+ *     if (!sched_dispatch())
+ *         ;  // idle, may sleep until next interrupt
+ * }
+ * @endcode
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <avr/io.h>
+#include <timebase.h>
+
+
+// -- Defines --------------------------------------------------------
+/**
+ * @brief  Maximum number of tasks.
+ */
+#ifndef SCHED_MAX_TASKS
+# define SCHED_MAX_TASKS 8
+#endif
+
+/** @brief  Returned by sched_add() when the table is full */
+#define SCHED_NO_TASK 0xff
+
+
+// -- Types ----------------------------------------------------------
+/**
+ * @brief  Run-time statistics of one task.
+ *
+ * Counters saturate at 65535. Once runs saturates, total_us stops too,
+ * so total_us / runs stays the average of the counted runs.
+ */
+typedef struct {
+    uint16_t runs;      /**< @brief Number of runs */
+    uint32_t total_us;  /**< @brief Sum of run times of counted runs */
+    uint16_t max_us;    /**< @brief Longest run time */
+    uint16_t late;      /**< @brief Runs started a whole period late */
+} sched_stats_t;
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Clear the task table.
+ * @return none
+ * @note   The time base must be started by timebase_init().
+ */
+void sched_init(void);
+
+
+/**
+ * @brief  Register a periodic task.
+ * @param  fn Task function, must return quickly
+ * @param  period_ms Period in milliseconds, 1 or more
+ * @param  priority When more tasks are due, the lowest value runs first
+ * @return Task identifier, SCHED_NO_TASK if the table is full
+ * @note   First run is one period after registration.
+ */
+uint8_t sched_add(void (*fn)(void), uint16_t period_ms, uint8_t priority);
+
+
+/**
+ * @brief  Change period of a task.
+ * @param  id Task identifier
+ * @param  period_ms New period in milliseconds
+ * @return none
+ */
+void sched_set_period(uint8_t id, uint16_t period_ms);
+
+
+/**
+ * @brief  Move the next run of a task, keep its period.
+ * @param  id Task identifier
+ * @param  delay_ms Time from now to the next run in milliseconds
+ * @return none
+ * @note   Following runs come one period apart, counted from the
+ *         delayed run.
+ */
+void sched_delay(uint8_t id, uint16_t delay_ms);
+
+
+/**
+ * @brief  Run all tasks which are due, in order of priority.
+ * @return Number of tasks run, 0 if the CPU may go idle
+ */
+uint8_t sched_dispatch(void);
+
+
+/**
+ * @brief  Read run-time statistics of one task.
+ * @param  id Task identifier
+ * @param  stats Pointer to statistics structure
+ * @return none
+ */
+void sched_get_stats(uint8_t id, sched_stats_t *stats);
+
+
+/**
+ * @brief  Clear run-time statistics of all tasks.
+ * @return none
+ */
+void sched_reset_stats(void);
+
+
+/** @} */
+
+#endif
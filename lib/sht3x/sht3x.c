@@ -0,0 +1,106 @@
+/*
+ * SHT3x temperature and humidity sensor driver for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <sht3x.h>
+#include <twi.h>
+#include <avr/pgmspace.h>
+
+
+// -- Defines --------------------------------------------------------
+#define SHT3X_DATA_LEN 6  // Temperature, CRC, humidity, CRC
+
+
+// -- Global variables -----------------------------------------------
+static const char sht3x_name[] PROGMEM = "SHT3x";
+// Single shot, high repeatability, clock stretching disabled
+static const uint8_t sht3x_cmd_measure[] = {0x24, 0x00};
+static const uint8_t sht3x_cmd_status[] = {0xf3, 0x2d};
+static uint8_t sht3x_adr = SHT3X_ADR;
+static uint8_t sht3x_raw[SHT3X_DATA_LEN];  // Filled by TWI interrupt
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: sht3x_probe()
+ * Purpose:  Find the sensor on one of its addresses and read its status
+ *           register to tell it from other devices.
+ * Returns:  1 if present, 0 otherwise
+ */
+static uint8_t sht3x_probe(void)
+{
+    uint8_t status[3];
+
+    for (sht3x_adr = SHT3X_ADR; sht3x_adr <= SHT3X_ADR_ALT; sht3x_adr++) {
+        if (twi_test_address(sht3x_adr) != 0)
+            continue;
+        if (twi_transfer(sht3x_adr, sht3x_cmd_status, 2, status, 3) == 0
+            && climate_crc8(status, 2) == status[2])
+            return 1;
+    }
+    return 0;
+}
+
+
+/*
+ * Function: sht3x_start()
+ * Purpose:  Send single shot measurement command in background.
+ * Returns:  CLIMATE_BUSY if started
+ */
+static uint8_t sht3x_start(void)
+{
+    return twi_async_start(sht3x_adr, sht3x_cmd_measure, 2, 0, 0);
+}
+
+
+/*
+ * Function: sht3x_fetch()
+ * Purpose:  Start reading of results in background.
+ * Returns:  CLIMATE_BUSY if started
+ * Note:     The sensor does not acknowledge its address until the
+ *           conversion is done.
+ */
+static uint8_t sht3x_fetch(void)
+{
+    return twi_async_start(sht3x_adr, 0, 0, sht3x_raw, SHT3X_DATA_LEN);
+}
+
+
+/*
+ * Function: sht3x_decode()
+ * Purpose:  Check and convert fetched results.
+ * Input(s): data - Pointer to sample structure
+ * Returns:  CLIMATE_OK or CLIMATE_CHECKSUM
+ */
+static uint8_t sht3x_decode(climate_data_t *data)
+{
+    uint16_t raw_t;
+    uint16_t raw_h;
+
+    if (climate_crc8(&sht3x_raw[0], 2) != sht3x_raw[2]
+        || climate_crc8(&sht3x_raw[3], 2) != sht3x_raw[5])
+        return CLIMATE_CHECKSUM;
+
+    raw_t = (sht3x_raw[0] << 8) | sht3x_raw[1];
+    raw_h = (sht3x_raw[3] << 8) | sht3x_raw[4];
+
+    // T = -45 + 175 * raw / (2^16 - 1), RH = 100 * raw / (2^16 - 1)
+    data->temperature = (int16_t)((1750UL * raw_t) >> 16) - 450;
+    data->humidity = (1000UL * raw_h) >> 16;
+    return CLIMATE_OK;
+}
+
+
+const climate_driver_t sht3x_driver PROGMEM = {
+    .name = sht3x_name,
+    .probe = sht3x_probe,
+    .start = sht3x_start,
+    .fetch = sht3x_fetch,
+    .decode = sht3x_decode,
+    .conv_ms = 16,
+};
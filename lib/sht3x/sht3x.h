@@ -0,0 +1,43 @@
+#ifndef SHT3X_H
+# define SHT3X_H
+
+/*
+ * SHT3x temperature and humidity sensor driver for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup sht3x SHT3x Sensor Library <sht3x.h>
+ * @code #include <sht3x.h> @endcode
+ *
+ * @brief Driver of Sensirion SHT30/31/35 sensors for the climate layer.
+ *
+ * Single shot measurement with high repeatability and without clock
+ * stretching, so the bus is free during the 15 ms conversion. Both
+ * results are protected by CRC-8. Use the driver through climate.h.
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <climate.h>
+
+
+// -- Defines --------------------------------------------------------
+/** @brief  I2C slave address with ADDR pin low */
+#define SHT3X_ADR     0x44
+/** @brief  I2C slave address with ADDR pin high */
+#define SHT3X_ADR_ALT 0x45
+
+
+// -- Global variables -----------------------------------------------
+/** @brief  Operations of SHT3x for climate_init(), in program memory */
+extern const climate_driver_t sht3x_driver;
+
+
+/** @} */
+
+#endif
@@ -0,0 +1,221 @@
+/*
+ * Sliding-window statistics for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stats.h>
+#include <string.h>
+
+
+// -- Defines --------------------------------------------------------
+#if STATS_BUCKETS > 8
+# error "STATS_BUCKETS must be at most 8"
+#endif
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: stats_init()
+ * Purpose:  Clear all windows.
+ * Input(s): s - Pointer to channel statistics
+ * Returns:  none
+ */
+void stats_init(stats_t *s)
+{
+    memset(s, 0, sizeof(stats_t));
+}
+
+
+/*
+ * Function: acc_add()
+ * Purpose:  Add one sample or closed bucket to accumulator.
+ * Input(s): a - Pointer to accumulator
+ *           min, max, mean, var - Values of bucket (of sample: x, x, x, 0)
+ * Returns:  none
+ */
+static void acc_add(stats_acc_t *a, int16_t min, int16_t max, int16_t mean,
+                    uint16_t var)
+{
+    int16_t d;
+
+    if (a->n == 255)
+        return;
+    if (a->n == 0) {
+        a->min = min;
+        a->max = max;
+        a->x0 = mean;
+    }
+    else {
+        if (min < a->min)
+            a->min = min;
+        if (max > a->max)
+            a->max = max;
+    }
+    d = mean - a->x0;
+    a->s1 += d;
+    a->s2 += (uint32_t)((int32_t)d * d) + var;
+    a->n++;
+}
+
+
+/*
+ * Function: deque_push()
+ * Purpose:  Append bucket position to monotonic deque and drop entries
+ *           which can no longer be the extreme of the window.
+ * Input(s): q - Pointer to deque
+ *           b - Buckets of the level
+ *           pos - Position of the new bucket
+ *           use_max - 0 for minimum deque, 1 for maximum deque
+ * Returns:  none
+ */
+static void deque_push(stats_deque_t *q, const stats_bucket_t *b,
+                       uint8_t pos, uint8_t use_max)
+{
+    uint8_t back;
+
+    while (q->len != 0) {
+        back = q->pos[(q->head + q->len - 1) % STATS_BUCKETS];
+        if (use_max ? (b[back].max > b[pos].max) : (b[back].min < b[pos].min))
+            break;
+        q->len--;
+    }
+    q->pos[(q->head + q->len) % STATS_BUCKETS] = pos;
+    q->len++;
+}
+
+
+/*
+ * Function: deque_evict()
+ * Purpose:  Remove bucket position which leaves the window.
+ * Input(s): q - Pointer to deque
+ *           pos - Position being overwritten
+ * Returns:  none
+ */
+static void deque_evict(stats_deque_t *q, uint8_t pos)
+{
+    if (q->len != 0 && q->pos[q->head] == pos) {
+        q->head = (q->head + 1) % STATS_BUCKETS;
+        q->len--;
+    }
+}
+
+
+/*
+ * Function: level_close()
+ * Purpose:  Close current bucket of one level and slide its window.
+ * Input(s): l - Pointer to level
+ *           out - Pointer to closed bucket
+ * Returns:  1 if a bucket has been closed, 0 if it was empty
+ */
+static uint8_t level_close(stats_level_t *l, stats_bucket_t *out)
+{
+    stats_acc_t *a = &l->acc;
+    stats_bucket_t *b;
+    int32_t mean;
+    int64_t var;
+
+    if (a->n == 0)
+        return 0;
+
+    // var = s2/n - (s1/n)^2, relative to x0
+    mean = a->s1 / a->n;
+    var = ((int64_t)a->n * a->s2 - (int64_t)a->s1 * a->s1)
+          / ((uint16_t)a->n * a->n);
+    out->min = a->min;
+    out->max = a->max;
+    out->mean = a->x0 + mean;
+    out->var = var > 65535 ? 65535 : var;
+    memset(a, 0, sizeof(stats_acc_t));
+
+    // Oldest bucket leaves the window
+    b = &l->bucket[l->pos];
+    if (l->count == STATS_BUCKETS) {
+        deque_evict(&l->min_q, l->pos);
+        deque_evict(&l->max_q, l->pos);
+        l->sum_mean -= b->mean;
+        l->sum_sq -= b->var + (uint32_t)((int32_t)b->mean * b->mean);
+    }
+    else
+        l->count++;
+
+    *b = *out;
+    l->sum_mean += b->mean;
+    l->sum_sq += b->var + (uint32_t)((int32_t)b->mean * b->mean);
+    deque_push(&l->min_q, l->bucket, l->pos, 0);
+    deque_push(&l->max_q, l->bucket, l->pos, 1);
+
+    l->pos = (l->pos + 1) % STATS_BUCKETS;
+    return 1;
+}
+
+
+/*
+ * Function: stats_add()
+ * Purpose:  Add one sample to the current bucket.
+ * Input(s): s - Pointer to channel statistics
+ *           x - Sample value
+ * Returns:  none
+ */
+void stats_add(stats_t *s, int16_t x)
+{
+    acc_add(&s->level[0].acc, x, x, x, 0);
+}
+
+
+/*
+ * Function: stats_tick()
+ * Purpose:  Close the current bucket and slide the windows.
+ * Input(s): s - Pointer to channel statistics
+ * Returns:  none
+ */
+void stats_tick(stats_t *s)
+{
+    static const uint8_t ratio[STATS_LEVELS] = {1, STATS_RATIO_1, STATS_RATIO_2};
+    stats_bucket_t b;
+    stats_level_t *l;
+
+    for (uint8_t i = 0; i < STATS_LEVELS; i++) {
+        l = &s->level[i];
+        // Level closes after `ratio` closes of the level below
+        if (++l->ticks < ratio[i])
+            return;
+        l->ticks = 0;
+        if (!level_close(l, &b))
+            return;
+        if (i+1 < STATS_LEVELS)
+            acc_add(&s->level[i+1].acc, b.min, b.max, b.mean, b.var);
+    }
+}
+
+
+/*
+ * Function: stats_get()
+ * Purpose:  Read statistics of one window.
+ * Input(s): s - Pointer to channel statistics
+ *           level - STATS_1MIN, STATS_10MIN or STATS_1H
+ *           r - Pointer to result structure
+ * Returns:  Number of buckets in the window
+ */
+uint8_t stats_get(const stats_t *s, uint8_t level, stats_result_t *r)
+{
+    const stats_level_t *l;
+    int64_t var;
+
+    if (level >= STATS_LEVELS || s->level[level].count == 0)
+        return 0;
+    l = &s->level[level];
+
+    r->min = l->bucket[l->min_q.pos[l->min_q.head]].min;
+    r->max = l->bucket[l->max_q.pos[l->max_q.head]].max;
+    r->mean = l->sum_mean / l->count;
+    // Law of total variance over equally weighted buckets
+    var = ((int64_t)l->count * l->sum_sq - (int64_t)l->sum_mean * l->sum_mean)
+          / (l->count * l->count);
+    r->var = var < 0 ? 0 : var;
+
+    return l->count;
+}
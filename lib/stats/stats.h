@@ -0,0 +1,182 @@
+#ifndef STATS_H
+# define STATS_H
+
+/*
+ * Sliding-window statistics for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup stats Statistics Library <stats.h>
+ * @code #include <stats.h> @endcode
+ *
+ * @brief Minimum, maximum, mean and variance of one channel over
+ *        cascaded sliding windows, in fixed memory.
+ *
+ * Samples are accumulated into a bucket which is closed by each call of
+ * stats_tick(). A window of each level holds the last STATS_BUCKETS
+ * buckets. Each closed bucket of a level is also accumulated into the
+ * current bucket of the next level, which closes after STATS_RATIO_1
+ * (STATS_RATIO_2) buckets of the level below. With stats_tick() every
+ * 30 s the windows span 1 min, 10 min and 1 h. Each level takes
+ * 34 + 8 * STATS_BUCKETS bytes of RAM.
+ *
+ * Sliding minimum and maximum come from monotonic deques of bucket
+ * positions (amortized O(1) per bucket). Mean and variance come from
+ * running sums, updated when a bucket enters or leaves the window.
+ * Buckets of one level are weighted equally, so the sample rate should
+ * be steady.
+ *
+ * @code
+ * stats_t temp_stats;
+ * stats_init(&temp_stats);
+ * stats_add(&temp_stats, value);  // with each sample
+ * stats_tick(&temp_stats);        // every 30 s
+ * if (stats_get(&temp_stats, STATS_1H, &result))
+ *     // result.min, result.max, ...
+ * @endcode
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdint.h>
+
+
+// -- Defines --------------------------------------------------------
+/** @brief  Number of buckets in a window, at most 8 */
+#ifndef STATS_BUCKETS
+# define STATS_BUCKETS 2
+#endif
+
+/** @brief  Buckets of level 0 per bucket of level 1 */
+#ifndef STATS_RATIO_1
+# define STATS_RATIO_1 10
+#endif
+
+/** @brief  Buckets of level 1 per bucket of level 2 */
+#ifndef STATS_RATIO_2
+# define STATS_RATIO_2 6
+#endif
+
+/** @brief  Number of cascaded windows */
+#define STATS_LEVELS 3
+
+/**
+ * @name  Windows with stats_tick() every 30 s
+ */
+#define STATS_1MIN  0  /**< @brief 2 buckets of 30 s */
+#define STATS_10MIN 1  /**< @brief 2 buckets of 5 min */
+#define STATS_1H    2  /**< @brief 2 buckets of 30 min */
+
+
+// -- Types ----------------------------------------------------------
+/**
+ * @brief  Accumulator of one bucket being filled.
+ * @note   Sums are relative to the first value to keep them small.
+ */
+typedef struct {
+    uint8_t n;     /**< @brief Number of values */
+    int16_t min;   /**< @brief Smallest value */
+    int16_t max;   /**< @brief Largest value */
+    int16_t x0;    /**< @brief First mean value, offset of sums */
+    int32_t s1;    /**< @brief Sum of means minus x0 */
+    uint32_t s2;   /**< @brief Sum of variances and squared means */
+} stats_acc_t;
+
+/**
+ * @brief  One closed bucket.
+ */
+typedef struct {
+    int16_t min;   /**< @brief Smallest sample */
+    int16_t max;   /**< @brief Largest sample */
+    int16_t mean;  /**< @brief Mean of samples */
+    uint16_t var;  /**< @brief Variance, limited to 65535 */
+} stats_bucket_t;
+
+/**
+ * @brief  Monotonic deque of bucket positions.
+ */
+typedef struct {
+    uint8_t pos[STATS_BUCKETS];  /**< @brief Positions, front at head */
+    uint8_t head;                /**< @brief Index of front */
+    uint8_t len;                 /**< @brief Number of positions */
+} stats_deque_t;
+
+/**
+ * @brief  One window level.
+ */
+typedef struct {
+    stats_acc_t acc;                        /**< @brief Current bucket */
+    stats_bucket_t bucket[STATS_BUCKETS];   /**< @brief Closed buckets */
+    stats_deque_t min_q;                    /**< @brief Rising minima */
+    stats_deque_t max_q;                    /**< @brief Falling maxima */
+    int32_t sum_mean;                       /**< @brief Sum of means */
+    uint32_t sum_sq;                        /**< @brief Sum of var+mean^2 */
+    uint8_t pos;                            /**< @brief Next bucket */
+    uint8_t count;                          /**< @brief Closed buckets */
+    uint8_t ticks;                          /**< @brief Closes below */
+} stats_level_t;
+
+/**
+ * @brief  Statistics of one channel.
+ */
+typedef struct {
+    stats_level_t level[STATS_LEVELS];  /**< @brief Cascaded windows */
+} stats_t;
+
+/**
+ * @brief  Statistics of one window.
+ */
+typedef struct {
+    int16_t min;    /**< @brief Smallest sample */
+    int16_t max;    /**< @brief Largest sample */
+    int16_t mean;   /**< @brief Mean of samples */
+    uint32_t var;   /**< @brief Variance of samples */
+} stats_result_t;
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Clear all windows.
+ * @param  s Pointer to channel statistics
+ * @return none
+ */
+void stats_init(stats_t *s);
+
+
+/**
+ * @brief  Add one sample to the current bucket.
+ * @param  s Pointer to channel statistics
+ * @param  x Sample value
+ * @return none
+ * @note   At most 255 samples per bucket, further ones are ignored.
+ */
+void stats_add(stats_t *s, int16_t x);
+
+
+/**
+ * @brief  Close the current bucket and slide the windows.
+ * @param  s Pointer to channel statistics
+ * @return none
+ * @note   A bucket without samples is skipped.
+ */
+void stats_tick(stats_t *s);
+
+
+/**
+ * @brief  Read statistics of one window.
+ * @param  s Pointer to channel statistics
+ * @param  level STATS_1MIN, STATS_10MIN or STATS_1H
+ * @param  r Pointer to result structure
+ * @return Number of buckets in the window, 0 if it is empty
+ */
+uint8_t stats_get(const stats_t *s, uint8_t level, stats_result_t *r);
+
+
+/** @} */
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ * Binary telemetry frames for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <util/crc16.h>
+#include <telem.h>
+#include <uart.h>
+
+
+// -- Defines --------------------------------------------------------
+#define COBS_BLOCK_MAX 0xff  // Code of a block with 254 data bytes
+
+
+// -- Global variables -----------------------------------------------
+static uint16_t telem_seq = 0;
+static unsigned int cobs_pos;   // Ringbuffer position of code byte
+static uint8_t cobs_code;       // Data bytes in block + 1
+static uint16_t frame_crc;
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: cobs_block()
+ * Purpose:  Start a COBS block with a placeholder of its code byte.
+ * Returns:  none
+ */
+static void cobs_block(void)
+{
+    cobs_pos = uart_tx_put(0);
+    cobs_code = 1;
+}
+
+
+/*
+ * Function: cobs_put()
+ * Purpose:  Encode one byte into the frame. A zero ends the block, its
+ *           code byte gets the distance to this zero.
+ * Input(s): data - Byte of record
+ * Returns:  none
+ */
+static void cobs_put(uint8_t data)
+{
+    if (data == 0) {
+        uart_tx_patch(cobs_pos, cobs_code);
+        cobs_block();
+        return;
+    }
+
+    uart_tx_put(data);
+    if (++cobs_code == COBS_BLOCK_MAX) {
+        uart_tx_patch(cobs_pos, cobs_code);
+        cobs_block();
+    }
+}
+
+
+/*
+ * Function: put_byte()
+ * Purpose:  Add one byte of record to the CRC and to the frame.
+ * Input(s): data - Byte of record
+ * Returns:  none
+ */
+static void put_byte(uint8_t data)
+{
+    frame_crc = _crc16_update(frame_crc, data);
+    cobs_put(data);
+}
+
+
+/*
+ * Function: put_word()
+ * Purpose:  Add 16-bit field, little endian.
+ * Input(s): data - Value
+ * Returns:  none
+ */
+static void put_word(uint16_t data)
+{
+    put_byte(data & 0xff);
+    put_byte(data >> 8);
+}
+
+
+/*
+ * Function: telem_send()
+ * Purpose:  Encode one record into the UART ringbuffer if it fits.
+ * Input(s): type - Record type
+ *           time - Timestamp in milliseconds
+ *           values - Channel values
+ *           count - Number of values
+ * Returns:  1 if sent, 0 if dropped
+ */
+uint8_t telem_send(uint8_t type, uint32_t time, const int16_t *values,
+                   uint8_t count)
+{
+    uint16_t crc;
+
+    if (count > TELEM_MAX_CHANNELS)
+        count = TELEM_MAX_CHANNELS;
+
+    // Lost records leave a gap in sequence numbers
+    telem_seq++;
+    if (!uart_tx_begin(TELEM_FRAME_MAX(count)))
+        return 0;
+
+    uart_tx_put(0);
+    cobs_block();
+    frame_crc = 0xffff;
+
+    put_byte(type);
+    put_word(telem_seq);
+    put_word(time & 0xffff);
+    put_word(time >> 16);
+    put_byte(count);
+    for (uint8_t i = 0; i < count; i++)
+        put_word(values[i]);
+
+    // CRC itself is not part of the CRC
+    crc = frame_crc;
+    cobs_put(crc & 0xff);
+    cobs_put(crc >> 8);
+
+    uart_tx_patch(cobs_pos, cobs_code);
+    uart_tx_put(0);
+    uart_tx_commit();
+    return 1;
+}
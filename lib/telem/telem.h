@@ -0,0 +1,85 @@
+#ifndef TELEM_H
+# define TELEM_H
+
+/*
+ * Binary telemetry frames for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup telem Telemetry Library <telem.h>
+ * @code #include <telem.h> @endcode
+ *
+ * @brief Compact binary records of channel values sent over UART.
+ *
+ * One record (all multi-byte fields little endian):
+ *
+ *   | type | sequence | time [ms] | count | values       | CRC-16 |
+ *   | 1 B  | 2 B      | 4 B       | 1 B   | count * 2 B  | 2 B    |
+ *
+ * Values are signed fixed-point numbers, their scale is given by the
+ * record type. The CRC is CRC-16/MODBUS (polynomial 0xa001 reflected,
+ * initial value 0xffff) over all preceding bytes. The record is COBS
+ * encoded, so it contains no zero byte, and sent between two zero
+ * delimiters. A receiver resynchronizes at the next zero and detects
+ * lost records by gaps in the sequence number. Text sent over the same
+ * UART between frames does not break them.
+ *
+ * Each frame is encoded directly into the transmit ringbuffer of the
+ * UART (uart_tx_begin() and uart_tx_patch()), without a staging buffer
+ * and without waiting: when the ringbuffer has no room for the whole
+ * frame, it is not sent at all.
+ *
+ * tools/telem_decode.c is the matching decoder for the host.
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdint.h>
+
+
+// -- Defines --------------------------------------------------------
+/** @brief  Maximum number of values in one record */
+#define TELEM_MAX_CHANNELS 8
+
+/**
+ * @name  Record types
+ */
+/** @brief  Light and soil moisture levels, temperature and humidity in
+ *          tenths of deg C and percent */
+#define TELEM_TYPE_VALUES 1
+/** @brief  Records of the deferred log (dlog.h), each as identifier,
+ *          16-bit time in ms and two arguments */
+#define TELEM_TYPE_LOG 2
+
+/** @brief  Length of record without values */
+#define TELEM_HEADER 8
+
+/** @brief  Largest number of bytes on the wire for count values:
+ *          record, CRC, COBS code bytes and two delimiters */
+#define TELEM_FRAME_MAX(count) \
+    (TELEM_HEADER + 2*(count) + 2 + 1 + (TELEM_HEADER + 2*(count) + 2) / 254 + 2)
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Send one record if the UART has room for it.
+ * @param  type Record type, such as TELEM_TYPE_VALUES
+ * @param  time Timestamp in milliseconds
+ * @param  values Channel values
+ * @param  count Number of values, at most TELEM_MAX_CHANNELS
+ * @return 1 if the frame was passed to the UART, 0 if it was dropped
+ * @note   The sequence number is incremented for dropped records too,
+ *         so the receiver counts them as lost.
+ */
+uint8_t telem_send(uint8_t type, uint32_t time, const int16_t *values,
+                   uint8_t count);
+
+
+/** @} */
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * Millisecond time base for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <timebase.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "timer.h"
+
+
+// -- Defines --------------------------------------------------------
+#define TIMEBASE_TOP TIM_CTC_TOP(1000UL, 64)
+
+#if (64 % (F_CPU / 1000000UL)) != 0 || (1000 % TIMEBASE_US_PER_COUNT) != 0
+# error "Exact 1 ms period with prescaler 64 is not possible at this F_CPU"
+#endif
+
+
+// -- Global variables -----------------------------------------------
+static volatile uint32_t timebase_ms = 0;
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: timebase_init()
+ * Purpose:  Start Timer/Counter0 with exact 1 ms period and its
+ *           interrupt.
+ * Returns:  none
+ */
+void timebase_init(void)
+{
+    TIM0_stop();
+    timebase_ms = 0;
+    TCNT0 = 0;
+    TIM0_ctc_1ms();
+    TIFR0 = (1<<OCF0A);
+    TIM0_compare_interrupt_enable();
+}
+
+
+/*
+ * Function: millis()
+ * Purpose:  Read milliseconds since timebase_init().
+ * Returns:  Millisecond counter
+ */
+uint32_t millis(void)
+{
+    uint32_t ms;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        ms = timebase_ms;
+    }
+    return ms;
+}
+
+
+/*
+ * Function: micros()
+ * Purpose:  Read microseconds since timebase_init().
+ * Returns:  Microsecond counter
+ */
+uint32_t micros(void)
+{
+    uint32_t ms;
+    uint8_t cnt;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        ms = timebase_ms;
+        cnt = TCNT0;
+        // Counter already cleared but the tick not counted yet
+        if ((TIFR0 & (1<<OCF0A)) && cnt < TIMEBASE_TOP)
+            ms++;
+    }
+    return ms * 1000 + (uint16_t)cnt * TIMEBASE_US_PER_COUNT;
+}
+
+
+// -- Interrupt service routines -------------------------------------
+/*
+ * Function: Timer/Counter0 compare match A interrupt
+ * Purpose:  Count milliseconds.
+ */
+ISR(TIMER0_COMPA_vect)
+{
+    timebase_ms++;
+}
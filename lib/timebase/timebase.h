@@ -0,0 +1,68 @@
+#ifndef TIMEBASE_H
+# define TIMEBASE_H
+
+/*
+ * Millisecond time base for AVR-GCC.
+ * (c) 2024 MIT license
+ *
+ * Written for PlatformIO and AVR 8-bit Toolchain 3.6.2, ATmega328P at
+ * 16 MHz. Not yet run on hardware.
+ */
+
+/**
+ * @file
+ * @defgroup timebase Time Base Library <timebase.h>
+ * @code #include <timebase.h> @endcode
+ *
+ * @brief System time base with 1 ms tick of Timer/Counter0.
+ *
+ * Timer/Counter0 runs in CTC mode with an exact 1 ms period and its
+ * compare match interrupt counts milliseconds. Both counters are 32-bit
+ * and read atomically, micros() adds the current timer count.
+ *
+ * @note Timer/Counter0 is reserved for the time base.
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <avr/io.h>
+
+
+// -- Defines --------------------------------------------------------
+#ifndef F_CPU
+# define F_CPU 16000000 /**< @brief CPU frequency in Hz required for 1 ms period */
+#endif
+
+/** @brief  Resolution of micros() in microseconds (prescaler 64) */
+#define TIMEBASE_US_PER_COUNT (64 / (F_CPU / 1000000UL))
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Start Timer/Counter0 with exact 1 ms period and its
+ *         interrupt.
+ * @return none
+ * @note   Global interrupts must be enabled by sei().
+ */
+void timebase_init(void);
+
+
+/**
+ * @brief  Read milliseconds since timebase_init().
+ * @return Millisecond counter, wraps after 49.7 days
+ */
+uint32_t millis(void);
+
+
+/**
+ * @brief  Read microseconds since timebase_init().
+ * @return Microsecond counter with TIMEBASE_US_PER_COUNT resolution,
+ *         wraps after 71.6 minutes
+ * @note   Differences of two readings are valid across the wrap.
+ */
+uint32_t micros(void);
+
+
+/** @} */
+
+#endif
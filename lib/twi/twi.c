@@ -13,6 +13,20 @@
 
 /* Includes ----------------------------------------------------------*/
 #include <twi.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <prof.h>
+
+
+/* Variables ---------------------------------------------------------*/
+static volatile uint8_t twi_async_state = TWI_ASYNC_OK;
+static uint8_t twi_async_sla;
+static const uint8_t *twi_async_wbuf;
+static uint8_t twi_async_wlen;
+static uint8_t *twi_async_rbuf;
+static uint8_t twi_async_rlen;
+static uint8_t twi_async_idx;
+static volatile uint16_t twi_async_isr_cycles = 0;
 
 
 /* Functions ---------------------------------------------------------*/
@@ -34,6 +48,21 @@ void twi_init(void)
 }
 
 
+/**********************************************************************
+ * Function: twi_set_speed()
+ * Purpose:  Change SCL frequency, fscl = fcpu/(16 + 2*TWBR).
+ * Input(s): khz - SCL frequency in kHz
+ * Returns:  none
+ **********************************************************************/
+void twi_set_speed(uint16_t khz)
+{
+    /* Wait for end of background transaction */
+    while (twi_async_state == TWI_ASYNC_BUSY);
+
+    TWBR = (F_CPU / 1000 / khz - 16) / 2;
+}
+
+
 /**********************************************************************
  * Function: twi_start()
  * Purpose:  Start communication on I2C/TWI bus.
@@ -41,6 +70,9 @@ void twi_init(void)
  **********************************************************************/
 void twi_start(void)
 {
+    /* Wait for end of background transaction */
+    while (twi_async_state == TWI_ASYNC_BUSY);
+
     /* Send Start condition */
     TWCR = (1<<TWINT) | (1<<TWSTA) | (1<<TWEN);
     while ((TWCR & (1<<TWINT)) == 0);
@@ -124,3 +156,213 @@ uint8_t twi_test_address(uint8_t adr)
 
     return ack;
 }
+
+
+/**********************************************************************
+ * Function: twi_transfer()
+ * Purpose:  Write bytes and read bytes after a repeated start.
+ * Input:    adr Slave address
+ *           wbuf, wlen Bytes to write
+ *           rbuf, rlen Buffer for bytes to read
+ * Returns:  ACK/NACK received value
+ **********************************************************************/
+uint8_t twi_transfer(uint8_t adr, const uint8_t *wbuf, uint8_t wlen,
+                     uint8_t *rbuf, uint8_t rlen)
+{
+    uint8_t ack = 0;
+
+    if (wlen != 0 || rlen == 0) {
+        twi_start();
+        ack = twi_write((adr<<1) | TWI_WRITE);
+        while (ack == 0 && wlen-- != 0)
+            ack = twi_write(*wbuf++);
+    }
+    if (ack == 0 && rlen != 0) {
+        /* Start, or repeated start after writing */
+        twi_start();
+        ack = twi_write((adr<<1) | TWI_READ);
+        if (ack == 0) {
+            while (--rlen != 0)
+                *rbuf++ = twi_read(TWI_ACK);
+            *rbuf = twi_read(TWI_NACK);
+        }
+    }
+    twi_stop();
+
+    return ack;
+}
+
+
+/**********************************************************************
+ * Function: twi_readfrom_mem_into()
+ * Purpose:  Read bytes from internal memory of Slave.
+ * Input:    adr Slave address
+ *           memadr Address of the first byte in Slave memory
+ *           buf, nbytes Buffer for bytes to read
+ * Returns:  ACK/NACK received value
+ **********************************************************************/
+uint8_t twi_readfrom_mem_into(uint8_t adr, uint8_t memadr, uint8_t *buf,
+                              uint8_t nbytes)
+{
+    return twi_transfer(adr, &memadr, 1, buf, nbytes);
+}
+
+
+/**********************************************************************
+ * Function: twi_async_start()
+ * Purpose:  Start background transaction: write bytes, then read bytes
+ *           after a repeated start.
+ * Input:    adr Slave address
+ *           wbuf, wlen Bytes to write
+ *           rbuf, rlen Buffer for bytes to read
+ * Returns:  TWI_ASYNC_BUSY if started, TWI_ASYNC_ERROR otherwise
+ **********************************************************************/
+uint8_t twi_async_start(uint8_t adr, const uint8_t *wbuf, uint8_t wlen,
+                        uint8_t *rbuf, uint8_t rlen)
+{
+    if (twi_async_state == TWI_ASYNC_BUSY)
+        return TWI_ASYNC_ERROR;
+
+    twi_async_sla = adr<<1;
+    twi_async_wbuf = wbuf;
+    twi_async_wlen = wlen;
+    twi_async_rbuf = rbuf;
+    twi_async_rlen = rlen;
+    twi_async_idx = 0;
+    twi_async_state = TWI_ASYNC_BUSY;
+
+    /* Send Start condition, continue in interrupt */
+    TWCR = (1<<TWINT) | (1<<TWSTA) | (1<<TWEN) | (1<<TWIE);
+
+    return TWI_ASYNC_BUSY;
+}
+
+
+/**********************************************************************
+ * Function: twi_async_status()
+ * Purpose:  Read result of background transaction.
+ * Returns:  TWI_ASYNC_BUSY, TWI_ASYNC_OK, TWI_ASYNC_NACK, TWI_ASYNC_ERROR
+ **********************************************************************/
+uint8_t twi_async_status(void)
+{
+    return twi_async_state;
+}
+
+
+/**********************************************************************
+ * Function: twi_async_isr_max()
+ * Purpose:  Read longest duration of TWI interrupt.
+ * Returns:  Number of CPU cycles
+ **********************************************************************/
+uint16_t twi_async_isr_max(void)
+{
+    uint16_t cycles;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        cycles = twi_async_isr_cycles;
+    }
+
+    return cycles;
+}
+
+
+/**********************************************************************
+ * Function: twi_async_finish()
+ * Purpose:  Generate Stop condition and store result of transaction.
+ * Input:    result Result of background transaction
+ * Returns:  none
+ **********************************************************************/
+static inline void twi_async_finish(uint8_t result)
+{
+    TWCR = (1<<TWINT) | (1<<TWSTO) | (1<<TWEN);
+    twi_async_state = result;
+}
+
+
+/**********************************************************************
+ * Function: TWI interrupt
+ * Purpose:  Handle one bus event of background transaction.
+ **********************************************************************/
+ISR(TWI_vect)
+{
+#ifdef TWI_ISR_TIMING
+    uint16_t t_start = TCNT1;
+#endif
+    PROF_BEGIN(TWI_ISR);
+
+    switch (TWSR & 0xf8) {
+    /* Start or repeated start has been transmitted */
+    case 0x08:
+    case 0x10:
+        if (twi_async_idx < twi_async_wlen || twi_async_rlen == 0)
+            TWDR = twi_async_sla | TWI_WRITE;
+        else
+            TWDR = twi_async_sla | TWI_READ;
+        TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE);
+        break;
+
+    /* SLA+W or data byte has been transmitted and ACK received */
+    case 0x18:
+    case 0x28:
+        if (twi_async_idx < twi_async_wlen) {
+            TWDR = twi_async_wbuf[twi_async_idx++];
+            TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE);
+        }
+        else if (twi_async_rlen != 0) {
+            /* Repeated start for reading */
+            TWCR = (1<<TWINT) | (1<<TWSTA) | (1<<TWEN) | (1<<TWIE);
+        }
+        else {
+            twi_async_finish(TWI_ASYNC_OK);
+        }
+        break;
+
+    /* SLA+R has been transmitted and ACK received */
+    case 0x40:
+        twi_async_idx = 0;
+        if (twi_async_rlen > 1)
+            TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE) | (1<<TWEA);
+        else
+            TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE);
+        break;
+
+    /* Data byte has been received and ACK returned */
+    case 0x50:
+        twi_async_rbuf[twi_async_idx++] = TWDR;
+        /* NACK the last byte */
+        if (twi_async_idx < twi_async_rlen - 1)
+            TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE) | (1<<TWEA);
+        else
+            TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE);
+        break;
+
+    /* Data byte has been received and NACK returned */
+    case 0x58:
+        twi_async_rbuf[twi_async_idx++] = TWDR;
+        twi_async_finish(TWI_ASYNC_OK);
+        break;
+
+    /* SLA+W, data byte or SLA+R has been transmitted and NACK received */
+    case 0x20:
+    case 0x30:
+    case 0x48:
+        twi_async_finish(TWI_ASYNC_NACK);
+        break;
+
+    /* Arbitration lost, bus error */
+    default:
+        twi_async_finish(TWI_ASYNC_ERROR);
+        break;
+    }
+
+#ifdef TWI_ISR_TIMING
+    uint16_t cycles = TCNT1 - t_start;
+    if (cycles > OCR1A)
+        /* Timer has been cleared at TOP in between */
+        cycles += OCR1A + 1;
+    if (cycles > twi_async_isr_cycles)
+        twi_async_isr_cycles = cycles;
+#endif
+    PROF_END(TWI_ISR);
+}
@@ -23,6 +23,10 @@
  * This library defines functions for the TWI (I2C) communication between
  * AVR and Slave device(s). Functions use internal TWI module of AVR.
  *
+ * Besides the blocking functions, one transaction (write, or write and
+ * read with repeated start) can run in background, driven by the TWI
+ * interrupt. Each interrupt handles one bus event only.
+ *
  * @note Only Master transmitting and Master receiving modes are implemented. Based on Microchip Atmel ATmega16 and ATmega328P manuals.
  * @author Tomas Fryza, Dept. of Radio Electronics, Brno University 
  *         of Technology, Czechia
@@ -66,6 +70,15 @@
 #define PIN(_x) (*(&_x - 2)) /**< @brief Address of input register of port _x */
 
 
+/**
+ * @name Result of background transaction
+ */
+#define TWI_ASYNC_OK 0 /**< @brief Transaction completed */
+#define TWI_ASYNC_BUSY 1 /**< @brief Transaction in progress */
+#define TWI_ASYNC_NACK 2 /**< @brief Slave did not acknowledge */
+#define TWI_ASYNC_ERROR 3 /**< @brief Bus error or arbitration lost */
+
+
 /* Function prototypes -----------------------------------------------*/
 /**
  * @brief  Initialize TWI unit, enable internal pull-ups, and set SCL frequency.
@@ -79,6 +92,15 @@
 void twi_init(void);
 
 
+/**
+ * @brief  Change SCL frequency.
+ * @param  khz SCL frequency in kHz, from 32 to 400
+ * @return none
+ * @note   Waits for the end of a background transaction.
+ */
+void twi_set_speed(uint16_t khz);
+
+
 /**
  * @brief  Start communication on I2C/TWI bus.
  * @return none
@@ -116,6 +138,68 @@ uint8_t twi_read(uint8_t ack);
 void twi_stop(void);
 
 
+/**
+ * @brief  Write bytes and read bytes after a repeated start, blocking.
+ * @param  adr Slave address
+ * @param  wbuf Bytes to write, such as internal memory address
+ * @param  wlen Number of bytes to write, 0 for read only
+ * @param  rbuf Buffer for received bytes
+ * @param  rlen Number of bytes to read, 0 for write only
+ * @return ACK/NACK received value
+ * @retval 0 - All bytes have been acknowledged
+ * @retval 1 - NACK has been received, rbuf is not changed
+ */
+uint8_t twi_transfer(uint8_t adr, const uint8_t *wbuf, uint8_t wlen,
+                     uint8_t *rbuf, uint8_t rlen);
+
+
+/**
+ * @brief  Read bytes from internal memory of Slave, blocking.
+ * @param  adr Slave address
+ * @param  memadr Address of the first byte in Slave memory
+ * @param  buf Buffer for received bytes
+ * @param  nbytes Number of bytes to read
+ * @return ACK/NACK received value, 0 if the bytes have been read
+ */
+uint8_t twi_readfrom_mem_into(uint8_t adr, uint8_t memadr, uint8_t *buf,
+                              uint8_t nbytes);
+
+
+/**
+ * @brief  Start background transaction: write bytes, then read bytes
+ *         after a repeated start.
+ * @param  adr Slave address
+ * @param  wbuf Bytes to write, such as internal memory address
+ * @param  wlen Number of bytes to write, 0 for read only
+ * @param  rbuf Buffer for received bytes
+ * @param  rlen Number of bytes to read, 0 for write only
+ * @return TWI_ASYNC_BUSY if started, TWI_ASYNC_ERROR if another
+ *         transaction is in progress
+ * @note   Buffers must stay valid until twi_async_status() returns other
+ *         value than TWI_ASYNC_BUSY. Blocking functions wait for the end
+ *         of background transaction. Global interrupts must be enabled.
+ */
+uint8_t twi_async_start(uint8_t adr, const uint8_t *wbuf, uint8_t wlen,
+                        uint8_t *rbuf, uint8_t rlen);
+
+
+/**
+ * @brief  Read result of background transaction.
+ * @return TWI_ASYNC_BUSY, TWI_ASYNC_OK, TWI_ASYNC_NACK or TWI_ASYNC_ERROR
+ */
+uint8_t twi_async_status(void);
+
+
+/**
+ * @brief  Read longest duration of TWI interrupt.
+ * @return Number of CPU cycles, 0 if not measured
+ * @note   Measured with TCNT1 when TWI_ISR_TIMING is defined, valid only
+ *         while Timer/Counter1 runs with prescaler 1 (such as the ADC
+ *         timed mode with period up to 4 ms).
+ */
+uint16_t twi_async_isr_max(void);
+
+
 /**
  * @brief  Test presence of one I2C device on the bus.
  * @param  adr Slave address
@@ -39,6 +39,7 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
+#include <util/atomic.h>
 #include "uart.h"
 
 
@@ -56,6 +57,18 @@
 #if ( UART_TX_BUFFER_SIZE & UART_TX_BUFFER_MASK )
 # error TX buffer size is not a power of 2
 #endif
+#if ( UART_RX_BUFFER_SIZE > 1024 ) || ( UART_TX_BUFFER_SIZE > 1024 )
+# error RX or TX buffer larger than 1024 bytes
+#endif
+
+/* ringbuffer index, 16 bits when a buffer is larger than 256 bytes */
+#if ( UART_RX_BUFFER_SIZE > 256 ) || ( UART_TX_BUFFER_SIZE > 256 )
+typedef unsigned int uart_index_t;
+# define UART_INDEX_WIDE 1
+#else
+typedef unsigned char uart_index_t;
+# define UART_INDEX_WIDE 0
+#endif
 
 
 #if defined(__AVR_AT90S2313__) || defined(__AVR_AT90S4414__) || defined(__AVR_AT90S8515__) || \
@@ -335,27 +348,109 @@
 #endif /* if defined(__AVR_AT90S2313__) || defined(__AVR_AT90S4414__) || defined(__AVR_AT90S8515__) || defined(__AVR_AT90S4434__) || defined(__AVR_AT90S8535__) || defined(__AVR_ATmega103__) */
 
 
+/* TX Complete flag, cleared by writing one */
+#if defined(TXC0)
+# define UART0_BIT_TXC TXC0
+#elif defined(TXC)
+# define UART0_BIT_TXC TXC
+#endif
+
+/* Bits of status register which keep their value when writing TXC */
+#if defined(U2X0) && defined(MPCM0)
+# define UART0_STATUS_KEEP (_BV(U2X0) | _BV(MPCM0))
+#elif defined(U2X) && defined(MPCM)
+# define UART0_STATUS_KEEP (_BV(U2X) | _BV(MPCM))
+#else
+# define UART0_STATUS_KEEP 0
+#endif
+
+
 /*
  *  module global variables
  */
 static volatile unsigned char UART_TxBuf[UART_TX_BUFFER_SIZE];
 static volatile unsigned char UART_RxBuf[UART_RX_BUFFER_SIZE];
-static volatile unsigned char UART_TxHead;
-static volatile unsigned char UART_TxTail;
-static volatile unsigned char UART_RxHead;
-static volatile unsigned char UART_RxTail;
+static volatile uart_index_t UART_TxHead;
+static volatile uart_index_t UART_TxTail;
+static volatile uart_index_t UART_RxHead;
+static volatile uart_index_t UART_RxTail;
 static volatile unsigned char UART_LastRxError;
+static uart_index_t UART_TxPend;
+static volatile unsigned int UART_RxDropped;
+static volatile unsigned int UART_RxPeak;
+static unsigned int UART_TxPeak;
+static unsigned int UART_TxStalls;
+static unsigned int UART_Baud;
 
 #if defined( ATMEGA_USART1 )
 static volatile unsigned char UART1_TxBuf[UART_TX_BUFFER_SIZE];
 static volatile unsigned char UART1_RxBuf[UART_RX_BUFFER_SIZE];
-static volatile unsigned char UART1_TxHead;
-static volatile unsigned char UART1_TxTail;
-static volatile unsigned char UART1_RxHead;
-static volatile unsigned char UART1_RxTail;
+static volatile uart_index_t UART1_TxHead;
+static volatile uart_index_t UART1_TxTail;
+static volatile uart_index_t UART1_RxHead;
+static volatile uart_index_t UART1_RxTail;
 static volatile unsigned char UART1_LastRxError;
 #endif
 
+#ifdef UART_RX_HOOK
+extern unsigned char UART_RX_HOOK(unsigned char data);
+#endif
+
+
+/*************************************************************************
+ * Function: uart_index_get()
+ * Purpose:  read index which is changed by an interrupt, in one piece
+ * Input:    index variable
+ * Returns:  its value
+ **************************************************************************/
+static inline uart_index_t uart_index_get(volatile uart_index_t *index)
+{
+    #if UART_INDEX_WIDE
+    uart_index_t value;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        value = *index;
+    }
+    return value;
+    #else
+    return *index;
+    #endif
+}/* uart_index_get */
+
+/*************************************************************************
+ * Function: uart_index_set()
+ * Purpose:  write index which is read by an interrupt, in one piece
+ * Input:    index variable and new value
+ * Returns:  none
+ **************************************************************************/
+static inline void uart_index_set(volatile uart_index_t *index, uart_index_t value)
+{
+    #if UART_INDEX_WIDE
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        *index = value;
+    }
+    #else
+    *index = value;
+    #endif
+}/* uart_index_set */
+
+/*************************************************************************
+ * Function: uart_tx_peak()
+ * Purpose:  update peak occupancy of the transmit ringbuffer
+ * Input:    new head index
+ * Returns:  none
+ **************************************************************************/
+static void uart_tx_peak(uart_index_t head)
+{
+    unsigned int used;
+
+    used = (head - uart_index_get(&UART_TxTail)) & UART_TX_BUFFER_MASK;
+    if (used > UART_TxPeak)
+        UART_TxPeak = used;
+}/* uart_tx_peak */
+
 
 ISR(UART0_RECEIVE_INTERRUPT)
 
@@ -364,7 +459,8 @@ ISR(UART0_RECEIVE_INTERRUPT)
  * Purpose:  called when the UART has received a character
  **************************************************************************/
 {
-    unsigned char tmphead;
+    uart_index_t tmphead;
+    unsigned int used;
     unsigned char data;
     unsigned char usr;
     unsigned char lastRxError = 0;
@@ -385,6 +481,27 @@ ISR(UART0_RECEIVE_INTERRUPT)
     lastRxError = usr & (_BV(FE) | _BV(DOR) );
     #endif
 
+    /* a data overrun has lost at least one byte before this one */
+    if ((lastRxError & (UART_OVERRUN_ERROR >> 8)) && UART_RxDropped != 0xFFFF)
+        UART_RxDropped++;
+
+    #ifdef UART_RX_HOOK
+    /* a byte with frame or parity error never reaches the parser */
+    if (lastRxError & ((UART_FRAME_ERROR | UART_PARITY_ERROR) >> 8))
+    {
+        if (UART_RxDropped != 0xFFFF)
+            UART_RxDropped++;
+        UART_LastRxError |= lastRxError;
+        return;
+    }
+    /* byte taken over by a parser, e.g. -DUART_RX_HOOK=console_rx */
+    if (UART_RX_HOOK(data))
+    {
+        UART_LastRxError |= lastRxError;
+        return;
+    }
+    #endif
+
     /* calculate buffer index */
     tmphead = ( UART_RxHead + 1) & UART_RX_BUFFER_MASK;
 
@@ -392,6 +509,8 @@ ISR(UART0_RECEIVE_INTERRUPT)
     {
         /* error: receive buffer overflow */
         lastRxError = UART_BUFFER_OVERFLOW >> 8;
+        if (UART_RxDropped != 0xFFFF)
+            UART_RxDropped++;
     }
     else
     {
@@ -399,6 +518,10 @@ ISR(UART0_RECEIVE_INTERRUPT)
         UART_RxHead = tmphead;
         /* store received data in buffer */
         UART_RxBuf[tmphead] = data;
+
+        used = (tmphead - UART_RxTail) & UART_RX_BUFFER_MASK;
+        if (used > UART_RxPeak)
+            UART_RxPeak = used;
     }
     UART_LastRxError |= lastRxError;
 }
@@ -411,7 +534,7 @@ ISR(UART0_TRANSMIT_INTERRUPT)
  * Purpose:  called when the UART is ready to transmit the next byte
  **************************************************************************/
 {
-    unsigned char tmptail;
+    uart_index_t tmptail;
 
 
     if (UART_TxHead != UART_TxTail)
@@ -421,6 +544,10 @@ ISR(UART0_TRANSMIT_INTERRUPT)
         UART_TxTail = tmptail;
         /* get one byte from buffer and write it to UART */
         UART0_DATA = UART_TxBuf[tmptail]; /* start transmission */
+        #ifdef UART0_BIT_TXC
+        /* clear TX Complete, set again after this byte has been sent */
+        UART0_STATUS = (UART0_STATUS & UART0_STATUS_KEEP) | _BV(UART0_BIT_TXC);
+        #endif
     }
     else
     {
@@ -461,14 +588,22 @@ void uart_init(unsigned int baudrate)
     #endif /* ifdef UART_TEST */
 
     /* Set baud rate */
+    UART_Baud = baudrate;
     if (baudrate & 0x8000)
     {
         #if UART0_BIT_U2X
         UART0_STATUS = (1 << UART0_BIT_U2X); // Enable 2x speed
         #endif
     }
+    else
+    {
+        #if UART0_BIT_U2X
+        UART0_STATUS = 0; // Normal speed, also after double speed
+        #endif
+    }
     #if defined(UART0_UBRRH)
-    UART0_UBRRH = (unsigned char) ((baudrate >> 8) & 0x80);
+    /* bits 11:8 of the divisor, without the double speed flag */
+    UART0_UBRRH = (unsigned char) ((baudrate >> 8) & 0x0F);
     #endif
     UART0_UBRRL = (unsigned char) (baudrate & 0x00FF);
 
@@ -493,12 +628,12 @@ void uart_init(unsigned int baudrate)
  **************************************************************************/
 unsigned int uart_getc(void)
 {
-    unsigned char tmptail;
+    uart_index_t tmptail;
     unsigned char data;
     unsigned char lastRxError;
 
 
-    if (UART_RxHead == UART_RxTail)
+    if (uart_index_get(&UART_RxHead) == UART_RxTail)
     {
         return UART_NO_DATA; /* no data available */
     }
@@ -511,7 +646,7 @@ unsigned int uart_getc(void)
     lastRxError = UART_LastRxError;
 
     /* store buffer index */
-    UART_RxTail = tmptail;
+    uart_index_set(&UART_RxTail, tmptail);
 
     UART_LastRxError = 0;
     return (lastRxError << 8) + data;
@@ -525,18 +660,21 @@ unsigned int uart_getc(void)
  **************************************************************************/
 void uart_putc(unsigned char data)
 {
-    unsigned char tmphead;
+    uart_index_t tmphead;
 
 
     tmphead = (UART_TxHead + 1) & UART_TX_BUFFER_MASK;
 
-    while (tmphead == UART_TxTail)
+    if (tmphead == uart_index_get(&UART_TxTail) && UART_TxStalls != 0xFFFF)
+        UART_TxStalls++;
+    while (tmphead == uart_index_get(&UART_TxTail))
     {
         ;/* wait for free space in buffer */
     }
 
     UART_TxBuf[tmphead] = data;
-    UART_TxHead         = tmphead;
+    uart_index_set(&UART_TxHead, tmphead);
+    uart_tx_peak(tmphead);
 
     /* enable UDRE interrupt */
     UART0_CONTROL |= _BV(UART0_UDRIE);
@@ -568,6 +706,199 @@ void uart_puts_p(const char *progmem_s)
         uart_putc(c);
 }/* uart_puts_p */
 
+/*************************************************************************
+ * Function: uart_tx_free()
+ * Purpose:  get number of free bytes in the transmit ringbuffer
+ * Returns:  number of bytes which can be written without blocking
+ **************************************************************************/
+unsigned int uart_tx_free(void)
+{
+    return (uart_index_get(&UART_TxTail) - UART_TxHead - 1) & UART_TX_BUFFER_MASK;
+}/* uart_tx_free */
+
+/*************************************************************************
+ * Function: uart_try_write()
+ * Purpose:  copy as much of the block as fits into the transmit
+ *           ringbuffer, never blocks
+ * Input:    bytes to be transmitted and their number
+ * Returns:  number of bytes copied
+ **************************************************************************/
+unsigned int uart_try_write(const void *buf, unsigned int len)
+{
+    const unsigned char *data = buf;
+    uart_index_t tmphead;
+    unsigned int n;
+    unsigned int i;
+
+
+    n = uart_tx_free();
+    if (n > len)
+        n = len;
+    if (n == 0)
+        return 0;
+
+    /* the ISR only moves the tail, so the bytes are copied with
+       interrupts enabled and published by storing the head once */
+    tmphead = UART_TxHead;
+    for (i = 0; i < n; i++)
+    {
+        tmphead = (tmphead + 1) & UART_TX_BUFFER_MASK;
+        UART_TxBuf[tmphead] = data[i];
+    }
+    uart_index_set(&UART_TxHead, tmphead);
+    uart_tx_peak(tmphead);
+
+    /* enable UDRE interrupt */
+    UART0_CONTROL |= _BV(UART0_UDRIE);
+
+    return n;
+}/* uart_try_write */
+
+/*************************************************************************
+ * Function: uart_write()
+ * Purpose:  copy block to the transmit ringbuffer, wait only while the
+ *           ringbuffer is full
+ * Input:    bytes to be transmitted and their number
+ * Returns:  none
+ **************************************************************************/
+void uart_write(const void *buf, unsigned int len)
+{
+    const unsigned char *data = buf;
+    unsigned int n;
+
+
+    n     = uart_try_write(data, len);
+    data += n;
+    len  -= n;
+
+    if (len && UART_TxStalls != 0xFFFF)
+        UART_TxStalls++;
+    while (len)
+    {
+        n = uart_try_write(data, len);
+        data += n;
+        len  -= n;
+    }
+}/* uart_write */
+
+/*************************************************************************
+ * Function: uart_tx_done()
+ * Purpose:  test if all bytes have been sent
+ * Returns:  1 if the ringbuffer is empty and the UART is idle
+ **************************************************************************/
+unsigned char uart_tx_done(void)
+{
+    if (UART_TxHead != uart_index_get(&UART_TxTail))
+        return 0;
+    #ifdef UART0_BIT_TXC
+    return (UART0_STATUS & _BV(UART0_BIT_TXC)) ? 1 : 0;
+    #else
+    return 1;
+    #endif
+}/* uart_tx_done */
+
+/*************************************************************************
+ * Function: uart_tx_begin()
+ * Purpose:  start a block written in place into the transmit ringbuffer
+ * Input:    maximum number of bytes of the block
+ * Returns:  1 if there is room for them, 0 otherwise
+ **************************************************************************/
+unsigned char uart_tx_begin(unsigned int len)
+{
+    if (uart_tx_free() < len)
+        return 0;
+    UART_TxPend = UART_TxHead;
+    return 1;
+}/* uart_tx_begin */
+
+/*************************************************************************
+ * Function: uart_tx_put()
+ * Purpose:  append byte to the block, not sent before uart_tx_commit()
+ * Input:    byte to be transmitted
+ * Returns:  position of the byte, see uart_tx_patch()
+ **************************************************************************/
+unsigned int uart_tx_put(unsigned char data)
+{
+    UART_TxPend = (UART_TxPend + 1) & UART_TX_BUFFER_MASK;
+    UART_TxBuf[UART_TxPend] = data;
+    return UART_TxPend;
+}/* uart_tx_put */
+
+/*************************************************************************
+ * Function: uart_tx_patch()
+ * Purpose:  overwrite byte of the block which is not committed yet
+ * Input:    position returned by uart_tx_put() and new value
+ * Returns:  none
+ **************************************************************************/
+void uart_tx_patch(unsigned int pos, unsigned char data)
+{
+    UART_TxBuf[pos & UART_TX_BUFFER_MASK] = data;
+}/* uart_tx_patch */
+
+/*************************************************************************
+ * Function: uart_tx_commit()
+ * Purpose:  pass all bytes of the block to the transmitter at once
+ * Returns:  none
+ **************************************************************************/
+void uart_tx_commit(void)
+{
+    uart_index_set(&UART_TxHead, UART_TxPend);
+    uart_tx_peak(UART_TxPend);
+
+    /* enable UDRE interrupt */
+    UART0_CONTROL |= _BV(UART0_UDRIE);
+}/* uart_tx_commit */
+
+/*************************************************************************
+ * Function: uart_get_stats()
+ * Purpose:  copy counters of ringbuffer use
+ * Input:    pointer to counters
+ * Returns:  none
+ **************************************************************************/
+void uart_get_stats(uart_stats_t *stats)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        stats->rx_dropped = UART_RxDropped;
+        stats->rx_peak    = UART_RxPeak;
+    }
+    stats->tx_peak   = UART_TxPeak;
+    stats->tx_stalls = UART_TxStalls;
+}/* uart_get_stats */
+
+/*************************************************************************
+ * Function: uart_clear_stats()
+ * Purpose:  reset counters of ringbuffer use
+ * Returns:  none
+ **************************************************************************/
+void uart_clear_stats(void)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        UART_RxDropped = 0;
+        UART_RxPeak    = 0;
+    }
+    UART_TxPeak   = 0;
+    UART_TxStalls = 0;
+}/* uart_clear_stats */
+
+#ifdef F_CPU
+/*************************************************************************
+ * Function: uart_get_baud()
+ * Purpose:  calculate baud rate set by uart_init() from divisor and mode
+ * Returns:  achieved baud rate in bps
+ **************************************************************************/
+unsigned long uart_get_baud(void)
+{
+    unsigned long divisor = (UART_Baud & 0x0FFF) + 1UL;
+
+
+    if (UART_Baud & 0x8000)
+        return F_CPU / (8UL * divisor);
+    return F_CPU / (16UL * divisor);
+}/* uart_get_baud */
+#endif
+
 /*
  * these functions are only for ATmegas with two USART
  */
@@ -580,7 +911,7 @@ ISR(UART1_RECEIVE_INTERRUPT)
  * Purpose:  called when the UART1 has received a character
  **************************************************************************/
 {
-    unsigned char tmphead;
+    uart_index_t tmphead;
     unsigned char data;
     unsigned char usr;
     unsigned char lastRxError;
@@ -619,7 +950,7 @@ ISR(UART1_TRANSMIT_INTERRUPT)
  * Purpose:  called when the UART1 is ready to transmit the next byte
  **************************************************************************/
 {
-    unsigned char tmptail;
+    uart_index_t tmptail;
 
 
     if (UART1_TxHead != UART1_TxTail)
@@ -675,7 +1006,14 @@ void uart1_init(unsigned int baudrate)
         UART1_STATUS = (1 << UART1_BIT_U2X); // Enable 2x speed
         # endif
     }
-    UART1_UBRRH = (unsigned char) ((baudrate >> 8) & 0x80);
+    else
+    {
+        # if UART1_BIT_U2X
+        UART1_STATUS = 0; // Normal speed, also after double speed
+        # endif
+    }
+    /* bits 11:8 of the divisor, without the double speed flag */
+    UART1_UBRRH = (unsigned char) ((baudrate >> 8) & 0x0F);
     UART1_UBRRL = (unsigned char) baudrate;
 
     /* Enable USART receiver and transmitter and receive complete interrupt */
@@ -697,12 +1035,12 @@ void uart1_init(unsigned int baudrate)
  **************************************************************************/
 unsigned int uart1_getc(void)
 {
-    unsigned char tmptail;
+    uart_index_t tmptail;
     unsigned int data;
     unsigned char lastRxError;
 
 
-    if (UART1_RxHead == UART1_RxTail)
+    if (uart_index_get(&UART1_RxHead) == UART1_RxTail)
     {
         return UART_NO_DATA; /* no data available */
     }
@@ -715,7 +1053,7 @@ unsigned int uart1_getc(void)
     lastRxError = UART1_LastRxError;
 
     /* store buffer index */
-    UART1_RxTail = tmptail;
+    uart_index_set(&UART1_RxTail, tmptail);
 
     UART1_LastRxError = 0;
     return (lastRxError << 8) + data;
@@ -729,18 +1067,18 @@ unsigned int uart1_getc(void)
  **************************************************************************/
 void uart1_putc(unsigned char data)
 {
-    unsigned char tmphead;
+    uart_index_t tmphead;
 
 
     tmphead = (UART1_TxHead + 1) & UART_TX_BUFFER_MASK;
 
-    while (tmphead == UART1_TxTail)
+    while (tmphead == uart_index_get(&UART1_TxTail))
     {
         ;/* wait for free space in buffer */
     }
 
     UART1_TxBuf[tmphead] = data;
-    UART1_TxHead         = tmphead;
+    uart_index_set(&UART1_TxHead, tmphead);
 
     /* enable UDRE interrupt */
     UART1_CONTROL |= _BV(UART1_UDRIE);
@@ -75,7 +75,56 @@
  */
 #define UART_BAUD_SELECT_DOUBLE_SPEED(baudRate, xtalCpu) ( ((((xtalCpu) + 4UL * (baudRate)) / (8UL * (baudRate)) - 1UL)) | 0x8000)
 
-/** @brief  Size of the circular receive buffer, must be power of 2
+/** @brief  Achieved baud rate of UART_BAUD_SELECT() */
+#define UART_BAUD_RATE_NORMAL(baudRate, xtalCpu) ((xtalCpu) / (16UL * (UART_BAUD_SELECT(baudRate, xtalCpu) + 1UL)))
+
+/** @brief  Achieved baud rate of UART_BAUD_SELECT_DOUBLE_SPEED() */
+#define UART_BAUD_RATE_DOUBLE(baudRate, xtalCpu) ((xtalCpu) / (8UL * ((UART_BAUD_SELECT_DOUBLE_SPEED(baudRate, xtalCpu) & 0x0FFF) + 1UL)))
+
+/** @brief  Difference of achieved and requested baud rate in per mille (0.1 %) */
+#define UART_BAUD_ERROR_PM(rate, baudRate) \
+    ((rate) > (baudRate) ? ((rate) - (baudRate)) * 1000UL / (baudRate) : ((baudRate) - (rate)) * 1000UL / (baudRate))
+
+/** @brief  1 if double speed mode gives a smaller baud rate error, on a tie
+ *          normal speed is kept (receiver samples more times per bit) */
+#define UART_BAUD_USE_DOUBLE(baudRate, xtalCpu) \
+    (UART_BAUD_ERROR_PM(UART_BAUD_RATE_DOUBLE(baudRate, xtalCpu), baudRate) < \
+     UART_BAUD_ERROR_PM(UART_BAUD_RATE_NORMAL(baudRate, xtalCpu), baudRate))
+
+/** @brief  UART Baudrate Expression choosing normal or double speed mode
+ *
+ *  At 16 MHz, 500000, 1000000 and 2000000 bps are exact in double speed
+ *  mode; 115200 bps has 2.1 % error in double and 3.5 % in normal mode.
+ *  Check the choice at compile time with UART_BAUD_ASSERT().
+ *
+ *  @param  xtalCpu  system clock in Mhz, e.g. 16000000UL for 16Mhz
+ *  @param  baudRate baudrate in bps, e.g. 115200, 500000, 1000000
+ */
+#define UART_BAUD_SELECT_AUTO(baudRate, xtalCpu) \
+    (UART_BAUD_USE_DOUBLE(baudRate, xtalCpu) ? UART_BAUD_SELECT_DOUBLE_SPEED(baudRate, xtalCpu) : UART_BAUD_SELECT(baudRate, xtalCpu))
+
+/** @brief  Achieved baud rate of UART_BAUD_SELECT_AUTO() */
+#define UART_BAUD_RATE_AUTO(baudRate, xtalCpu) \
+    (UART_BAUD_USE_DOUBLE(baudRate, xtalCpu) ? UART_BAUD_RATE_DOUBLE(baudRate, xtalCpu) : UART_BAUD_RATE_NORMAL(baudRate, xtalCpu))
+
+/** @brief  Largest accepted baud rate error of UART_BAUD_ASSERT() in per mille;
+ *          the manual recommends at most 1.5 % receiver error with 8 data
+ *          bits in double speed mode (2.0 % in normal mode) */
+#ifndef UART_BAUD_MAX_ERROR_PM
+# define UART_BAUD_MAX_ERROR_PM 15
+#endif
+
+/** @brief  Stop compilation when UART_BAUD_SELECT_AUTO() cannot reach the
+ *          baud rate within UART_BAUD_MAX_ERROR_PM, or its divisor does
+ *          not fit in 12 bits. Use at file scope.
+ */
+#define UART_BAUD_ASSERT(baudRate, xtalCpu) \
+    _Static_assert(UART_BAUD_ERROR_PM(UART_BAUD_RATE_AUTO(baudRate, xtalCpu), baudRate) <= UART_BAUD_MAX_ERROR_PM && \
+                   (UART_BAUD_SELECT_AUTO(baudRate, xtalCpu) & 0x7FFF) <= 0x0FFF, \
+                   "UART baud rate error too large for this F_CPU")
+
+/** @brief  Size of the circular receive buffer, must be power of 2,
+ *          at most 1024; above 256 bytes, 16-bit indices are used
  *
  *  You may need to adapt this constant to your target and your application by adding
  *  CDEFS += -DUART_RX_BUFFER_SIZE=nn to your Makefile.
@@ -84,7 +133,8 @@
 # define UART_RX_BUFFER_SIZE 64
 #endif
 
-/** @brief  Size of the circular transmit buffer, must be power of 2
+/** @brief  Size of the circular transmit buffer, must be power of 2,
+ *          at most 1024; above 256 bytes, 16-bit indices are used
  *
  *  You may need to adapt this constant to your target and your application by adding
  *  CDEFS += -DUART_TX_BUFFER_SIZE=nn to your Makefile.
@@ -93,6 +143,20 @@
 # define UART_TX_BUFFER_SIZE 64
 #endif
 
+/** @brief  Optional function called by the receive interrupt with each byte
+ *
+ *  Not defined by default. Define it to the name of a function
+ *  unsigned char fn(unsigned char data), e.g. by adding
+ *  CDEFS += -DUART_RX_HOOK=console_rx to your Makefile. When the function
+ *  returns 1, it took the byte and the byte is not stored in the receive
+ *  ringbuffer. It runs inside the interrupt and must be short. Bytes
+ *  received with frame or parity error are dropped before the function
+ *  and counted in uart_stats_t.rx_dropped, as are data overruns.
+ */
+#ifdef __DOXYGEN__
+# define UART_RX_HOOK
+#endif
+
 /* test if the size of the circular buffers fits into SRAM */
 #if ( (UART_RX_BUFFER_SIZE + UART_TX_BUFFER_SIZE) >= (RAMEND - 0x60 ) )
 # error "size of UART_RX_BUFFER_SIZE + UART_TX_BUFFER_SIZE larger than size of SRAM"
@@ -108,6 +172,18 @@
 #define UART_NO_DATA         0x0100 /**< @brief no receive data available   */
 
 
+/** @brief  Counters of ringbuffer use, see uart_get_stats()
+ *
+ *  Counters stop at 0xFFFF. Peaks show how large the buffers need to be.
+ */
+typedef struct {
+    unsigned int rx_dropped; /**< @brief received bytes lost: ringbuffer full, data overrun or, with UART_RX_HOOK, frame or parity error */
+    unsigned int rx_peak;    /**< @brief most bytes waiting in receive ringbuffer */
+    unsigned int tx_peak;    /**< @brief most bytes waiting in transmit ringbuffer */
+    unsigned int tx_stalls;  /**< @brief writes which had to wait for free space */
+} uart_stats_t;
+
+
 /*
 ** function prototypes
 */
@@ -187,6 +263,116 @@ extern void uart_puts_p(const char *s);
 #define uart_puts_P(__s) uart_puts_p(PSTR(__s))
 
 
+/**
+ * @brief   Get number of free bytes in the transmit ringbuffer
+ * @return  Number of bytes which can be written without blocking
+ */
+extern unsigned int uart_tx_free(void);
+
+
+/**
+ * @brief   Put block of bytes to ringbuffer for transmitting via UART
+ *
+ * Copies as much as fits into the ringbuffer at once and enables the
+ * UDRE interrupt once per copy, not per byte. Blocks only while the
+ * ringbuffer is full, until all bytes are copied.
+ *
+ * @param   buf bytes to be transmitted
+ * @param   len number of bytes
+ * @return  none
+ */
+extern void uart_write(const void *buf, unsigned int len);
+
+
+/**
+ * @brief   Put block of bytes to ringbuffer, never blocks
+ *
+ * Copies as much as fits into the ringbuffer. Check uart_tx_free()
+ * first to send a block either whole or not at all.
+ *
+ * @param   buf bytes to be transmitted
+ * @param   len number of bytes
+ * @return  Number of bytes copied, 0 if the ringbuffer is full
+ */
+extern unsigned int uart_try_write(const void *buf, unsigned int len);
+
+
+/**
+ * @brief   Test if transmission is complete
+ *
+ * Uses TX Complete flag of the UART, so the last stop bit has also left
+ * the TXD pin, e.g. to switch direction of an RS-485 driver.
+ *
+ * @return  1 if the ringbuffer is empty and the UART is idle, 0 otherwise
+ */
+extern unsigned char uart_tx_done(void);
+
+
+/**
+ * @brief   Start a block written in place into the transmit ringbuffer
+ *
+ * Bytes appended with uart_tx_put() stay invisible to the transmitter
+ * and may still be changed with uart_tx_patch(), e.g. a length or code
+ * byte known only at the end, until uart_tx_commit() passes them all
+ * at once. No staging buffer is needed. Other functions writing to the
+ * ringbuffer must not be called in between.
+ *
+ * @param   len maximum number of bytes of the block
+ * @return  1 if there is room for them, 0 otherwise (nothing is started)
+ */
+extern unsigned char uart_tx_begin(unsigned int len);
+
+
+/**
+ * @brief   Append byte to the block started by uart_tx_begin()
+ * @param   data byte to be transmitted
+ * @return  Position of the byte for uart_tx_patch()
+ */
+extern unsigned int uart_tx_put(unsigned char data);
+
+
+/**
+ * @brief   Overwrite byte of the block which is not committed yet
+ * @param   pos position returned by uart_tx_put()
+ * @param   data new value
+ * @return  none
+ */
+extern void uart_tx_patch(unsigned int pos, unsigned char data);
+
+
+/**
+ * @brief   Pass all bytes of the block to the transmitter
+ * @return  none
+ */
+extern void uart_tx_commit(void);
+
+
+/**
+ * @brief   Copy counters of ringbuffer use of USART0
+ * @param   stats pointer to counters
+ * @return  none
+ */
+extern void uart_get_stats(uart_stats_t *stats);
+
+
+/**
+ * @brief   Reset counters of ringbuffer use of USART0
+ * @return  none
+ */
+extern void uart_clear_stats(void);
+
+
+/**
+ * @brief   Get baud rate achieved by the divisor and mode of uart_init()
+ *
+ * Compare with the requested rate, e.g. with UART_BAUD_ERROR_PM().
+ * Needs F_CPU defined when compiling the library.
+ *
+ * @return  Baud rate in bps
+ */
+extern unsigned long uart_get_baud(void);
+
+
 /** @brief  Initialize USART1 (only available on selected ATmegas) @see uart_init */
 extern void uart1_init(unsigned int baudrate);
 /** @brief  Get received byte of USART1 from ringbuffer. (only available on selected ATmega) @see uart_getc */
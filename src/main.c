@@ -17,242 +17,937 @@
 #include <uart.h>           // Peter Fleury's UART library
 #include <stdlib.h>         // C library. Needed for number conversions
 #include <gpio.h>
+#include <adc.h>            // Interrupt-driven ADC scanner
+#include <filter.h>         // Streaming fixed-point filters
+#include <classify.h>       // Hysteresis threshold classifier
+#include <timebase.h>       // Millisecond time base of Timer0
+#include <scheduler.h>      // Cooperative task scheduler
+#include <climate.h>        // Temperature/humidity sensor layer
+#include <sht3x.h>
+#include <bme280.h>
+#include <aht20.h>
+#include <dht12.h>
+#include <stats.h>          // Sliding-window statistics
+#include <eelog.h>          // EEPROM data logger
+#include <telem.h>          // Binary telemetry frames
+#include <console.h>        // Commands over UART
+#include <config.h>         // Settings in EEPROM
+#include <modbus.h>         // Modbus RTU slave
+#include <dlog.h>           // Deferred binary log
+#include <prof.h>           // Cycle counts of code regions
+#include <dashboard.h>      // Main screen on the OLED
+#include <string.h>
+#include <stddef.h>
 // -- Defines --------------------------------------------------------
-#define DHT_ADR 0x5c
-#define DHT_HUM_MEM 0
-#define DHT_TEMP_MEM 2
-
 #ifndef F_CPU
 # define F_CPU 16000000  // CPU frequency in Hz required for UART_BAUD_SELECT
 #endif
+// UART speed; normal or double speed mode is chosen for the smallest
+// error, 500000 and 1000000 are exact at 16 MHz, 115200 (2.1 %) is
+// beyond UART_BAUD_MAX_ERROR_PM
+#ifndef UART_BAUD
+# define UART_BAUD 38400
+#endif
+UART_BAUD_ASSERT(UART_BAUD, F_CPU);
 
 // -- Global variables -----------------------------------------------
-volatile uint8_t flag_update_oled = 0;
-volatile uint8_t dht12_values[5];
-
-// Declaration of "dht12" variable with structure "DHT_values_structure"
-struct DHT_values_structure {
-   uint8_t hum_int;
-   uint8_t hum_dec;
-   uint8_t temp_int;
-   uint8_t temp_dec;
-   uint8_t checksum;
-} dht12;
-
-// Flag for printing new data from sensor
-volatile uint8_t new_sensor_data = 0;
-
-// Slave and internal addresses of temperature/humidity sensor DHT12
-#define SENSOR_ADR 0x5c
-#define SENSOR_HUM_MEM 0
-#define SENSOR_TEMP_MEM 2
-#define SENSOR_CHECKSUM 4
+// Supported temperature/humidity sensors in order of preference, the
+// first one found at start-up is used
+static const climate_driver_t * const climate_sensors[] PROGMEM = {
+    &sht3x_driver, &bme280_driver, &aht20_driver, &dht12_driver,
+};
+const climate_driver_t *climate_sensor;  // In program memory
+
+// Filtered temperature and humidity in tenths of unit
+filter_t temp_filter;
+filter_t hum_filter;
+
 #define HUM PB0
+
+// Indexes of scanned ADC channels, see `adc_channels`
+#define ADC_CH_LIGHT 0      // Photoresistor on ADC0
+#define ADC_CH_SOIL  1      // Soil moisture sensor on ADC1
+#define ADC_CH_AUX   2      // Spare input ADC2
+#define ADC_CH_VBG   3      // Internal 1.1 V bandgap (supply monitor)
+
+static const uint8_t adc_channels[] = {0, 1, 2, ADC_MUX_BANDGAP};
+
+// Time between two ADC conversions; every channel is sampled once per
+// ADC_SAMPLE_PERIOD_US * sizeof(adc_channels)
+#define ADC_SAMPLE_PERIOD_US 1000
+
+// Soil moisture is oversampled 4^2 times to 12-bit resolution; the
+// thresholds below are given in 10-bit units and scaled to match
+#define SOIL_OVERSAMPLING 2
+#define SOIL_LEVEL(x) ((uint16_t)(x) << SOIL_OVERSAMPLING)
+
+// Classified states with hysteresis; a value must rise above `enter`
+// to reach a state and fall below `exit` to leave it downwards. The
+// thresholds are set from `settings` by settings_apply()
+#define LIGHT_NIGHT 0
+#define LIGHT_DAY   1
+static class_level_t light_levels[] = {
+    {0, 0},
+    {0, 0},      // E.g. day above 720, night again below 680
+};
+
+#define SOIL_WET 0
+#define SOIL_DRY 1
+#define SOIL_OUT 2  // Sensor out of soil
+static class_level_t soil_levels[] = {
+    {0, 0},
+    {0, 0},      // Dry
+    {0, 0},      // Out
+};
+
+#define WATER_OK   0
+#define WATER_NEED 1
+static class_level_t water_levels[] = {
+    {0, 0},
+    {0, 0},      // Watering needed
+};
+
+#define WINDOW_CLOSED 0
+#define WINDOW_OPEN   1
+static class_level_t window_levels[] = {
+    {0, 0},
+    {0, 0},      // Air humidity in tenths
+};
+
+// Shortest time in milliseconds between two changes of each state
+#define CLASS_DWELL_MS  10000
+#define WINDOW_DWELL_MS 60000
+
+classifier_t light_class;
+classifier_t soil_class;
+classifier_t water_class;
+classifier_t window_class;
+
+// Latest values shared by the tasks
+uint16_t light_level;     // Filtered light level
+uint16_t moisture_level;  // Filtered soil moisture level
+int16_t temperature;      // Filtered air temperature in tenths of deg C
+int16_t humidity;         // Filtered air humidity in tenths of percent
+
+// 1-min, 10-min and 1-h statistics of one channel of each sample path;
+// each channel takes 150 bytes of RAM
+#define STATS_TICK_MS 30000
+stats_t temp_stats;
+stats_t soil_stats;
+
+// Values logged to EEPROM every 10 minutes (20 statistics ticks): air
+// temperature and humidity in tenths, light and soil moisture levels
+#define LOG_EVERY_TICKS 20
+// Time between two lines of log dump, command "dump" starts it
+#define DUMP_LINE_MS 10
+#define DUMP_IDLE_MS 100
+#define DUMP_LINE_MAX 42
+
+// Display fields to be redrawn by the display task, DASH_* flags
+uint8_t display_dirty = 0;
+uint8_t display_on = 1;
+
+// Tasks, in order of registration; lower priority value runs first
+#define TASK_ADC       0
+#define TASK_CLIMATE   1
+#define TASK_CONTROL   2
+#define TASK_DISPLAY   3
+#define TASK_TELEMETRY 4
+#define TASK_STATS     5
+#define TASK_DUMP      6
+#define TASK_SERIAL    7
+#define TASK_LOG       8
+#define TASK_COUNT     9
+static const char task_names[TASK_COUNT][8] PROGMEM = {
+    "adc", "climate", "control", "display", "telem", "stats", "dump",
+    "serial", "log"
+};
+#if SCHED_MAX_TASKS < TASK_COUNT
+# error "SCHED_MAX_TASKS too small, see build_flags of platformio.ini"
+#endif
+
+// UART carries either commands and telemetry, or Modbus RTU requests
+// if settings give a slave address (after reset); a Modbus response
+// is due within a few milliseconds
+#define CONSOLE_POLL_MS 50
+#define MODBUS_POLL_MS  5
+uint8_t modbus_address = 0;
+uint32_t uart_baud;  // Speed set at start-up, settings.baud after reset
+
+// Settings changed over UART and kept in EEPROM (config.h); thresholds
+// are centers of hysteresis bands, soil in 10-bit units
+#define CONFIG_VERSION 2
+typedef struct {
+    uint16_t light;       // Day/night
+    uint16_t dry;         // Soil dry
+    uint16_t out;         // Soil sensor out of soil
+    uint16_t water;       // Watering needed
+    uint16_t window;      // Open window, air humidity in tenths of %
+    uint16_t t_adc;       // Task periods in milliseconds
+    uint16_t t_ctrl;
+    uint16_t t_disp;
+    uint16_t t_telem;
+    uint8_t contrast;     // OLED contrast
+    uint16_t twi_khz;     // I2C clock
+    uint32_t baud;        // UART speed, used after reset
+    uint8_t modbus;       // Modbus slave address, 0 for console
+} settings_t;
+static const settings_t settings_defaults PROGMEM = {
+    700, 260, 500, 300, 205, 100, 500, 500, 1000, 0x3f, 100, UART_BAUD, 0
+};
+settings_t settings;
+_Static_assert(sizeof(settings_t) <= CONFIG_DATA_MAX, "settings do not fit in EEPROM slot");
+#if EELOG_START + EELOG_BLOCKS * EELOG_BLOCK_SIZE > CONFIG_START
+# error "EEPROM log overlaps settings"
+#endif
+
+// Half widths of hysteresis bands
+#define LIGHT_HYST  20
+#define SOIL_HYST   10
+#define WINDOW_HYST 10
+static const char stats_names[][5] PROGMEM = {"temp", "soil"};
+
+// Report run-time statistics of tasks every n-th telemetry period; the
+// report is sent a few lines per run, whenever the UART buffer has room
+#define TELEMETRY_LINE_MS 10
+#define TELEMETRY_STATS_EVERY 10
+// Values as binary frames (telem.h, decoded by tools/telem_decode.c)
+// instead of CSV lines; the report stays text
+#ifndef TELEMETRY_BINARY
+# define TELEMETRY_BINARY 1
+#endif
+#define REPORT_LINES (TASK_COUNT + 5 + 2 * STATS_LEVELS)
+#define REPORT_NONE 0xff
+uint32_t telemetry_due = 0;      // Time of next values
+uint16_t telemetry_dropped = 0;  // Value lines skipped, UART buffer full
+uint8_t report_request = 0;      // Send report with next values
+uint8_t dump_request = 0;        // Start sending EEPROM log
 // -- Function definitions -------------------------------------------
 void oled_setup(void)
 {
     oled_init(OLED_DISP_ON);
-    oled_clrscr();
-
-    oled_charMode(DOUBLESIZE);
-    oled_puts("KYTKA DATA");
-
-    oled_charMode(NORMALSIZE);
-
-    oled_gotoxy(0, 2);
-    oled_puts("Svetlo: ");
-    oled_gotoxy(0, 3);
-    oled_puts("Vlh. pudy: ");
-    oled_gotoxy(0, 4);
-    oled_puts("Tep. vzduch: ");
-    oled_gotoxy(0, 5);
-    oled_puts("Vlh. vzduch: ");
-    oled_gotoxy(0, 6);
-    oled_puts("STAV: ");
-
-    // Copy buffer to display RAM
-    oled_display();
+    dashboard_setup();
 }
 
-void timer1_init(void)
+// Window actuator (now diode)
+void window_control(uint8_t open)
 {
-    TIM1_overflow_1s();
-    TIM1_overflow_interrupt_enable();
+    GPIO_mode_output(&DDRB, HUM);
+    if (open)
+        GPIO_write_high(&PORTB, HUM);
+    else
+        GPIO_write_low(&PORTB, HUM);
 }
 
-void adc_init(void)
+// Collect filtered results of the ADC scanner
+void task_adc(void)
 {
-    // Set the reference voltage to AVcc
-    ADMUX |= (1 << REFS0);
-    // Enable the ADC and set the prescaler
-    ADCSRA |= (1 << ADEN) | (7 << ADPS0);
+    adc_snapshot_t snap;
+
+    // All channels from the same moment, interrupts stay enabled
+    adc_snapshot(&snap);
+    light_level = snap.filtered[ADC_CH_LIGHT];
+    moisture_level = snap.filtered[ADC_CH_SOIL];
+    stats_add(&soil_stats, moisture_level);
 }
 
-uint16_t adc_read(uint8_t channel)
+// Measure temperature and humidity; the climate layer sets the time of
+// its next step (transfer, conversion, retry or sampling period)
+void task_climate(void)
 {
-    // Select the ADC channel
-    ADMUX = (ADMUX & 0xF0) | (channel & 0x0F);
-    // Start the conversion
-    ADCSRA |= (1 << ADSC);
-    // Wait for the conversion to complete
-    while (ADCSRA & (1 << ADSC));
-    // Return the ADC value
-    return ADC;
+    climate_data_t data;
+
+    sched_set_period(TASK_CLIMATE, climate_update());
+    if (!climate_read(&data))
+        return;
+
+    stats_add(&temp_stats, data.temperature);
+    filter_update(&temp_filter, data.temperature);
+    filter_update(&hum_filter, data.humidity);
+
+    if (temperature != filter_output(&temp_filter)) {
+        temperature = filter_output(&temp_filter);
+        display_dirty |= DASH_TEMP;
+    }
+    if (humidity != filter_output(&hum_filter)) {
+        humidity = filter_output(&hum_filter);
+        display_dirty |= DASH_HUM;
+    }
 }
-// open window command(now diode)
-void open_window(void) {
-    GPIO_mode_output(&DDRB, HUM);
-    GPIO_write_low(&PORTB, HUM);
+
+// Classify sensor values and drive the actuators on changes
+void task_control(void)
+{
+    uint32_t now = millis();
+
+    // Light level detection (highet value means day)
+    if (class_update(&light_class, light_level, now)) {
+        DLOG(CLASS, 0, class_state(&light_class));
+        display_dirty |= DASH_LIGHT;
+    }
+
+    // Soil moisture status
+    if (class_update(&soil_class, moisture_level, now)) {
+        DLOG(CLASS, 1, class_state(&soil_class));
+        display_dirty |= DASH_SOIL;
+    }
+
+    // Watering status
+    if (class_update(&water_class, moisture_level, now)) {
+        DLOG(CLASS, 2, class_state(&water_class));
+        display_dirty |= DASH_WATER;
+    }
+
+    // open window
+    if (class_update(&window_class, humidity, now)) {
+        DLOG(CLASS, 3, class_state(&window_class));
+        window_control(class_state(&window_class) == WINDOW_OPEN);
+        display_dirty |= DASH_WINDOW;
+    }
 }
 
-int main(void)
+// Redraw changed fields on the display
+void task_display(void)
 {
-    char oled_msg[20];
-    
-    uint16_t light_level;  // Variable for light level
-    uint16_t moisture_level;  // Variable for soil moisture level
-    const char *moisture_status;  // Variable for soil moisture status
+    dashboard_t d;
+    stats_result_t r;
+
+    if (display_dirty == 0 || !display_on)
+        return;
+
+    d.light = class_state(&light_class);
+    d.soil = class_state(&soil_class);
+    d.water = class_state(&water_class);
+    d.window = class_state(&window_class);
+    d.temperature = temperature;
+    d.humidity = humidity;
+    d.range_valid = 0;
+    if ((display_dirty & DASH_RANGE) &&
+        stats_get(&temp_stats, STATS_1H, &r)) {
+        d.range_valid = 1;
+        d.range_min = r.min;
+        d.range_max = r.max;
+    }
+    dashboard_draw(&d, display_dirty);
+    display_dirty = 0;
+}
 
-    // Initialize ADC
-    adc_init();
+// Format statistics of one window of one channel, return its length or
+// 0 if the window holds no samples yet
+uint8_t sprint_stats(char *s, uint8_t channel, uint8_t window)
+{
+    static const uint8_t window_minutes[STATS_LEVELS] = {1, 10, 60};
+    stats_t *st = channel ? &soil_stats : &temp_stats;
+    stats_result_t r;
+
+    if (!stats_get(st, window, &r))
+        return 0;
+    return sprintf_P(s, PSTR("# %S %um %d %d %d %lu\r\n"),
+                     stats_names[channel], window_minutes[window],
+                     r.min, r.max, r.mean, r.var);
+}
 
-    // TWI
-    twi_init();
+// Close buckets of statistics windows, log values from time to time
+void task_stats(void)
+{
+    static uint8_t n_ticks = 0;
+    int16_t values[EELOG_CHANNELS];
+
+    stats_tick(&temp_stats);
+    stats_tick(&soil_stats);
+    display_dirty |= DASH_RANGE;
+
+    if (++n_ticks < LOG_EVERY_TICKS)
+        return;
+    n_ticks = 0;
+
+    values[0] = temperature;
+    values[1] = humidity;
+    values[2] = light_level;
+    values[3] = moisture_level;
+    eelog_append(values);
+}
 
-    // UART
-    uart_init(UART_BAUD_SELECT(115200, F_CPU));
+// Send EEPROM log to UART, oldest sample first, one line per run so the
+// other tasks keep running
+void task_dump(void)
+{
+    static eelog_iter_t it;
+    static uint8_t dumping = 0;
+    eelog_sample_t sample;
+    char uart_msg[48];
+    uint8_t len;
+
+    if (!dumping) {
+        if (!dump_request)
+            return;
+        dump_request = 0;
+        eelog_rewind(&it);
+        dumping = 1;
+        sched_set_period(TASK_DUMP, DUMP_LINE_MS);
+        uart_puts_p(PSTR("# boot,index,temp,hum,light,soil\r\n"));
+    }
 
-    // OLED setup
-    oled_setup();
+    // Wait for room of a whole line, other tasks use the UART too
+    if (uart_tx_free() < DUMP_LINE_MAX)
+        return;
+
+    if (!eelog_next(&it, &sample)) {
+        dumping = 0;
+        sched_set_period(TASK_DUMP, DUMP_IDLE_MS);
+        len = sprintf_P(uart_msg, PSTR("# end, %u dropped\r\n"),
+                        eelog_dropped());
+        uart_write(uart_msg, len);
+        return;
+    }
+    len = sprintf_P(uart_msg, PSTR("%u,%u,%d,%d,%d,%d\r\n"),
+                    sample.boot, sample.index, sample.value[0],
+                    sample.value[1], sample.value[2], sample.value[3]);
+    uart_write(uart_msg, len);
+}
 
-    // Timer1
-    timer1_init();
+// Format one line of statistics report, return its length or 0 if there
+// is nothing to send
+uint8_t sprint_report(char *s, uint8_t line)
+{
+    sched_stats_t stats;
+    climate_stats_t clim;
+    uart_stats_t uart;
+
+    // Task name, runs, average and maximum run time in us, late runs
+    if (line < TASK_COUNT) {
+        sched_get_stats(line, &stats);
+        return sprintf_P(s, PSTR("# %-7S %u %lu %u %u\r\n"),
+                task_names[line], stats.runs,
+                stats.runs ? stats.total_us / stats.runs : 0,
+                stats.max_us, stats.late);
+    }
+    line -= TASK_COUNT;
+
+    switch (line) {
+    case 0:
+        // Accepted samples and errors of temperature/humidity sensor
+        if (climate_sensor == 0)
+            return 0;
+        climate_get_stats(&clim);
+        return sprintf_P(s, PSTR("# %-7S %u %u %u %u %u %u %u %u\r\n"),
+                pgm_read_ptr(&climate_sensor->name), clim.samples,
+                clim.nack, clim.bus, clim.checksum, clim.range, clim.busy,
+                clim.retries, clim.stale);
+    case 1:
+        // Longest TWI interrupt in CPU cycles
+        return sprintf_P(s, PSTR("# twi_isr %u\r\n"), twi_async_isr_max());
+    case 2:
+        // Value lines dropped as the UART buffer was full
+        return sprintf_P(s, PSTR("# dropped %u\r\n"), telemetry_dropped);
+    case 3:
+        // UART bytes lost on receive, buffer peaks and waiting writes
+        uart_get_stats(&uart);
+        return sprintf_P(s, PSTR("# uart %u %u %u %u\r\n"),
+                uart.rx_dropped, uart.rx_peak, uart.tx_peak, uart.tx_stalls);
+    case 4:
+        // Achieved baud rate and its error in per mille
+        return sprintf_P(s, PSTR("# baud %lu %lu\r\n"), uart_get_baud(),
+                UART_BAUD_ERROR_PM(uart_get_baud(), uart_baud));
+    default:
+        // Channel, window, minimum, maximum, mean and variance
+        line -= 5;
+        return sprint_stats(s, line / STATS_LEVELS, line % STATS_LEVELS);
+    }
+}
 
-    sei();
+// Send values, and from time to time task run times, to UART. Never waits
+// for the UART: a value line which does not fit is dropped, report lines
+// wait for the next run, which comes sooner while a report is pending.
+// The period of the task stays settings.t_telem
+void task_telemetry(void)
+{
+    static uint8_t n_reports = 0;
+    static uint8_t line = REPORT_NONE;
+    char uart_msg[64];
+    uint8_t len;
+
+    // UART belongs to Modbus, values are read as input registers
+    if (modbus_address)
+        return;
+
+    if ((int32_t)(millis() - telemetry_due) >= 0) {
+        telemetry_due += settings.t_telem;
+#if TELEMETRY_BINARY
+        int16_t values[4] = {light_level, moisture_level, temperature,
+                             humidity};
+        if (!telem_send(TELEM_TYPE_VALUES, millis(), values, 4))
+            telemetry_dropped++;
+#else
+        len = sprintf_P(uart_msg, PSTR("%lu,%u,%u,%d,%d\r\n"), millis(),
+                light_level, moisture_level, temperature, humidity);
+        if (uart_tx_free() >= len)
+            uart_write(uart_msg, len);
+        else
+            telemetry_dropped++;
+#endif
 
-    
+        if (line == REPORT_NONE &&
+            (++n_reports >= TELEMETRY_STATS_EVERY || report_request)) {
+            n_reports = 0;
+            report_request = 0;
+            line = 0;
+        }
+    }
 
-    // Infinite loop
-    while (1)
-    {
-        if (flag_update_oled == 1)
-        {
-            // Read photoresistor value
-            light_level = adc_read(0);  // Read the light level from ADC channel 0
-            
-            // Light level detection (highet value means day)
-            oled_gotoxy(14, 2);
-            if (light_level > 700) {  
-                sprintf(oled_msg, "Den ");
-            } else {
-                sprintf(oled_msg, "Noc");
-            }
-            oled_puts(oled_msg);
-            
-    
-
-            // Read soil moisture level
-            moisture_level = adc_read(1);  
-
-            // Soil moisture status
-            oled_gotoxy(14, 3);
-            if (moisture_level > 500) { 
-                moisture_status = "Out ";
-            } else if (moisture_level > 260) {
-                moisture_status = "Dry";
-            } else {
-                moisture_status = "Wet";
-            }
-            oled_puts(moisture_status);
-
-            // Air temperature
-            oled_gotoxy(14, 4);
-            sprintf(oled_msg, "%u.%u C", dht12.temp_int, dht12.temp_dec);
-            oled_puts(oled_msg);
-
-            
-
-            // Air humidity
-            oled_gotoxy(14, 5);
-            sprintf(oled_msg, "%u.%u %%", dht12.hum_int, dht12.hum_dec);
-            oled_puts(oled_msg);
-
-            // Watering status
-            oled_gotoxy(14, 6);
-            if (moisture_level >= 300) {
-                sprintf(oled_msg, "Zalij  ");
-                open_window();
-            } else {
-                sprintf(oled_msg, "Zalito");
-            }
-            oled_puts(oled_msg);
-
-            // open window
-             oled_gotoxy(5, 7);
-            if ((dht12.hum_int ) > 20) {
-                open_window();
-                sprintf(oled_msg, "Okno otevreno");
-                GPIO_write_high(&PORTB, HUM);
-            } else {
-                sprintf(oled_msg, "Okno zavreno ");
-                GPIO_write_low(&PORTB, HUM);
-            }
-            oled_puts(oled_msg);
-
-            // Update OLED display
-            oled_display();
-
-            // Reset flag
-            flag_update_oled = 0;
+    while (line != REPORT_NONE) {
+        len = sprint_report(uart_msg, line);
+        if (len > uart_tx_free()) {
+            // Try again soon, values keep their own deadline
+            sched_delay(TASK_TELEMETRY, TELEMETRY_LINE_MS);
+            return;
+        }
+        uart_write(uart_msg, len);
+
+        if (++line == REPORT_LINES) {
+            line = REPORT_NONE;
+            // Next run when values are due, then one period apart
+            int32_t wait = telemetry_due - millis();
+            sched_delay(TASK_TELEMETRY, wait > 0 ? wait : 0);
         }
     }
+}
 
-    
-    return 0;
+// Parameters of commands "get" and "set", fields of `settings`
+typedef struct {
+    char name[8];
+    uint8_t offset;
+    uint8_t size;      // 1, 2 or 4 bytes
+    int32_t min;
+    int32_t max;
+} param_t;
+#define PARAM(name, field, min, max) \
+    {name, offsetof(settings_t, field), sizeof(((settings_t *)0)->field), min, max}
+static const param_t params[] PROGMEM = {
+    PARAM("light",    light, LIGHT_HYST, 1023 - LIGHT_HYST),
+    PARAM("dry",      dry, SOIL_HYST, 1023 - SOIL_HYST),
+    PARAM("out",      out, SOIL_HYST, 1023 - SOIL_HYST),
+    PARAM("water",    water, SOIL_HYST, 1023 - SOIL_HYST),
+    PARAM("window",   window, WINDOW_HYST, 1000 - WINDOW_HYST),
+    PARAM("t_adc",    t_adc, 10, 60000),
+    PARAM("t_ctrl",   t_ctrl, 10, 60000),
+    PARAM("t_disp",   t_disp, 10, 60000),
+    PARAM("t_telem",  t_telem, 10, 60000),
+    PARAM("contrast", contrast, 0, 255),
+    PARAM("twi_khz",  twi_khz, 32, 400),
+    PARAM("baud",     baud, 300, 2000000),
+    PARAM("modbus",   modbus, 0, 247),
+};
+#define PARAM_COUNT (sizeof(params) / sizeof(params[0]))
+
+// Set one pair of thresholds around its center
+void set_level(class_level_t *level, uint16_t center, uint8_t hyst,
+               uint8_t shift)
+{
+    level->enter = (center + hyst) << shift;
+    level->exit = (center - hyst) << shift;
 }
 
+// Pass settings to classifiers, tasks and buses; `changed` is the
+// offset of the changed field of settings_t, or SETTINGS_ALL. Tasks
+// restart their period and bus writes block on I2C, so both are done
+// only for their own field
+#define SETTINGS_ALL 0xff
+#define CHANGED(field) \
+    (changed == SETTINGS_ALL || changed == offsetof(settings_t, field))
+void settings_apply(uint8_t changed)
+{
+    set_level(&light_levels[LIGHT_DAY], settings.light, LIGHT_HYST, 0);
+    set_level(&soil_levels[SOIL_DRY], settings.dry, SOIL_HYST,
+              SOIL_OVERSAMPLING);
+    set_level(&soil_levels[SOIL_OUT], settings.out, SOIL_HYST,
+              SOIL_OVERSAMPLING);
+    set_level(&water_levels[WATER_NEED], settings.water, SOIL_HYST,
+              SOIL_OVERSAMPLING);
+    set_level(&window_levels[WINDOW_OPEN], settings.window, WINDOW_HYST, 0);
+
+    if (CHANGED(t_adc))
+        sched_set_period(TASK_ADC, settings.t_adc);
+    if (CHANGED(t_ctrl))
+        sched_set_period(TASK_CONTROL, settings.t_ctrl);
+    if (CHANGED(t_disp))
+        sched_set_period(TASK_DISPLAY, settings.t_disp);
+    if (CHANGED(t_telem)) {
+        // Values follow the new period from now on
+        sched_set_period(TASK_TELEMETRY, settings.t_telem);
+        telemetry_due = millis() + settings.t_telem;
+    }
+
+    if (CHANGED(contrast))
+        oled_set_contrast(settings.contrast);
+    if (CHANGED(twi_khz))
+        twi_set_speed(settings.twi_khz);
+}
 
-ISR(TIMER1_OVF_vect)
+// Test if UART speed is reachable within UART_BAUD_MAX_ERROR_PM, e.g.
+// 115200 is not at 16 MHz (2.1 % error), 57600 is (0.8 %)
+uint8_t baud_valid(uint32_t baud)
 {
-    static uint8_t n_ovfs = 0;
+    if (baud < 300)
+        return 0;
+    return UART_BAUD_ERROR_PM(UART_BAUD_RATE_AUTO(baud, F_CPU), baud) <=
+           UART_BAUD_MAX_ERROR_PM;
+}
 
-    n_ovfs++;
-    // Read the data every 2 secs
-    if (n_ovfs >= 2)
-    {
-        n_ovfs = 0;
-        twi_readfrom_mem_into(DHT_ADR, DHT_HUM_MEM, dht12_values, 5);
-        flag_update_oled = 1;
-
-        // Test ACK from sensor
-        twi_start();
-        if (twi_write((SENSOR_ADR<<1) | TWI_WRITE) == 0) {
-            // Set internal memory location
-            twi_write(SENSOR_TEMP_MEM);
-            twi_stop();
-            // Read data from internal memory
-            twi_start();
-            twi_write((SENSOR_ADR<<1) | TWI_READ);
-            dht12.temp_int = twi_read(TWI_ACK);
-            dht12.temp_dec = twi_read(TWI_NACK);
-
-            new_sensor_data = 1;
+// Read current value of one parameter
+int32_t param_get(const param_t *p)
+{
+    const uint8_t *field = (const uint8_t *)&settings + p->offset;
+
+    if (p->size == 1)
+        return *field;
+    if (p->size == 2)
+        return *(const uint16_t *)field;
+    return *(const uint32_t *)field;
+}
+
+// Change one parameter, keep it in EEPROM; return CONSOLE_OK or
+// CONSOLE_RANGE
+uint8_t param_set(const param_t *p, int32_t value)
+{
+    uint8_t *field = (uint8_t *)&settings + p->offset;
+
+    if (value < p->min || value > p->max)
+        return CONSOLE_RANGE;
+    // Speed must be reachable from F_CPU, applied after next reset
+    if (p->offset == offsetof(settings_t, baud) && !baud_valid(value))
+        return CONSOLE_RANGE;
+    // Modbus frame gap needs at least MODBUS_BAUD_MIN
+    if (p->offset == offsetof(settings_t, baud) && settings.modbus &&
+        value < MODBUS_BAUD_MIN)
+        return CONSOLE_RANGE;
+    if (p->offset == offsetof(settings_t, modbus) && value &&
+        settings.baud < MODBUS_BAUD_MIN)
+        return CONSOLE_RANGE;
+    // Nothing to apply or save
+    if (value == param_get(p))
+        return CONSOLE_OK;
+
+    if (p->size == 1)
+        *field = value;
+    else if (p->size == 2)
+        *(uint16_t *)field = value;
+    else
+        *(uint32_t *)field = value;
+
+    settings_apply(p->offset);
+    config_save();
+    DLOG(PARAM, p->offset, value);
+    return CONSOLE_OK;
+}
+
+// Send "name value" of one parameter
+void param_print(const param_t *p)
+{
+    char uart_msg[24];
+
+    sprintf_P(uart_msg, PSTR("%s %ld\r\n"), p->name, param_get(p));
+    uart_puts(uart_msg);
+}
+
+// Find parameter by name and copy it from program memory
+uint8_t param_find(const char *name, param_t *p)
+{
+    for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+        if (strcmp_P(name, params[i].name) == 0) {
+            memcpy_P(p, &params[i], sizeof(param_t));
+            return 1;
         }
-        twi_stop();
-
-        twi_start();
-        if (twi_write((SENSOR_ADR<<1) | TWI_WRITE) == 0) {
-            // Set internal memory location
-            twi_write(SENSOR_HUM_MEM);
-            twi_stop();
-            // Read data from internal memory
-            twi_start();
-            twi_write((SENSOR_ADR<<1) | TWI_READ);
-            dht12.hum_int = twi_read(TWI_ACK);
-            dht12.hum_dec = twi_read(TWI_NACK);
-
-            new_sensor_data = 1;
+    }
+    return 0;
+}
+
+// get [name]: send one or all parameters
+uint8_t cmd_get(uint8_t argc, char *argv[])
+{
+    param_t p;
+
+    if (argc == 1) {
+        for (uint8_t i = 0; i < PARAM_COUNT; i++) {
+            memcpy_P(&p, &params[i], sizeof(param_t));
+            param_print(&p);
         }
-        twi_stop();
+        return CONSOLE_OK;
+    }
+    if (argc != 2 || !param_find(argv[1], &p))
+        return CONSOLE_USAGE;
+    param_print(&p);
+    return CONSOLE_OK;
+}
+
+// set name value: change one parameter
+uint8_t cmd_set(uint8_t argc, char *argv[])
+{
+    param_t p;
+    int32_t value;
+
+    if (argc != 3 || !param_find(argv[1], &p) ||
+        !console_number(argv[2], &value))
+        return CONSOLE_USAGE;
+    return param_set(&p, value);
+}
+
+// display on|off: switch OLED, no I2C traffic of display task when off
+uint8_t cmd_display(uint8_t argc, char *argv[])
+{
+    if (argc != 2)
+        return CONSOLE_USAGE;
+    if (strcmp_P(argv[1], PSTR("on")) == 0) {
+        oled_sleep(0);
+        display_on = 1;
+        display_dirty = DASH_ALL;
+    }
+    else if (strcmp_P(argv[1], PSTR("off")) == 0) {
+        display_on = 0;
+        oled_sleep(YES);
     }
+    else
+        return CONSOLE_USAGE;
+    return CONSOLE_OK;
+}
+
+// stats [clear]: send report with the next values, or reset run-time
+// statistics of tasks and UART
+uint8_t cmd_stats(uint8_t argc, char *argv[])
+{
+    if (argc == 1)
+        report_request = 1;
+    else if (argc == 2 && strcmp_P(argv[1], PSTR("clear")) == 0) {
+        sched_reset_stats();
+        uart_clear_stats();
+    }
+    else
+        return CONSOLE_USAGE;
+    return CONSOLE_OK;
+}
+
+// dump: send EEPROM log, see task_dump()
+uint8_t cmd_dump(uint8_t argc, char *argv[])
+{
+    dump_request = 1;
+    return CONSOLE_OK;
+}
+
+#ifdef PROF_ENABLE
+// prof [clear]: send calls and minimum, maximum and mean CPU cycles of
+// code regions, or reset them
+uint8_t cmd_prof(uint8_t argc, char *argv[])
+{
+    char uart_msg[56];
+    prof_stats_t st;
+
+    if (argc == 2 && strcmp_P(argv[1], PSTR("clear")) == 0) {
+        prof_init();
+        return CONSOLE_OK;
+    }
+    if (argc != 1)
+        return CONSOLE_USAGE;
+    for (uint8_t i = 0; i < PROF_COUNT; i++) {
+        prof_get(i, &st);
+        sprintf_P(uart_msg, PSTR("# %-12S %lu %lu %lu %lu\r\n"),
+                  prof_label(i), st.count, st.min, st.max, st.mean);
+        uart_puts(uart_msg);
+    }
+    return CONSOLE_OK;
+}
+#endif
+
+static const console_cmd_t commands[] PROGMEM = {
+    {"get", cmd_get},
+    {"set", cmd_set},
+    {"display", cmd_display},
+    {"stats", cmd_stats},
+    {"dump", cmd_dump},
+#ifdef PROF_ENABLE
+    {"prof", cmd_prof},
+#endif
+};
+
+// Send deferred log records, binary frames also with text telemetry;
+// the UART belongs to Modbus if it is used, the records wait meanwhile
+#define DLOG_FLUSH_MS 10
+void task_log(void)
+{
+    if (!modbus_address)
+        dlog_flush();
+}
+
+// Modbus input registers: values, ADC channels, states of classifiers
+// (window state drives the actuator) and Modbus counters
+#define REG_TEMPERATURE 0   // Tenths of deg C, signed
+#define REG_HUMIDITY    1   // Tenths of percent
+#define REG_LIGHT       2   // Filtered levels used by classifiers
+#define REG_SOIL        3
+#define REG_ADC         4   // Filtered ADC channels 0 to 3
+#define REG_CLASS       8   // Light, soil, water, window
+#define REG_MODBUS      12  // Requests, exceptions, CRC errors, dropped
+#define REG_INPUT_COUNT 16
+
+uint8_t modbus_read_input(uint16_t reg, uint16_t *value)
+{
+    static classifier_t * const classes[] = {
+        &light_class, &soil_class, &water_class, &window_class
+    };
+    modbus_stats_t stats;
+
+    if (reg >= REG_INPUT_COUNT)
+        return MODBUS_ILLEGAL_ADDRESS;
+    if (reg >= REG_MODBUS) {
+        modbus_get_stats(&stats);
+        *value = ((uint16_t *)&stats)[reg - REG_MODBUS];
+    }
+    else if (reg >= REG_CLASS)
+        *value = class_state(classes[reg - REG_CLASS]);
+    else if (reg >= REG_ADC)
+        *value = adc_filtered(reg - REG_ADC);
+    else if (reg == REG_TEMPERATURE)
+        *value = temperature;
+    else if (reg == REG_HUMIDITY)
+        *value = humidity;
+    else if (reg == REG_LIGHT)
+        *value = light_level;
+    else
+        *value = moisture_level;
+    return MODBUS_OK;
+}
+
+// Modbus holding registers are the parameters in order of params[];
+// the 32-bit baud rate can only be changed by command "set"
+uint8_t modbus_read_holding(uint16_t reg, uint16_t *value)
+{
+    param_t p;
+
+    if (reg >= PARAM_COUNT)
+        return MODBUS_ILLEGAL_ADDRESS;
+    memcpy_P(&p, &params[reg], sizeof(param_t));
+    if (p.size > 2)
+        return MODBUS_ILLEGAL_ADDRESS;
+    *value = param_get(&p);
+    return MODBUS_OK;
+}
+
+uint8_t modbus_write_holding(uint16_t reg, uint16_t value)
+{
+    param_t p;
+
+    if (reg >= PARAM_COUNT)
+        return MODBUS_ILLEGAL_ADDRESS;
+    memcpy_P(&p, &params[reg], sizeof(param_t));
+    if (p.size > 2)
+        return MODBUS_ILLEGAL_ADDRESS;
+    if (param_set(&p, value) != CONSOLE_OK)
+        return MODBUS_ILLEGAL_VALUE;
+    return MODBUS_OK;
+}
+
+static const modbus_map_t modbus_map = {
+    modbus_read_input, modbus_read_holding, modbus_write_holding
+};
+
+// Receive hook of the UART (-DUART_RX_HOOK=serial_rx), Modbus takes all
+// bytes once it is started
+uint8_t serial_rx(uint8_t data)
+{
+    return modbus_rx(data) || console_rx(data);
+}
+
+// Answer Modbus requests or run commands received over UART, write
+// changed settings to EEPROM
+void task_serial(void)
+{
+    if (modbus_address)
+        modbus_poll();
+    else
+        console_poll();
+    config_update();
+}
+
+int main(void)
+{
+    uint8_t source;
+
+    // Settings first, before the data logger queues EEPROM writes
+    source = config_load(&settings, sizeof(settings), CONFIG_VERSION,
+                         &settings_defaults);
+    DLOG(BOOT, MCUSR, source);
+    MCUSR = 0;
+
+    // Initialize ADC and scan the sensor channels in background
+    adc_init();
+    adc_scan_init(adc_channels, sizeof(adc_channels));
+    adc_set_oversampling(ADC_CH_SOIL, SOIL_OVERSAMPLING);
+    // Bandgap needs to settle after the multiplexer switches to it
+    adc_channel_config(ADC_CH_VBG, ADC_REF_AVCC, 2);
+    adc_set_filter(ADC_CH_LIGHT, FILTER_MOVING_AVERAGE, 8);
+    adc_set_filter(ADC_CH_SOIL, FILTER_MEDIAN, 5);
+    adc_set_filter(ADC_CH_VBG, FILTER_EMA, 4);
+
+    class_init(&light_class, light_levels, 2, CLASS_DWELL_MS);
+    class_init(&soil_class, soil_levels, 3, CLASS_DWELL_MS);
+    class_init(&water_class, water_levels, 2, CLASS_DWELL_MS);
+    class_init(&window_class, window_levels, 2, WINDOW_DWELL_MS);
+
+    stats_init(&temp_stats);
+    stats_init(&soil_stats);
+    eelog_init();
+
+    // Sensor is read every 2 s, median of 3 removes single outliers
+    filter_init(&temp_filter, FILTER_MEDIAN, 3);
+    filter_init(&hum_filter, FILTER_MEDIAN, 3);
+
+    // TWI
+    twi_init();
+    climate_sensor = climate_init(climate_sensors,
+                                  sizeof(climate_sensors) / sizeof(climate_sensors[0]));
+
+    // UART, speed from settings if it can be reached
+    if (!baud_valid(settings.baud))
+        settings.baud = UART_BAUD;
+    uart_baud = settings.baud;
+    uart_init(UART_BAUD_SELECT_AUTO(uart_baud, F_CPU));
+    console_init(commands, sizeof(commands) / sizeof(commands[0]));
+    // Console instead of Modbus if the speed is too low for it
+    modbus_address = settings.modbus;
+    if (modbus_address && !modbus_init(modbus_address, uart_baud, &modbus_map))
+        modbus_address = 0;
+
+    // OLED setup
+    oled_setup();
+
+    // Tasks with 1 ms tick of Timer0, order must match TASK_* indexes
+    timebase_init();
+    sched_init();
+    sched_add(task_adc, settings.t_adc, 0);
+    sched_add(task_climate, CLIMATE_TRANSFER_MS, 1);
+    sched_add(task_control, settings.t_ctrl, 2);
+    sched_add(task_display, settings.t_disp, 3);
+    sched_add(task_telemetry, settings.t_telem, 4);
+    sched_add(task_stats, STATS_TICK_MS, 5);
+    sched_add(task_dump, DUMP_IDLE_MS, 6);
+    sched_add(task_serial, modbus_address ? MODBUS_POLL_MS : CONSOLE_POLL_MS,
+              7);
+    sched_add(task_log, DLOG_FLUSH_MS, 8);
+    settings_apply(SETTINGS_ALL);
+
+    sei();
+    adc_scan_start_timed(ADC_SAMPLE_PERIOD_US);
+#ifdef PROF_ENABLE
+    // Counts CPU cycles with Timer/Counter1 of ADC sampling
+    prof_init();
+#endif
+
+    // Infinite loop
+    while (1)
+    {
+        if (sched_dispatch() == 0)
+            // Halt CPU until next interrupt, less digital noise for the ADC
+            adc_sleep();
+    }
+
+    return 0;
 }
@@ -0,0 +1,28 @@
+#ifndef BENCH_H
+# define BENCH_H
+
+/*
+ * Workloads of the simavr benchmark, shared by firmware and simulator.
+ * (c) 2024 MIT license
+ *
+ * BENCH(id, name): the firmware writes id to GPIOR0 when the workload
+ * starts and 0 when it ends, the simulator prints one line per
+ * workload. Ids are fixed, so results of different commits compare
+ * line by line; append new workloads at the end.
+ */
+
+#define BENCH_LIST \
+    BENCH(1, full_refresh)      /* oled_display() of whole buffer */ \
+    BENCH(2, dashboard_update)  /* dashboard_draw() of all fields */ \
+    BENCH(3, text_render)       /* 8 lines of 21 characters to buffer */ \
+    BENCH(4, text_double)       /* 4 lines of double size characters */ \
+    BENCH(5, fill_primitives)   /* Rectangles, circles and lines */ \
+    BENCH(6, sensor_read)       /* DHT12 read in background and decode */ \
+    BENCH(7, dashboard_text)    /* dashboard_draw() in TEXTMODE, firmware */
+
+/** @brief  Marker of a workload that has ended */
+#define BENCH_END 0
+/** @brief  Marker after the last workload, the simulator stops */
+#define BENCH_DONE 0xff
+
+#endif
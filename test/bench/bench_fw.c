@@ -0,0 +1,164 @@
+/*
+ * Benchmark firmware for simavr, see bench_sim.c.
+ * (c) 2024 MIT license
+ *
+ * Developed using PlatformIO and AVR 8-bit Toolchain 3.6.2.
+ * Runs in simavr as ATmega328P, 16 MHz.
+ *
+ * Runs each workload of bench.h once with the real drivers. The
+ * workload id is written to GPIOR0 at start and BENCH_END at end, so
+ * the simulator counts cycles and bus bytes of exactly this code.
+ * Built with -DTEXTMODE, as the firmware, it runs only dashboard_text.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+#include <oled.h>
+#include <dashboard.h>
+#include <twi.h>
+#include <dht12.h>
+#include "bench.h"
+
+
+// -- Defines --------------------------------------------------------
+#define bench_begin(id) (GPIOR0 = (id))
+#define bench_end()     (GPIOR0 = BENCH_END)
+
+
+// -- Global variables -----------------------------------------------
+climate_data_t sample;   // Kept, so the decoding is not optimized away
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: dashboard()
+ * Purpose:  Redraw all value fields of the main screen through the
+ *           dashboard library of the firmware.
+ * Returns:  none
+ */
+static void dashboard(void)
+{
+    static const dashboard_t d = {
+        .light = 1, .soil = 1, .water = 1, .window = 1,
+        .temperature = 234, .humidity = 456,
+        .range_valid = 1, .range_min = 210, .range_max = 245,
+    };
+
+    dashboard_draw(&d, DASH_ALL);
+}
+
+
+#ifndef TEXTMODE
+/*
+ * Function: text(), text_double()
+ * Purpose:  Fill the buffer with text in normal and double size.
+ * Returns:  none
+ */
+static void text(void)
+{
+    for (uint8_t y = 0; y < 8; y++) {
+        oled_gotoxy(0, y);
+        oled_puts_p(PSTR("0123456789 ABCDEFGHIJ"));
+    }
+}
+
+static void text_double(void)
+{
+    oled_charMode(DOUBLESIZE);
+    for (uint8_t y = 0; y < 8; y += 2) {
+        oled_gotoxy(0, y);
+        oled_puts_p(PSTR("Tep 23.4"));
+    }
+    oled_charMode(NORMALSIZE);
+}
+
+
+/*
+ * Function: fill()
+ * Purpose:  Draw filled and outlined shapes into the buffer.
+ * Returns:  none
+ */
+static void fill(void)
+{
+    oled_fillRect(0, 0, 127, 63, WHITE);
+    oled_fillRect(8, 8, 119, 55, BLACK);
+    oled_drawRect(16, 16, 111, 47, WHITE);
+    oled_fillCircle(64, 32, 12, WHITE);
+    oled_drawCircle(64, 32, 20, WHITE);
+    oled_drawLine(0, 0, 127, 63, WHITE);
+    oled_drawLine(0, 63, 127, 0, WHITE);
+}
+
+
+/*
+ * Function: sensor_read()
+ * Purpose:  Read DHT12 by interrupt-driven transfer, as the climate
+ *           layer does, and decode the sample.
+ * Returns:  none
+ */
+static void sensor_read(void)
+{
+    uint8_t (*fetch)(void) =
+        (uint8_t (*)(void))pgm_read_ptr(&dht12_driver.fetch);
+    uint8_t (*decode)(climate_data_t *) =
+        (uint8_t (*)(climate_data_t *))pgm_read_ptr(&dht12_driver.decode);
+
+    if (fetch() != TWI_ASYNC_BUSY)
+        return;
+    while (twi_async_status() == TWI_ASYNC_BUSY)
+        ;
+    decode(&sample);
+}
+#endif
+
+
+int main(void)
+{
+    // Set up outside of the measured workloads
+    oled_init(OLED_DISP_ON);
+    dashboard_setup();
+    sei();
+
+#ifdef TEXTMODE
+    bench_begin(7);
+    dashboard();
+    bench_end();
+#else
+    bench_begin(1);
+    oled_display();
+    bench_end();
+
+    bench_begin(2);
+    dashboard();
+    bench_end();
+
+    oled_clear_buffer();
+    bench_begin(3);
+    text();
+    bench_end();
+
+    oled_clear_buffer();
+    bench_begin(4);
+    text_double();
+    bench_end();
+
+    oled_clear_buffer();
+    bench_begin(5);
+    fill();
+    bench_end();
+
+    bench_begin(6);
+    sensor_read();
+    bench_end();
+
+    // Display content for the check sum of the simulator
+    oled_display();
+#endif
+    GPIOR0 = BENCH_DONE;
+    cli();
+    sleep_cpu();
+    return 0;
+}
@@ -0,0 +1,266 @@
+/*
+ * simavr benchmark runner, see bench_fw.c.
+ * (c) 2024 MIT license
+ *
+ * Build and run (simavr and libelf installed):
+ *   make -C test/bench run > bench.csv
+ *
+ * Runs the benchmark firmware as ATmega328P at 16 MHz with simulated
+ * I2C slaves: SH1106 display (0x3c), whose display RAM is tracked, and
+ * DHT12 sensor (0x5c) returning 23.4 deg C and 45.6 %. Writes of
+ * GPIOR0 mark the workloads of bench.h. One CSV line per workload:
+ *
+ *   workload,cycles,i2c_transactions,i2c_bytes,display_crc
+ *
+ * i2c_bytes counts address and data bytes in both directions,
+ * display_crc is CRC-32 of the display RAM at the end of the workload,
+ * so changed rendering shows up as well as changed timing. Output is
+ * deterministic, compare two runs with compare.sh.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/avr_twi.h>
+#include "bench.h"
+
+
+// -- Defines --------------------------------------------------------
+#define F_CPU 16000000UL
+#define GPIOR0_ADDR 0x3e        // Data address of GPIOR0, ATmega328P
+
+#define SH1106_ADR 0x3c
+#define SH1106_PAGES 8
+#define SH1106_COLUMNS 132
+#define DHT12_ADR 0x5c
+
+
+// -- Types ----------------------------------------------------------
+typedef struct {
+    avr_irq_t *irq;             // Input and output of the slave
+    uint8_t selected;           // Address byte of current transfer
+    uint8_t first;              // Next written byte is the first one
+    // SH1106
+    uint8_t data_mode;          // Control byte 0x40: data, else commands
+    uint8_t page;
+    uint8_t column;
+    uint8_t ram[SH1106_PAGES][SH1106_COLUMNS];
+    // DHT12
+    uint8_t reg;
+    uint8_t regs[5];
+    // Counters of current workload
+    unsigned long transactions;
+    unsigned long bytes;
+} bus_t;
+
+
+// -- Global variables -----------------------------------------------
+static bus_t bus;
+static uint8_t workload = BENCH_END;
+static avr_cycle_count_t start_cycle;
+static int done = 0;
+
+static const char *const names[256] = {
+#define BENCH(id, name) [id] = #name,
+    BENCH_LIST
+#undef BENCH
+};
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: crc32()
+ * Purpose:  CRC-32 (IEEE 802.3) of a block.
+ * Input(s): data - Bytes
+ *           len - Number of bytes
+ * Returns:  CRC
+ */
+static uint32_t crc32(const uint8_t *data, size_t len)
+{
+    uint32_t crc = 0xffffffff;
+
+    while (len--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+    }
+    return ~crc;
+}
+
+
+/*
+ * Function: sh1106_write()
+ * Purpose:  Take one byte written to the display: control byte, page
+ *           and column commands, or display data. Other commands and
+ *           their arguments are ignored.
+ * Input(s): data - Byte
+ * Returns:  none
+ */
+static void sh1106_write(uint8_t data)
+{
+    if (bus.first) {
+        bus.first = 0;
+        bus.data_mode = (data & 0x40) != 0;
+        return;
+    }
+    if (bus.data_mode) {
+        if (bus.column < SH1106_COLUMNS)
+            bus.ram[bus.page][bus.column++] = data;
+        return;
+    }
+    if (data >= 0xb0 && data <= 0xb7)
+        bus.page = data & 0x07;
+    else if (data <= 0x0f)
+        bus.column = (bus.column & 0xf0) | data;
+    else if (data >= 0x10 && data <= 0x1f)
+        bus.column = (bus.column & 0x0f) | (data & 0x0f) << 4;
+}
+
+
+/*
+ * Function: twi_hook()
+ * Purpose:  Answer messages of the TWI master of the AVR as SH1106 or
+ *           DHT12, other addresses are not acknowledged.
+ * Input(s): irq - Output IRQ of the slaves
+ *           value - Message
+ *           param - Not used
+ * Returns:  none
+ */
+static void twi_hook(avr_irq_t *irq, uint32_t value, void *param)
+{
+    avr_twi_msg_irq_t v;
+    uint8_t adr;
+
+    (void)irq;
+    (void)param;
+    v.u.v = value;
+
+    if (v.u.twi.msg & TWI_COND_STOP)
+        bus.selected = 0;
+
+    if (v.u.twi.msg & TWI_COND_START) {
+        bus.selected = 0;
+        adr = v.u.twi.addr >> 1;
+        if (adr == SH1106_ADR || adr == DHT12_ADR) {
+            bus.selected = v.u.twi.addr;
+            bus.first = 1;
+            bus.transactions++;
+            bus.bytes++;
+            avr_raise_irq(bus.irq + TWI_IRQ_INPUT,
+                          avr_twi_irq_msg(TWI_COND_ACK, bus.selected, 1));
+        }
+    }
+    if (!bus.selected)
+        return;
+    adr = bus.selected >> 1;
+
+    if (v.u.twi.msg & TWI_COND_WRITE) {
+        bus.bytes++;
+        avr_raise_irq(bus.irq + TWI_IRQ_INPUT,
+                      avr_twi_irq_msg(TWI_COND_ACK, bus.selected, 1));
+        if (adr == SH1106_ADR)
+            sh1106_write(v.u.twi.data);
+        else {
+            // Register address, then nothing to write
+            bus.reg = v.u.twi.data;
+            bus.first = 0;
+        }
+    }
+    if (v.u.twi.msg & TWI_COND_READ) {
+        uint8_t data = 0xff;
+
+        bus.bytes++;
+        if (adr == DHT12_ADR && bus.reg < sizeof(bus.regs))
+            data = bus.regs[bus.reg++];
+        avr_raise_irq(bus.irq + TWI_IRQ_INPUT,
+                      avr_twi_irq_msg(TWI_COND_READ, bus.selected, data));
+    }
+}
+
+
+/*
+ * Function: gpior0_write()
+ * Purpose:  Start or end a workload and print its line.
+ * Input(s): avr - Simulated core
+ *           addr - GPIOR0
+ *           v - Written value
+ *           param - Not used
+ * Returns:  none
+ */
+static void gpior0_write(avr_t *avr, avr_io_addr_t addr, uint8_t v,
+                         void *param)
+{
+    (void)param;
+    avr->data[addr] = v;
+
+    if (v == BENCH_DONE) {
+        done = 1;
+        return;
+    }
+    if (v != BENCH_END) {
+        workload = v;
+        start_cycle = avr->cycle;
+        bus.transactions = 0;
+        bus.bytes = 0;
+        return;
+    }
+    if (workload == BENCH_END)
+        return;
+    printf("%s,%llu,%lu,%lu,%08lx\n",
+           names[workload] ? names[workload] : "unknown",
+           (unsigned long long)(avr->cycle - start_cycle),
+           bus.transactions, bus.bytes,
+           (unsigned long)crc32(&bus.ram[0][0], sizeof(bus.ram)));
+    workload = BENCH_END;
+}
+
+
+int main(int argc, char *argv[])
+{
+    static const char *irq_names[2] = {"8<twi.in", "8>twi.out"};
+    static const uint8_t dht12_regs[5] = {45, 6, 23, 4, 45 + 6 + 23 + 4};
+    elf_firmware_t fw;
+    avr_t *avr;
+    int state;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s bench_fw.elf\n", argv[0]);
+        return 1;
+    }
+    memset(&fw, 0, sizeof(fw));
+    if (elf_read_firmware(argv[1], &fw) != 0) {
+        fprintf(stderr, "%s: cannot read firmware\n", argv[1]);
+        return 1;
+    }
+    avr = avr_make_mcu_by_name("atmega328p");
+    if (avr == NULL)
+        return 1;
+    avr_init(avr);
+    avr_load_firmware(avr, &fw);
+    avr->frequency = F_CPU;
+
+    memcpy(bus.regs, dht12_regs, sizeof(bus.regs));
+    bus.irq = avr_alloc_irq(&avr->irq_pool, 0, 2, irq_names);
+    avr_irq_register_notify(bus.irq + TWI_IRQ_OUTPUT, twi_hook, NULL);
+    avr_connect_irq(bus.irq + TWI_IRQ_INPUT,
+                    avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT));
+    avr_connect_irq(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT),
+                    bus.irq + TWI_IRQ_OUTPUT);
+    avr_register_io_write(avr, GPIOR0_ADDR, gpior0_write, NULL);
+
+    printf("workload,cycles,i2c_transactions,i2c_bytes,display_crc\n");
+    do {
+        state = avr_run(avr);
+    } while (!done && state != cpu_Done && state != cpu_Crashed);
+
+    if (!done) {
+        fprintf(stderr, "firmware stopped before the last workload\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,25 @@
+#!/bin/sh
+# Compare two results of the simavr benchmark (make run > file.csv):
+# change of cycles and bus bytes per workload, changed display content
+# is marked; exit status 1 if any workload got slower.
+#
+#   ./compare.sh base.csv new.csv
+
+if [ $# -ne 2 ]; then
+    echo "usage: $0 base.csv new.csv" >&2
+    exit 2
+fi
+
+awk -F, '
+NR == FNR { if (FNR > 1) { cyc[$1] = $2; byt[$1] = $4; crc[$1] = $5 }; next }
+FNR == 1 { printf "%-18s %12s %8s %8s %8s\n", "workload", "cycles", "delta", "%", "bytes" ; next }
+{
+    if (!($1 in cyc)) { printf "%-18s %12s new\n", $1, $2; next }
+    d = $2 - cyc[$1]
+    p = cyc[$1] ? 100.0 * d / cyc[$1] : 0
+    printf "%-18s %12d %+8d %+7.1f%% %+8d%s\n", $1, $2, d, p, $4 - byt[$1],
+           $5 != crc[$1] ? "  display changed" : ""
+    if (d > 0) slower = 1
+}
+END { exit slower }
+' "$1" "$2"
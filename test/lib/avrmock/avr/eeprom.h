@@ -0,0 +1,22 @@
+#ifndef MOCK_AVR_EEPROM_H
+# define MOCK_AVR_EEPROM_H
+
+/*
+ * Mock of <avr/eeprom.h> for host tests, backed by mock_eeprom[] of
+ * mock_avr.c, which also models writes through EECR, EEAR and EEDR.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EEMEM
+#define eeprom_is_ready() 1
+
+void eeprom_read_block(void *dst, const void *src, size_t n);
+void eeprom_write_block(const void *src, void *dst, size_t n);
+void eeprom_update_block(const void *src, void *dst, size_t n);
+uint8_t eeprom_read_byte(const uint8_t *p);
+void eeprom_write_byte(uint8_t *p, uint8_t value);
+void eeprom_update_byte(uint8_t *p, uint8_t value);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef MOCK_AVR_INTERRUPT_H
+# define MOCK_AVR_INTERRUPT_H
+
+/*
+ * Mock of <avr/interrupt.h> for host tests.
+ * (c) 2024 MIT license
+ *
+ * Interrupt service routines become plain functions, called by the
+ * peripheral models of mock_avr.c while the I bit of SREG is set.
+ */
+
+#include <avr/io.h>
+
+#define ISR(vector, ...) void vector(void); void vector(void)
+#define ISR_NOBLOCK
+#define ISR_BLOCK
+#define EMPTY_INTERRUPT(vector) void vector(void) {}
+#define sei() (SREG |= 0x80)
+#define cli() (SREG &= 0x7f)
+
+#endif
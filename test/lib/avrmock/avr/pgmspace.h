@@ -0,0 +1,29 @@
+#ifndef MOCK_AVR_PGMSPACE_H
+# define MOCK_AVR_PGMSPACE_H
+
+/*
+ * Mock of <avr/pgmspace.h> for host tests: program memory is plain
+ * memory. Note that %S of sprintf_P() means a wide string on the host.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(p)  (*(const uint8_t *)(p))
+#define pgm_read_word(p)  (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_ptr(p)   (*(void * const *)(p))
+#define memcpy_P   memcpy
+#define strcmp_P   strcmp
+#define strncmp_P  strncmp
+#define strlen_P   strlen
+#define strcpy_P   strcpy
+#define sprintf_P  sprintf
+#define snprintf_P snprintf
+
+#endif
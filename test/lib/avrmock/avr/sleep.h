@@ -0,0 +1,17 @@
+#ifndef MOCK_AVR_SLEEP_H
+# define MOCK_AVR_SLEEP_H
+
+/*
+ * Mock of <avr/sleep.h> for host tests, sleeping returns at once.
+ */
+
+#define SLEEP_MODE_IDLE 0
+#define SLEEP_MODE_ADC  2
+#define SLEEP_MODE_PWR_DOWN 4
+#define set_sleep_mode(mode) ((void)(mode))
+#define sleep_enable()  ((void)0)
+#define sleep_disable() ((void)0)
+#define sleep_cpu()     ((void)0)
+#define sleep_mode()    ((void)0)
+
+#endif
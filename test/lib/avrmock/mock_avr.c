@@ -0,0 +1,441 @@
+/*
+ * Peripheral models behind the register mock, for host tests.
+ * (c) 2024 MIT license
+ */
+
+// -- Includes -------------------------------------------------------
+#include <string.h>
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <mock_avr.h>
+
+
+// -- Defines --------------------------------------------------------
+#define R(addr) (mock_mem[addr])
+
+#define A_SREG   0x5f
+#define A_TWSR   0xb9
+#define A_TWDR   0xbb
+#define A_TWCR   0xbc
+#define A_UCSR0A 0xc0
+#define A_UCSR0B 0xc1
+#define A_UDR0   0xc6
+#define A_ADCL   0x78
+#define A_ADCH   0x79
+#define A_ADCSRA 0x7a
+#define A_ADCSRB 0x7b
+#define A_ADMUX  0x7c
+#define A_EECR   0x3f
+#define A_EEDR   0x40
+#define A_EEARL  0x41
+#define A_EEARH  0x42
+
+#define I_BIT    0x80
+#define TWI_DONE (1<<1)         // Reserved bit of TWCR: command executed
+#define POLL_MAX 10000          // Events handled by one poll
+
+
+// -- Types ----------------------------------------------------------
+typedef struct {
+    uint8_t adr;
+    uint8_t *mem;
+    uint8_t size;
+    uint8_t pos;
+} slave_t;
+
+
+// -- Global variables -----------------------------------------------
+mock_log_t mock_twi_log;
+mock_log_t mock_uart_log;
+mock_twi_stats_t mock_twi_stats;
+uint8_t mock_eeprom[MOCK_EEPROM_SIZE];
+uint32_t mock_reg_accesses;
+
+static volatile uint8_t mock_mem[256];
+static uint8_t in_isr = 0;
+static uint8_t in_poll = 0;
+static uint8_t udr_written;
+
+static slave_t slaves[MOCK_TWI_SLAVES];
+static slave_t *twi_slave;      // Addressed slave, 0 if none
+static uint8_t twi_active;      // Between start and stop
+static uint8_t twi_expect_sla;  // Next byte is address
+static uint8_t twi_reading;
+static uint8_t twi_first;       // Next written byte selects location
+static uint8_t twi_irq;         // TWINT set since last TWI_vect
+
+static uint16_t adc_values[16];
+
+// Interrupt service routines of the code under test, if linked
+void TWI_vect(void) __attribute__((weak));
+void USART_RX_vect(void) __attribute__((weak));
+void USART_UDRE_vect(void) __attribute__((weak));
+void USART_TX_vect(void) __attribute__((weak));
+void ADC_vect(void) __attribute__((weak));
+void EE_READY_vect(void) __attribute__((weak));
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: log_put()
+ * Purpose:  Append byte to a log.
+ */
+static void log_put(mock_log_t *log, uint8_t data)
+{
+    if (log->len < MOCK_LOG_SIZE)
+        log->data[log->len] = data;
+    if (log->len != 0xffff)
+        log->len++;
+}
+
+
+/*
+ * Function: run_isr()
+ * Purpose:  Call interrupt service routine with the I bit cleared, as
+ *           the AVR does, and set it again on return.
+ * Returns:  1 if the routine exists
+ */
+static uint8_t run_isr(void (*isr)(void))
+{
+    if (isr == 0)
+        return 0;
+    in_isr = 1;
+    R(A_SREG) &= ~I_BIT;
+    isr();
+    R(A_SREG) |= I_BIT;
+    in_isr = 0;
+    return 1;
+}
+
+
+/*
+ * Function: twi_step()
+ * Purpose:  Execute a command written to TWCR, raise TWI interrupt.
+ * Returns:  1 if something happened
+ */
+static uint8_t twi_step(void)
+{
+    uint8_t cr = R(A_TWCR);
+    uint8_t status;
+
+    if ((cr & (1<<TWINT)) && !(cr & TWI_DONE) && (cr & (1<<TWEN))) {
+        if (cr & (1<<TWSTO)) {
+            // TWINT is not set after a stop condition
+            mock_twi_stats.stops++;
+            twi_active = 0;
+            twi_slave = 0;
+            R(A_TWCR) = cr & ~((1<<TWSTO) | (1<<TWINT));
+            return 1;
+        }
+
+        if (cr & (1<<TWSTA)) {
+            status = twi_active ? 0x10 : 0x08;
+            mock_twi_stats.starts++;
+            twi_active = 1;
+            twi_expect_sla = 1;
+            twi_slave = 0;
+        }
+        else if (twi_expect_sla) {
+            uint8_t sla = R(A_TWDR);
+
+            log_put(&mock_twi_log, sla);
+            twi_expect_sla = 0;
+            twi_reading = sla & 1;
+            twi_first = 1;
+            for (uint8_t i = 0; i < MOCK_TWI_SLAVES; i++)
+                if (slaves[i].size != 0xff && slaves[i].adr == (sla >> 1))
+                    twi_slave = &slaves[i];
+            if (twi_slave)
+                status = twi_reading ? 0x40 : 0x18;
+            else {
+                mock_twi_stats.nacks++;
+                status = twi_reading ? 0x48 : 0x20;
+            }
+        }
+        else if (!twi_reading) {
+            uint8_t data = R(A_TWDR);
+
+            log_put(&mock_twi_log, data);
+            if (twi_slave == 0) {
+                mock_twi_stats.nacks++;
+                status = 0x30;
+            }
+            else {
+                if (twi_slave->mem) {
+                    if (twi_first)
+                        twi_slave->pos = data;
+                    else if (twi_slave->pos < twi_slave->size)
+                        twi_slave->mem[twi_slave->pos++] = data;
+                }
+                status = 0x28;
+            }
+            twi_first = 0;
+        }
+        else {
+            uint8_t data = 0xff;
+
+            if (twi_slave && twi_slave->mem &&
+                twi_slave->pos < twi_slave->size)
+                data = twi_slave->mem[twi_slave->pos++];
+            R(A_TWDR) = data;
+            mock_twi_stats.reads++;
+            status = (cr & (1<<TWEA)) ? 0x50 : 0x58;
+        }
+
+        R(A_TWSR) = status | (R(A_TWSR) & 0x03);
+        R(A_TWCR) = (cr & ~(1<<TWSTA)) | TWI_DONE;
+        twi_irq = 1;
+        return 1;
+    }
+
+    if (twi_irq && (cr & (1<<TWIE)) && (R(A_SREG) & I_BIT)) {
+        twi_irq = 0;
+        return run_isr(TWI_vect);
+    }
+    return 0;
+}
+
+
+/*
+ * Function: uart_step()
+ * Purpose:  Send one byte from USART_UDRE_vect while UDRIE0 is set,
+ *           then raise USART_TX_vect if TXCIE0 is set.
+ * Returns:  1 if something happened
+ */
+static uint8_t uart_step(void)
+{
+    static uint8_t sent = 0;
+
+    if (!(R(A_SREG) & I_BIT))
+        return 0;
+
+    if (R(A_UCSR0B) & (1<<UDRIE0)) {
+        udr_written = 0;
+        if (!run_isr(USART_UDRE_vect))
+            return 0;
+        if (udr_written) {
+            log_put(&mock_uart_log, R(A_UDR0));
+            R(A_UCSR0A) |= (1<<TXC0);
+            sent = 1;
+        }
+        return 1;
+    }
+    if (sent) {
+        sent = 0;
+        if (R(A_UCSR0B) & (1<<TXCIE0))
+            return run_isr(USART_TX_vect);
+    }
+    return 0;
+}
+
+
+/*
+ * Function: adc_step()
+ * Purpose:  End a started conversion with the value of its channel.
+ *           Auto trigger sources other than free running are not
+ *           modelled.
+ * Returns:  1 if something happened
+ */
+static uint8_t adc_step(void)
+{
+    uint8_t sr = R(A_ADCSRA);
+    uint16_t value;
+
+    if (!(sr & (1<<ADEN)) || !(sr & (1<<ADSC)))
+        return 0;
+
+    value = adc_values[R(A_ADMUX) & 0x0f];
+    if (R(A_ADMUX) & (1<<ADLAR))
+        value <<= 6;
+    R(A_ADCL) = value & 0xff;
+    R(A_ADCH) = value >> 8;
+    // Free running mode starts the next conversion at once
+    if ((sr & (1<<ADATE)) && (R(A_ADCSRB) & 0x07) == 0)
+        R(A_ADCSRA) = sr | (1<<ADIF);
+    else
+        R(A_ADCSRA) = (sr & ~(1<<ADSC)) | (1<<ADIF);
+    return 1;
+}
+
+
+/*
+ * Function: adc_irq()
+ * Purpose:  Run ADC_vect while ADIF is pending, which clears the flag.
+ * Returns:  1 if something happened
+ */
+static uint8_t adc_irq(void)
+{
+    uint8_t sr = R(A_ADCSRA);
+
+    if (!(sr & (1<<ADIF)) || !(sr & (1<<ADIE)) || !(R(A_SREG) & I_BIT))
+        return 0;
+    R(A_ADCSRA) = sr & ~(1<<ADIF);
+    return run_isr(ADC_vect);
+}
+
+
+/*
+ * Function: eeprom_step()
+ * Purpose:  Write or read one byte, raise EE_READY_vect.
+ * Returns:  1 if something happened
+ */
+static uint8_t eeprom_step(void)
+{
+    uint8_t cr = R(A_EECR);
+    uint16_t addr = (R(A_EEARL) | R(A_EEARH) << 8) % MOCK_EEPROM_SIZE;
+
+    if (cr & (1<<EEPE)) {
+        mock_eeprom[addr] = R(A_EEDR);
+        R(A_EECR) = cr & ~((1<<EEPE) | (1<<EEMPE));
+        return 1;
+    }
+    if (cr & (1<<EERE)) {
+        R(A_EEDR) = mock_eeprom[addr];
+        R(A_EECR) = cr & ~(1<<EERE);
+        return 1;
+    }
+    // Level interrupt: again only if the routine started a write
+    if ((cr & (1<<EERIE)) && (R(A_SREG) & I_BIT)) {
+        run_isr(EE_READY_vect);
+        return (R(A_EECR) & (1<<EEPE)) != 0;
+    }
+    return 0;
+}
+
+
+/*
+ * Function: mock_run()
+ * Purpose:  Let the models react until nothing more happens. One ADC
+ *           conversion per run, as an interrupt may start the next.
+ */
+void mock_run(void)
+{
+    uint8_t adc_done = 0;
+
+    if (in_isr || in_poll)
+        return;
+    in_poll = 1;
+    R(A_UCSR0A) |= (1<<UDRE0);  // Read-only bit, transmitter is always ready
+    for (uint16_t n = 0; n < POLL_MAX; n++) {
+        uint8_t event = twi_step() | uart_step() | eeprom_step() |
+                        adc_irq();
+
+        if (!adc_done)
+            event |= adc_done = adc_step();
+        if (!event)
+            break;
+    }
+    in_poll = 0;
+}
+
+
+/*
+ * Function: mock_reg8()
+ * Purpose:  Access of one register, see avr/io.h.
+ */
+volatile uint8_t *mock_reg8(uint8_t addr)
+{
+    mock_reg_accesses++;
+    if (addr == A_UDR0 && in_isr)
+        udr_written = 1;
+    // Reading halts the CPU until EEDR is valid, also inside interrupts
+    if (addr == A_EEDR && (R(A_EECR) & (1<<EERE)) &&
+        !(R(A_EECR) & (1<<EEPE))) {
+        R(A_EEDR) = mock_eeprom[(R(A_EEARL) | R(A_EEARH) << 8)
+                                % MOCK_EEPROM_SIZE];
+        R(A_EECR) &= ~(1<<EERE);
+    }
+    mock_run();
+    return &mock_mem[addr];
+}
+
+
+void mock_reset(void)
+{
+    memset((void *)mock_mem, 0, sizeof(mock_mem));
+    R(A_UCSR0A) = (1<<UDRE0);
+    memset(slaves, 0, sizeof(slaves));
+    for (uint8_t i = 0; i < MOCK_TWI_SLAVES; i++)
+        slaves[i].size = 0xff;      // Free entry
+    twi_slave = 0;
+    twi_active = 0;
+    twi_expect_sla = 0;
+    twi_irq = 0;
+    memset(adc_values, 0, sizeof(adc_values));
+    memset(mock_eeprom, 0xff, sizeof(mock_eeprom));
+    mock_log_clear(&mock_twi_log);
+    mock_log_clear(&mock_uart_log);
+    memset(&mock_twi_stats, 0, sizeof(mock_twi_stats));
+    mock_reg_accesses = 0;
+    in_isr = 0;
+    in_poll = 0;
+}
+
+
+void mock_twi_attach(uint8_t adr, uint8_t *mem, uint8_t size)
+{
+    for (uint8_t i = 0; i < MOCK_TWI_SLAVES; i++) {
+        if (slaves[i].size == 0xff) {
+            slaves[i].adr = adr;
+            slaves[i].mem = mem;
+            slaves[i].size = mem ? size : 0;
+            slaves[i].pos = 0;
+            return;
+        }
+    }
+}
+
+
+void mock_adc_set(uint8_t mux, uint16_t value)
+{
+    adc_values[mux & 0x0f] = value & 0x3ff;
+}
+
+
+void mock_uart_receive(uint8_t data)
+{
+    R(A_UDR0) = data;
+    R(A_UCSR0A) |= (1<<RXC0);
+    if ((R(A_UCSR0B) & (1<<RXCIE0)) && (R(A_SREG) & I_BIT))
+        run_isr(USART_RX_vect);
+    R(A_UCSR0A) &= ~(1<<RXC0);
+    mock_run();
+}
+
+
+void mock_log_clear(mock_log_t *log)
+{
+    log->len = 0;
+}
+
+
+// -- EEPROM functions of avr-libc -----------------------------------
+void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+    memcpy(dst, &mock_eeprom[(uintptr_t)src % MOCK_EEPROM_SIZE], n);
+}
+
+void eeprom_write_block(const void *src, void *dst, size_t n)
+{
+    memcpy(&mock_eeprom[(uintptr_t)dst % MOCK_EEPROM_SIZE], src, n);
+}
+
+void eeprom_update_block(const void *src, void *dst, size_t n)
+{
+    eeprom_write_block(src, dst, n);
+}
+
+uint8_t eeprom_read_byte(const uint8_t *p)
+{
+    return mock_eeprom[(uintptr_t)p % MOCK_EEPROM_SIZE];
+}
+
+void eeprom_write_byte(uint8_t *p, uint8_t value)
+{
+    mock_eeprom[(uintptr_t)p % MOCK_EEPROM_SIZE] = value;
+}
+
+void eeprom_update_byte(uint8_t *p, uint8_t value)
+{
+    eeprom_write_byte(p, value);
+}
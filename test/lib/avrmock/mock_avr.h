@@ -0,0 +1,132 @@
+#ifndef MOCK_AVR_H
+# define MOCK_AVR_H
+
+/*
+ * Peripheral models behind the register mock, for host tests.
+ * (c) 2024 MIT license
+ */
+
+/**
+ * @file
+ * @defgroup mock_avr AVR Register Mock <mock_avr.h>
+ * @code #include <mock_avr.h> @endcode
+ *
+ * @brief Scripted behavior of ATmega328P peripherals on the host.
+ *
+ * The mock <avr/io.h> maps every register to mock_reg8(). Before each
+ * access, the models look at the registers written so far:
+ *
+ * - TWI: a command written to TWCR (TWINT set) is executed at once
+ *   against the attached slaves, TWSR gets the status code of the
+ *   ATmega328P datasheet and TWINT is set again. Every byte the master
+ *   sends is logged. The reserved bit 1 of TWCR marks a command as
+ *   executed, so code under test must not set it.
+ * - USART: while UDRIE0 is set, USART_UDRE_vect runs and each byte it
+ *   writes to UDR0 is logged as sent. mock_uart_receive() passes a
+ *   byte to USART_RX_vect.
+ * - ADC: a conversion started by ADSC ends with the value set by
+ *   mock_adc_set() for the selected channel, then ADC_vect runs. One
+ *   conversion per access, free running mode starts the next one.
+ * - EEPROM: EEPE and EERE write and read mock_eeprom[]; EE_READY_vect
+ *   runs while EERIE is set.
+ *
+ * Interrupt service routines run only while the I bit of SREG is set,
+ * pending ones once it is set again, and never nest. Ports, timers and all other registers are plain
+ * memory. mock_reg_accesses counts register accesses, a cost measure
+ * independent of the speed of the host.
+ * @{
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdint.h>
+#include <avr/io.h>
+
+
+// -- Defines --------------------------------------------------------
+/** @brief  Slaves on the mock TWI bus */
+#define MOCK_TWI_SLAVES 4
+/** @brief  Size of logs of sent bytes */
+#define MOCK_LOG_SIZE 2048
+/** @brief  Bytes of mock EEPROM */
+#define MOCK_EEPROM_SIZE (E2END + 1)
+
+
+// -- Types ----------------------------------------------------------
+/**
+ * @brief  Bytes sent by the AVR, in order.
+ */
+typedef struct {
+    uint8_t data[MOCK_LOG_SIZE];
+    uint16_t len;             /**< @brief Bytes logged, also beyond size */
+} mock_log_t;
+
+/**
+ * @brief  Counters of the TWI bus.
+ */
+typedef struct {
+    uint16_t starts;          /**< @brief Start and repeated start */
+    uint16_t stops;
+    uint16_t nacks;           /**< @brief Address or data not acknowledged */
+    uint16_t reads;           /**< @brief Bytes read from slaves */
+} mock_twi_stats_t;
+
+
+// -- Global variables -----------------------------------------------
+extern mock_log_t mock_twi_log;    /**< @brief Address and data bytes */
+extern mock_log_t mock_uart_log;   /**< @brief Bytes sent by USART */
+extern mock_twi_stats_t mock_twi_stats;
+extern uint8_t mock_eeprom[MOCK_EEPROM_SIZE];
+extern uint32_t mock_reg_accesses;
+
+
+// -- Function prototypes --------------------------------------------
+/**
+ * @brief  Clear registers, logs, slaves, ADC values and EEPROM (0xff).
+ * @return none
+ * @note   UDRE0 is set, the transmitter is always ready.
+ */
+void mock_reset(void);
+
+/**
+ * @brief  Attach a TWI slave.
+ * @param  adr 7-bit address
+ * @param  mem Memory of the slave: the first byte written after the
+ *         address selects the location, reading continues from there.
+ *         0 for a slave that only takes data.
+ * @param  size Bytes of memory
+ * @return none
+ */
+void mock_twi_attach(uint8_t adr, uint8_t *mem, uint8_t size);
+
+/**
+ * @brief  Set result of conversions of one ADC channel.
+ * @param  mux MUX3:0 of ADMUX
+ * @param  value 10-bit result
+ * @return none
+ */
+void mock_adc_set(uint8_t mux, uint16_t value);
+
+/**
+ * @brief  Receive one byte by USART, runs USART_RX_vect.
+ * @param  data Byte
+ * @return none
+ */
+void mock_uart_receive(uint8_t data);
+
+/**
+ * @brief  Run the models and pending interrupts without an access.
+ * @return none
+ */
+void mock_run(void);
+
+/**
+ * @brief  Clear a log.
+ * @param  log Log
+ * @return none
+ */
+void mock_log_clear(mock_log_t *log);
+
+
+/** @} */
+
+#endif
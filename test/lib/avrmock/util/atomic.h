@@ -0,0 +1,26 @@
+#ifndef MOCK_UTIL_ATOMIC_H
+# define MOCK_UTIL_ATOMIC_H
+
+/*
+ * Mock of <util/atomic.h> for host tests: the block clears the I bit
+ * of SREG, so the peripheral models do not run interrupts inside it.
+ */
+
+#include <avr/io.h>
+
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_FORCEON      1
+#define NONATOMIC_RESTORESTATE 0
+#define NONATOMIC_FORCEOFF     1
+
+#define ATOMIC_BLOCK(type) \
+    for (uint8_t mock_sreg = SREG, mock_once = (SREG &= 0x7f, 1); \
+         mock_once; \
+         mock_once = 0, SREG = (type) ? (mock_sreg | 0x80) : mock_sreg)
+
+#define NONATOMIC_BLOCK(type) \
+    for (uint8_t mock_sreg = SREG, mock_once = (SREG |= 0x80, 1); \
+         mock_once; \
+         mock_once = 0, SREG = (type) ? (mock_sreg & 0x7f) : mock_sreg)
+
+#endif
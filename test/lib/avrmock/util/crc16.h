@@ -0,0 +1,18 @@
+#ifndef MOCK_UTIL_CRC16_H
+# define MOCK_UTIL_CRC16_H
+
+/*
+ * Mock of <util/crc16.h> for host tests, same results as avr-libc.
+ */
+
+#include <stdint.h>
+
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t data)
+{
+    crc ^= data;
+    for (uint8_t i = 0; i < 8; i++)
+        crc = (crc & 1) ? (crc >> 1) ^ 0xa001 : crc >> 1;
+    return crc;
+}
+
+#endif
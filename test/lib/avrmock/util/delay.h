@@ -0,0 +1,11 @@
+#ifndef MOCK_UTIL_DELAY_H
+# define MOCK_UTIL_DELAY_H
+
+/*
+ * Mock of <util/delay.h> for host tests, delays return at once.
+ */
+
+#define _delay_ms(ms) ((void)(ms))
+#define _delay_us(us) ((void)(us))
+
+#endif
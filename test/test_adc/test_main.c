@@ -0,0 +1,130 @@
+/*
+ * Host unit tests of the ADC library against the register mock.
+ * (c) 2024 MIT license
+ */
+
+// -- Includes -------------------------------------------------------
+#include <unity.h>
+#include <avr/interrupt.h>
+#include <mock_avr.h>
+#include "adc.h"
+
+
+// -- Global variables -----------------------------------------------
+static const uint8_t channels[] = {0, 3, ADC_MUX_BANDGAP};
+
+
+// -- Function definitions -------------------------------------------
+void setUp(void)
+{
+    mock_reset();
+    mock_adc_set(0, 100);
+    mock_adc_set(3, 1023);
+    mock_adc_set(ADC_MUX_BANDGAP, 225);
+    adc_init();
+    adc_scan_init(channels, sizeof(channels));
+    sei();
+}
+
+
+void tearDown(void)
+{
+    adc_scan_stop();
+}
+
+
+/*
+ * Function: convert()
+ * Purpose:  Let the mock end n conversions.
+ */
+static void convert(uint8_t n)
+{
+    while (n--)
+        mock_run();
+}
+
+
+void test_init_enables_adc(void)
+{
+    TEST_ASSERT_EQUAL_HEX8(ADC_REF_AVCC, ADMUX & 0xc0);
+    TEST_ASSERT_TRUE(ADCSRA & (1<<ADEN));
+    TEST_ASSERT_TRUE(ADCSRA & (1<<ADIE));
+    TEST_ASSERT_EQUAL_HEX8(ADC_PRESCALER_128, ADCSRA & 0x07);
+}
+
+
+void test_scan_round_robin(void)
+{
+    adc_scan_start();
+    convert(2 * sizeof(channels));
+
+    TEST_ASSERT_EQUAL_UINT16(100, adc_latest(0));
+    TEST_ASSERT_EQUAL_UINT16(1023, adc_latest(1));
+    TEST_ASSERT_EQUAL_UINT16(225, adc_latest(2));
+    // Each access of a register ends a conversion, so only the order of
+    // channels is known
+    TEST_ASSERT_TRUE(adc_seq(0) >= 2);
+    TEST_ASSERT_TRUE(adc_seq(0) - adc_seq(2) <= 1);
+}
+
+
+void test_scan_history(void)
+{
+    uint8_t age = 1;
+
+    adc_scan_start();
+    convert(sizeof(channels));
+    mock_adc_set(0, 200);
+    convert(1);
+
+    adc_scan_stop();
+    TEST_ASSERT_EQUAL_UINT16(200, adc_history(0, 0));
+    while (age < ADC_RING_SIZE - 1 && adc_history(0, age) == 200)
+        age++;
+    TEST_ASSERT_EQUAL_UINT16(100, adc_history(0, age));
+}
+
+
+void test_oversampling_adds_bits(void)
+{
+    adc_set_oversampling(0, 1);     // 4 conversions, 11 bits
+    adc_scan_start();
+    convert(4 + 2);
+    TEST_ASSERT_EQUAL_UINT16(200, adc_latest(0));
+}
+
+
+void test_burst_left_adjusted(void)
+{
+    uint8_t buf[5] = {0};
+
+    adc_burst_start(3, ADC_REF_AVCC, buf, sizeof(buf));
+    TEST_ASSERT_TRUE(adc_burst_busy());
+    convert(sizeof(buf));
+    TEST_ASSERT_FALSE(adc_burst_busy());
+    TEST_ASSERT_EQUAL_HEX8(0xff, buf[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xff, buf[4]);
+    TEST_ASSERT_FALSE(ADCSRA & (1<<ADATE));
+}
+
+
+void test_no_conversion_while_interrupts_disabled(void)
+{
+    cli();
+    adc_scan_start();
+    convert(sizeof(channels));
+    TEST_ASSERT_EQUAL_UINT16(0, adc_seq(0));
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_init_enables_adc);
+    RUN_TEST(test_scan_round_robin);
+    RUN_TEST(test_scan_history);
+    RUN_TEST(test_oversampling_adds_bits);
+    RUN_TEST(test_burst_left_adjusted);
+    RUN_TEST(test_no_conversion_while_interrupts_disabled);
+    return UNITY_END();
+}
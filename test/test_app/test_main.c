@@ -0,0 +1,343 @@
+/*
+ * Host unit tests of application logic: classification of readings,
+ * sensor filters and Modbus request handling.
+ * (c) 2024 MIT license
+ */
+
+// -- Includes -------------------------------------------------------
+#include <string.h>
+#include <unity.h>
+#include <mock_avr.h>
+#include "classify.h"
+#include "filter.h"
+#include "modbus.h"
+
+
+// -- Defines --------------------------------------------------------
+#define SLAVE 17
+
+
+// -- Global variables -----------------------------------------------
+static const class_level_t levels[] = {
+    {0, 0},             // Dry
+    {300, 280},         // Moist
+    {600, 560},         // Wet
+};
+
+static uint16_t holding[4];
+
+static uint8_t read_input(uint16_t reg, uint16_t *value);
+static uint8_t read_holding(uint16_t reg, uint16_t *value);
+static uint8_t write_holding(uint16_t reg, uint16_t value);
+
+static const modbus_map_t map = {read_input, read_holding, write_holding};
+
+
+// -- Function definitions -------------------------------------------
+static uint8_t read_input(uint16_t reg, uint16_t *value)
+{
+    if (reg >= 32)
+        return MODBUS_ILLEGAL_ADDRESS;
+    *value = 0x1000 + reg;
+    return MODBUS_OK;
+}
+
+
+static uint8_t read_holding(uint16_t reg, uint16_t *value)
+{
+    if (reg >= 4)
+        return MODBUS_ILLEGAL_ADDRESS;
+    *value = holding[reg];
+    return MODBUS_OK;
+}
+
+
+static uint8_t write_holding(uint16_t reg, uint16_t value)
+{
+    if (reg >= 4)
+        return MODBUS_ILLEGAL_ADDRESS;
+    if (value > 1000)
+        return MODBUS_ILLEGAL_VALUE;
+    holding[reg] = value;
+    return MODBUS_OK;
+}
+
+
+/*
+ * Function: request()
+ * Purpose:  Append CRC to a request of len bytes.
+ * Returns:  Length including CRC
+ */
+static uint8_t request(uint8_t *frame, uint8_t len)
+{
+    uint16_t crc = modbus_crc(frame, len);
+
+    frame[len] = crc & 0xff;
+    frame[len + 1] = crc >> 8;
+    return len + 2;
+}
+
+
+void setUp(void)
+{
+    mock_reset();
+    for (uint8_t i = 0; i < 4; i++)
+        holding[i] = 0;
+}
+
+
+void tearDown(void)
+{
+}
+
+
+void test_classify_first_value_sets_state(void)
+{
+    classifier_t c;
+
+    class_init(&c, levels, 3, 0);
+    TEST_ASSERT_EQUAL_UINT8(1, class_update(&c, 700, 0));
+    TEST_ASSERT_EQUAL_UINT8(2, class_state(&c));
+}
+
+
+void test_classify_hysteresis(void)
+{
+    classifier_t c;
+
+    class_init(&c, levels, 3, 0);
+    class_update(&c, 100, 0);
+    TEST_ASSERT_EQUAL_UINT8(0, class_update(&c, 300, 1));  // Not above
+    TEST_ASSERT_EQUAL_UINT8(1, class_update(&c, 301, 2));
+    TEST_ASSERT_EQUAL_UINT8(1, class_state(&c));
+    TEST_ASSERT_EQUAL_UINT8(0, class_update(&c, 285, 3));  // Band
+    TEST_ASSERT_EQUAL_UINT8(1, class_update(&c, 279, 4));
+    TEST_ASSERT_EQUAL_UINT8(0, class_state(&c));
+    // Jumps over a state
+    TEST_ASSERT_EQUAL_UINT8(1, class_update(&c, 900, 5));
+    TEST_ASSERT_EQUAL_UINT8(2, class_state(&c));
+}
+
+
+void test_classify_min_dwell(void)
+{
+    classifier_t c;
+
+    class_init(&c, levels, 3, 100);
+    class_update(&c, 0, 1000);
+    TEST_ASSERT_EQUAL_UINT8(0, class_update(&c, 400, 1050));
+    TEST_ASSERT_EQUAL_UINT8(0, class_state(&c));
+    TEST_ASSERT_EQUAL_UINT8(1, class_update(&c, 400, 1100));
+    TEST_ASSERT_EQUAL_UINT8(1, class_state(&c));
+}
+
+
+void test_filter_median_rejects_spike(void)
+{
+    filter_t f;
+    const int16_t in[] = {10, 12, 500, 11, 13, -400, 12};
+    int16_t out = 0;
+
+    filter_init(&f, FILTER_MEDIAN, 5);
+    for (uint8_t i = 0; i < sizeof(in) / sizeof(in[0]); i++)
+        out = filter_update(&f, in[i]);
+    TEST_ASSERT_EQUAL_INT16(12, out);
+}
+
+
+void test_filter_moving_average(void)
+{
+    filter_t f;
+
+    filter_init(&f, FILTER_MOVING_AVERAGE, 4);
+    TEST_ASSERT_EQUAL_INT16(8, filter_update(&f, 8));   // Partial window
+    filter_update(&f, 16);
+    filter_update(&f, 24);
+    TEST_ASSERT_EQUAL_INT16(20, filter_update(&f, 32));
+    TEST_ASSERT_EQUAL_INT16(30, filter_update(&f, 48));
+}
+
+
+void test_filter_ema_converges(void)
+{
+    filter_t f;
+    int16_t out = 0;
+
+    filter_init(&f, FILTER_EMA, 2);
+    TEST_ASSERT_EQUAL_INT16(100, filter_update(&f, 100));
+    TEST_ASSERT_EQUAL_INT16(125, filter_update(&f, 200));
+    for (uint8_t i = 0; i < 40; i++)
+        out = filter_update(&f, 200);
+    TEST_ASSERT_EQUAL_INT16(200, out);
+}
+
+
+void test_modbus_crc_known_frame(void)
+{
+    const uint8_t frame[] = {0x01, 0x04, 0x00, 0x00, 0x00, 0x01};
+
+    TEST_ASSERT_EQUAL_HEX16(0xca31, modbus_crc(frame, sizeof(frame)));
+}
+
+
+void test_modbus_read_input(void)
+{
+    uint8_t frame[MODBUS_FRAME_MAX] = {SLAVE, MODBUS_READ_INPUT, 0, 2, 0, 2};
+    const uint8_t expected[] = {SLAVE, MODBUS_READ_INPUT, 4,
+                                0x10, 0x02, 0x10, 0x03};
+    uint8_t len = modbus_process(SLAVE, &map, frame, request(frame, 6));
+
+    TEST_ASSERT_EQUAL_UINT8(sizeof(expected) + 2, len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, frame, sizeof(expected));
+    TEST_ASSERT_EQUAL_HEX16(modbus_crc(frame, len - 2),
+                            frame[len - 2] | frame[len - 1] << 8);
+}
+
+
+void test_modbus_write_single_echoes(void)
+{
+    uint8_t frame[MODBUS_FRAME_MAX] = {SLAVE, MODBUS_WRITE_SINGLE,
+                                       0, 1, 0x01, 0xf4};
+    uint8_t len = modbus_process(SLAVE, &map, frame, request(frame, 6));
+
+    TEST_ASSERT_EQUAL_UINT8(8, len);
+    TEST_ASSERT_EQUAL_HEX8(0xf4, frame[5]);
+    TEST_ASSERT_EQUAL_UINT16(500, holding[1]);
+}
+
+
+void test_modbus_read_fills_frame(void)
+{
+    const uint8_t count = (MODBUS_FRAME_MAX - 5) / 2;
+    uint8_t frame[MODBUS_FRAME_MAX] = {SLAVE, MODBUS_READ_INPUT,
+                                       0, 0, 0, count};
+    uint8_t len = modbus_process(SLAVE, &map, frame, request(frame, 6));
+
+    // Largest read still fits the buffer with its CRC
+    TEST_ASSERT_EQUAL_UINT8(3 + 2*count + 2, len);
+    TEST_ASSERT_LESS_OR_EQUAL(MODBUS_FRAME_MAX, len);
+    TEST_ASSERT_EQUAL_UINT8(2*count, frame[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x10, frame[3 + 2*(count - 1)]);
+    TEST_ASSERT_EQUAL_HEX8(count - 1, frame[4 + 2*(count - 1)]);
+
+    // One more is refused
+    frame[1] = MODBUS_READ_INPUT;
+    frame[2] = 0;
+    frame[3] = 0;
+    frame[4] = 0;
+    frame[5] = count + 1;
+    TEST_ASSERT_EQUAL_UINT8(5, modbus_process(SLAVE, &map, frame,
+                                              request(frame, 6)));
+    TEST_ASSERT_EQUAL_HEX8(MODBUS_ILLEGAL_VALUE, frame[2]);
+}
+
+
+void test_modbus_write_multiple(void)
+{
+    uint8_t frame[MODBUS_FRAME_MAX] = {SLAVE, MODBUS_WRITE_MULTIPLE,
+                                       0, 1, 0, 2, 4, 0, 10, 0, 20};
+    const uint8_t expected[] = {SLAVE, MODBUS_WRITE_MULTIPLE, 0, 1, 0, 2};
+    const uint8_t bad[] = {SLAVE, MODBUS_WRITE_MULTIPLE, 0, 0, 0, 2, 4,
+                           0, 7, 0x10, 0};
+    uint8_t len = modbus_process(SLAVE, &map, frame, request(frame, 11));
+
+    TEST_ASSERT_EQUAL_UINT8(sizeof(expected) + 2, len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, frame, sizeof(expected));
+    TEST_ASSERT_EQUAL_UINT16(10, holding[1]);
+    TEST_ASSERT_EQUAL_UINT16(20, holding[2]);
+
+    // Byte count does not match register count
+    frame[1] = MODBUS_WRITE_MULTIPLE;
+    frame[6] = 6;
+    TEST_ASSERT_EQUAL_UINT8(5, modbus_process(SLAVE, &map, frame,
+                                              request(frame, 11)));
+    TEST_ASSERT_EQUAL_HEX8(MODBUS_ILLEGAL_VALUE, frame[2]);
+
+    // Registers before the failing one stay written
+    memcpy(frame, bad, sizeof(bad));
+    TEST_ASSERT_EQUAL_UINT8(5, modbus_process(SLAVE, &map, frame,
+                                              request(frame, sizeof(bad))));
+    TEST_ASSERT_EQUAL_HEX8(MODBUS_ILLEGAL_VALUE, frame[2]);
+    TEST_ASSERT_EQUAL_UINT16(7, holding[0]);
+    TEST_ASSERT_EQUAL_UINT16(10, holding[1]);
+}
+
+
+void test_modbus_exceptions(void)
+{
+    uint8_t frame[MODBUS_FRAME_MAX] = {SLAVE, MODBUS_READ_HOLDING,
+                                       0, 3, 0, 2};
+
+    TEST_ASSERT_EQUAL_UINT8(5, modbus_process(SLAVE, &map, frame,
+                                              request(frame, 6)));
+    TEST_ASSERT_EQUAL_HEX8(0x80 | MODBUS_READ_HOLDING, frame[1]);
+    TEST_ASSERT_EQUAL_HEX8(MODBUS_ILLEGAL_ADDRESS, frame[2]);
+
+    frame[1] = MODBUS_WRITE_SINGLE;
+    frame[2] = 0;
+    frame[3] = 0;
+    frame[4] = 0x10;        // 4096 is out of range
+    frame[5] = 0x00;
+    TEST_ASSERT_EQUAL_UINT8(5, modbus_process(SLAVE, &map, frame,
+                                              request(frame, 6)));
+    TEST_ASSERT_EQUAL_HEX8(MODBUS_ILLEGAL_VALUE, frame[2]);
+
+    frame[1] = 0x2b;
+    TEST_ASSERT_EQUAL_UINT8(5, modbus_process(SLAVE, &map, frame,
+                                              request(frame, 2)));
+    TEST_ASSERT_EQUAL_HEX8(MODBUS_ILLEGAL_FUNCTION, frame[2]);
+}
+
+
+void test_modbus_silent_cases(void)
+{
+    uint8_t frame[MODBUS_FRAME_MAX] = {SLAVE + 1, MODBUS_READ_INPUT,
+                                       0, 0, 0, 1};
+
+    // Other slave
+    TEST_ASSERT_EQUAL_UINT8(0, modbus_process(SLAVE, &map, frame,
+                                              request(frame, 6)));
+    // Damaged frame
+    frame[0] = SLAVE;
+    request(frame, 6);
+    frame[3] ^= 0x01;
+    TEST_ASSERT_EQUAL_UINT8(0, modbus_process(SLAVE, &map, frame, 8));
+    // Broadcast write is done without response
+    frame[0] = MODBUS_BROADCAST;
+    frame[1] = MODBUS_WRITE_SINGLE;
+    frame[3] = 2;
+    frame[5] = 42;
+    TEST_ASSERT_EQUAL_UINT8(0, modbus_process(SLAVE, &map, frame,
+                                              request(frame, 6)));
+    TEST_ASSERT_EQUAL_UINT16(42, holding[2]);
+    // Broadcast read is ignored
+    frame[1] = MODBUS_READ_HOLDING;
+    TEST_ASSERT_EQUAL_UINT8(0, modbus_process(SLAVE, &map, frame,
+                                              request(frame, 6)));
+    // Too short and too long frames
+    frame[0] = SLAVE;
+    TEST_ASSERT_EQUAL_UINT8(0, modbus_process(SLAVE, &map, frame,
+                                              request(frame, 1)));
+    TEST_ASSERT_EQUAL_UINT8(0, modbus_process(SLAVE, &map, frame,
+                                              MODBUS_FRAME_MAX + 1));
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_classify_first_value_sets_state);
+    RUN_TEST(test_classify_hysteresis);
+    RUN_TEST(test_classify_min_dwell);
+    RUN_TEST(test_filter_median_rejects_spike);
+    RUN_TEST(test_filter_moving_average);
+    RUN_TEST(test_filter_ema_converges);
+    RUN_TEST(test_modbus_crc_known_frame);
+    RUN_TEST(test_modbus_read_input);
+    RUN_TEST(test_modbus_write_single_echoes);
+    RUN_TEST(test_modbus_read_fills_frame);
+    RUN_TEST(test_modbus_write_multiple);
+    RUN_TEST(test_modbus_exceptions);
+    RUN_TEST(test_modbus_silent_cases);
+    return UNITY_END();
+}
@@ -0,0 +1,174 @@
+/*
+ * Host unit tests of the settings store: slot selection, sequence
+ * numbers, damaged slots and layout versions.
+ * (c) 2024 MIT license
+ */
+
+// -- Includes -------------------------------------------------------
+#include <string.h>
+#include <unity.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <mock_avr.h>
+#include "config.h"
+#include "eeq.h"
+
+
+// -- Defines --------------------------------------------------------
+#define VERSION 3
+#define SLOT(s) (&mock_eeprom[CONFIG_START + (s) * CONFIG_SLOT_SIZE])
+
+
+// -- Types ----------------------------------------------------------
+typedef struct {
+    uint16_t light;
+    uint8_t contrast;
+    uint32_t baud;
+} settings_t;
+
+
+// -- Global variables -----------------------------------------------
+static const settings_t defaults PROGMEM = {500, 0x3f, 38400};
+static settings_t settings;
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: save()
+ * Purpose:  Write settings as the application does, a few bytes per
+ *           call of config_update().
+ */
+static void save(void)
+{
+    config_save();
+    while (config_update())
+        mock_run();
+    eeq_flush();
+}
+
+
+void setUp(void)
+{
+    mock_reset();
+    sei();
+}
+
+
+void tearDown(void)
+{
+}
+
+
+void test_erased_eeprom_gives_defaults(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_DEFAULTS,
+                            config_load(&settings, sizeof(settings),
+                                        VERSION, &defaults));
+    TEST_ASSERT_EQUAL_UINT16(500, settings.light);
+    TEST_ASSERT_EQUAL_UINT32(38400, settings.baud);
+}
+
+
+void test_saves_alternate_between_slots(void)
+{
+    config_load(&settings, sizeof(settings), VERSION, &defaults);
+    settings.light = 600;
+    save();
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_SLOT_A,
+                            config_load(&settings, sizeof(settings),
+                                        VERSION, &defaults));
+    TEST_ASSERT_EQUAL_UINT16(600, settings.light);
+
+    settings.light = 700;
+    save();
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_SLOT_B,
+                            config_load(&settings, sizeof(settings),
+                                        VERSION, &defaults));
+    TEST_ASSERT_EQUAL_UINT16(700, settings.light);
+    // Older copy stays in slot A
+    TEST_ASSERT_EQUAL_HEX8(600 & 0xff, SLOT(CONFIG_SLOT_A)[2]);
+}
+
+
+void test_damaged_slot_falls_back(void)
+{
+    config_load(&settings, sizeof(settings), VERSION, &defaults);
+    settings.light = 600;
+    save();
+    settings.light = 700;
+    save();
+
+    // Reset during the write of slot B: its CRC does not match
+    SLOT(CONFIG_SLOT_B)[3] ^= 0x01;
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_SLOT_A,
+                            config_load(&settings, sizeof(settings),
+                                        VERSION, &defaults));
+    TEST_ASSERT_EQUAL_UINT16(600, settings.light);
+
+    // Next save overwrites the damaged slot, not the good one
+    settings.light = 800;
+    save();
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_SLOT_B,
+                            config_load(&settings, sizeof(settings),
+                                        VERSION, &defaults));
+    TEST_ASSERT_EQUAL_UINT16(800, settings.light);
+}
+
+
+void test_sequence_number_wraps(void)
+{
+    config_load(&settings, sizeof(settings), VERSION, &defaults);
+    // Past 255 the newer slot has the smaller sequence number
+    for (uint16_t i = 0; i < 300; i++) {
+        settings.light = i;
+        save();
+        config_load(&settings, sizeof(settings), VERSION, &defaults);
+        TEST_ASSERT_EQUAL_UINT16(i, settings.light);
+    }
+    TEST_ASSERT_EQUAL_HEX8(300 & 0xff, SLOT(CONFIG_SLOT_B)[1]);
+    TEST_ASSERT_EQUAL_HEX8(299 & 0xff, SLOT(CONFIG_SLOT_A)[1]);
+}
+
+
+void test_other_version_gives_defaults(void)
+{
+    config_load(&settings, sizeof(settings), VERSION, &defaults);
+    settings.light = 600;
+    save();
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_DEFAULTS,
+                            config_load(&settings, sizeof(settings),
+                                        VERSION + 1, &defaults));
+    TEST_ASSERT_EQUAL_UINT16(500, settings.light);
+}
+
+
+void test_restarted_save_keeps_newest_slot(void)
+{
+    config_load(&settings, sizeof(settings), VERSION, &defaults);
+    settings.light = 600;
+    save();
+
+    // Value changes again before the started write is queued
+    settings.light = 700;
+    config_save();
+    settings.light = 800;
+    save();
+    TEST_ASSERT_EQUAL_UINT8(CONFIG_SLOT_B,
+                            config_load(&settings, sizeof(settings),
+                                        VERSION, &defaults));
+    TEST_ASSERT_EQUAL_UINT16(800, settings.light);
+    TEST_ASSERT_EQUAL_HEX8(600 & 0xff, SLOT(CONFIG_SLOT_A)[2]);
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_erased_eeprom_gives_defaults);
+    RUN_TEST(test_saves_alternate_between_slots);
+    RUN_TEST(test_damaged_slot_falls_back);
+    RUN_TEST(test_sequence_number_wraps);
+    RUN_TEST(test_other_version_gives_defaults);
+    RUN_TEST(test_restarted_save_keeps_newest_slot);
+    return UNITY_END();
+}
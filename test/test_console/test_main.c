@@ -0,0 +1,185 @@
+/*
+ * Host unit tests of the console: tokenizer, command lookup, replies
+ * and number conversion.
+ * (c) 2024 MIT license
+ */
+
+// -- Includes -------------------------------------------------------
+#include <string.h>
+#include <unity.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <mock_avr.h>
+#include "console.h"
+#include "uart.h"
+
+
+// -- Global variables -----------------------------------------------
+static uint8_t got_argc;
+static char got_argv[CONSOLE_MAX_ARGS][CONSOLE_LINE_MAX + 1];
+static uint8_t result;
+
+static uint8_t cmd_set(uint8_t argc, char *argv[]);
+
+static const console_cmd_t commands[] PROGMEM = {
+    {"set", cmd_set},
+    {"get", cmd_set},
+};
+
+
+// -- Function definitions -------------------------------------------
+static uint8_t cmd_set(uint8_t argc, char *argv[])
+{
+    got_argc = argc;
+    for (uint8_t i = 0; i < argc; i++)
+        strcpy(got_argv[i], argv[i]);
+    return result;
+}
+
+
+/*
+ * Function: line()
+ * Purpose:  Pass characters to the console as the receive hook would,
+ *           run the command and send the reply.
+ * Returns:  Result of console_poll()
+ */
+static uint8_t line(const char *s)
+{
+    uint8_t handled;
+
+    while (*s)
+        console_rx(*s++);
+    handled = console_poll();
+    mock_run();
+    return handled;
+}
+
+
+/*
+ * Function: reply_is()
+ * Purpose:  Compare sent bytes with a string, then clear the log.
+ */
+static void reply_is(const char *s)
+{
+    TEST_ASSERT_EQUAL_UINT16(strlen(s), mock_uart_log.len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(s, mock_uart_log.data, strlen(s));
+    mock_log_clear(&mock_uart_log);
+}
+
+
+void setUp(void)
+{
+    mock_reset();
+    uart_init(UART_BAUD_SELECT_AUTO(38400, F_CPU));
+    console_init(commands, sizeof(commands) / sizeof(commands[0]));
+    sei();
+    got_argc = 0;
+    result = CONSOLE_OK;
+}
+
+
+void tearDown(void)
+{
+}
+
+
+void test_tokens_split_at_blanks(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(1, line("  set\t light   400 \r\n"));
+    TEST_ASSERT_EQUAL_UINT8(3, got_argc);
+    TEST_ASSERT_EQUAL_STRING("set", got_argv[0]);
+    TEST_ASSERT_EQUAL_STRING("light", got_argv[1]);
+    TEST_ASSERT_EQUAL_STRING("400", got_argv[2]);
+    reply_is("OK\r\n");
+}
+
+
+void test_empty_lines_are_ignored(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(0, line("\r\n"));
+    TEST_ASSERT_EQUAL_UINT8(0, line("   \n"));
+    TEST_ASSERT_EQUAL_UINT16(0, mock_uart_log.len);
+    // LF of CR LF does not end the next line early
+    TEST_ASSERT_EQUAL_UINT8(1, line("get\r"));
+    TEST_ASSERT_EQUAL_UINT8(0, line("\n"));
+    TEST_ASSERT_EQUAL_UINT8(1, got_argc);
+}
+
+
+void test_unknown_and_results(void)
+{
+    line("foo 1\n");
+    reply_is("ERR unknown\r\n");
+    result = CONSOLE_USAGE;
+    line("set\n");
+    reply_is("ERR usage\r\n");
+    result = CONSOLE_RANGE;
+    line("set x 9999\n");
+    reply_is("ERR range\r\n");
+    result = CONSOLE_QUIET;
+    line("set\n");
+    reply_is("");
+    line("help\n");
+    reply_is("set get\r\n");
+}
+
+
+void test_overlong_line_is_rejected(void)
+{
+    char s[CONSOLE_LINE_MAX + 8];
+
+    memset(s, 'a', sizeof(s) - 2);
+    s[sizeof(s) - 2] = '\n';
+    s[sizeof(s) - 1] = '\0';
+    line(s);
+    reply_is("ERR too long\r\n");
+    TEST_ASSERT_EQUAL_UINT8(0, got_argc);
+
+    // More tokens than CONSOLE_MAX_ARGS
+    line("set 1 2 3 4 5\n");
+    reply_is("ERR too long\r\n");
+
+    // Next line is accepted again
+    line("set 1 2 3\n");
+    TEST_ASSERT_EQUAL_UINT8(CONSOLE_MAX_ARGS, got_argc);
+    reply_is("OK\r\n");
+}
+
+
+void test_line_waits_for_poll(void)
+{
+    const char *s = "set a\nget b\n";
+
+    // Bytes after a completed line are dropped until it is handled
+    while (*s)
+        console_rx(*s++);
+    TEST_ASSERT_EQUAL_UINT8(1, console_poll());
+    TEST_ASSERT_EQUAL_STRING("a", got_argv[1]);
+    TEST_ASSERT_EQUAL_UINT8(0, console_poll());
+}
+
+
+void test_number(void)
+{
+    int32_t value;
+
+    TEST_ASSERT_EQUAL_UINT8(1, console_number("-120", &value));
+    TEST_ASSERT_EQUAL_INT32(-120, value);
+    TEST_ASSERT_EQUAL_UINT8(1, console_number("115200", &value));
+    TEST_ASSERT_EQUAL_INT32(115200, value);
+    TEST_ASSERT_EQUAL_UINT8(0, console_number("12a", &value));
+    TEST_ASSERT_EQUAL_UINT8(0, console_number("", &value));
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_tokens_split_at_blanks);
+    RUN_TEST(test_empty_lines_are_ignored);
+    RUN_TEST(test_unknown_and_results);
+    RUN_TEST(test_overlong_line_is_rejected);
+    RUN_TEST(test_line_waits_for_poll);
+    RUN_TEST(test_number);
+    return UNITY_END();
+}
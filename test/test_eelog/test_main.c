@@ -0,0 +1,168 @@
+/*
+ * Host unit tests of the EEPROM data logger: delta encoding and
+ * decoding, block change, ring wrap and boot counter.
+ * (c) 2024 MIT license
+ */
+
+// -- Includes -------------------------------------------------------
+#include <string.h>
+#include <unity.h>
+#include <avr/interrupt.h>
+#include <mock_avr.h>
+#include "eelog.h"
+#include "eeq.h"
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: sample()
+ * Purpose:  Values of sample n: small and large, positive and negative
+ *           steps, so both nibbles and varints are used.
+ */
+static void sample(uint16_t n, int16_t *value)
+{
+    value[0] = n;
+    value[1] = -(int16_t)(n * 3);
+    value[2] = (n & 1) ? 20000 : -20000;
+    value[3] = (n % 7) * 100 - 300;
+}
+
+
+/*
+ * Function: append()
+ * Purpose:  Log samples first to first + count - 1, each written before
+ *           the next, as with the slow logging period of the firmware.
+ */
+static void append(uint16_t first, uint16_t count)
+{
+    int16_t value[EELOG_CHANNELS];
+
+    for (uint16_t n = first; n < first + count; n++) {
+        sample(n, value);
+        TEST_ASSERT_EQUAL_UINT8(0, eelog_append(value));
+        eeq_flush();
+    }
+}
+
+
+void setUp(void)
+{
+    mock_reset();
+    sei();
+    eelog_init();
+}
+
+
+void tearDown(void)
+{
+}
+
+
+void test_empty_log(void)
+{
+    eelog_iter_t it;
+    eelog_sample_t s;
+
+    eelog_rewind(&it);
+    TEST_ASSERT_EQUAL_UINT8(0, eelog_next(&it, &s));
+}
+
+
+void test_samples_read_back(void)
+{
+    eelog_iter_t it;
+    eelog_sample_t s;
+    int16_t value[EELOG_CHANNELS];
+    uint16_t n = 0;
+
+    // More than one block
+    append(0, 40);
+    eelog_rewind(&it);
+    while (eelog_next(&it, &s)) {
+        sample(n, value);
+        TEST_ASSERT_EQUAL_UINT16(n, s.index);
+        TEST_ASSERT_EQUAL_UINT8(0, s.boot);
+        for (uint8_t i = 0; i < EELOG_CHANNELS; i++)
+            TEST_ASSERT_EQUAL_INT16(value[i], s.value[i]);
+        n++;
+    }
+    TEST_ASSERT_EQUAL_UINT16(40, n);
+    TEST_ASSERT_EQUAL_UINT16(0, eelog_dropped());
+}
+
+
+void test_ring_keeps_newest_samples(void)
+{
+    eelog_iter_t it;
+    eelog_sample_t s;
+    int16_t value[EELOG_CHANNELS];
+    uint16_t first = 0xffff;
+    uint16_t n = 0;
+
+    // Several times around the ring
+    append(0, 1000);
+    eelog_rewind(&it);
+    while (eelog_next(&it, &s)) {
+        if (first == 0xffff)
+            first = s.index;
+        // Consecutive, without gaps
+        TEST_ASSERT_EQUAL_UINT16(first + n, s.index);
+        sample(s.index, value);
+        for (uint8_t i = 0; i < EELOG_CHANNELS; i++)
+            TEST_ASSERT_EQUAL_INT16(value[i], s.value[i]);
+        n++;
+    }
+    TEST_ASSERT_EQUAL_UINT16(1000, first + n);
+    // Oldest samples are overwritten
+    TEST_ASSERT_TRUE(first > 0);
+    TEST_ASSERT_TRUE(n > 0);
+}
+
+
+void test_boot_counter_and_new_block(void)
+{
+    eelog_iter_t it;
+    eelog_sample_t s;
+    uint8_t boots[2] = {0, 0};
+
+    append(0, 5);
+    // Reset: next boot starts a new block with its own keyframe
+    eelog_init();
+    append(100, 3);
+
+    eelog_rewind(&it);
+    while (eelog_next(&it, &s)) {
+        TEST_ASSERT_TRUE(s.boot < 2);
+        boots[s.boot]++;
+        if (s.boot == 1)
+            TEST_ASSERT_EQUAL_INT16(100 + s.index, s.value[0]);
+    }
+    TEST_ASSERT_EQUAL_UINT8(5, boots[0]);
+    TEST_ASSERT_EQUAL_UINT8(3, boots[1]);
+}
+
+
+void test_full_queue_drops_sample(void)
+{
+    int16_t value[EELOG_CHANNELS] = {0};
+
+    // Without interrupts the queue is not drained
+    cli();
+    while (eelog_append(value) == 0)
+        ;
+    TEST_ASSERT_EQUAL_UINT16(1, eelog_dropped());
+    sei();
+    eeq_flush();
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_log);
+    RUN_TEST(test_samples_read_back);
+    RUN_TEST(test_ring_keeps_newest_samples);
+    RUN_TEST(test_boot_counter_and_new_block);
+    RUN_TEST(test_full_queue_drops_sample);
+    return UNITY_END();
+}
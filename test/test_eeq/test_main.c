@@ -0,0 +1,99 @@
+/*
+ * Host unit tests of the EEPROM write queue against the register mock.
+ * (c) 2024 MIT license
+ */
+
+// -- Includes -------------------------------------------------------
+#include <string.h>
+#include <unity.h>
+#include <avr/interrupt.h>
+#include <mock_avr.h>
+#include "eeq.h"
+
+
+// -- Function definitions -------------------------------------------
+void setUp(void)
+{
+    mock_reset();
+    sei();
+}
+
+
+void tearDown(void)
+{
+}
+
+
+void test_write_is_done_by_interrupt(void)
+{
+    const uint8_t data[] = {1, 2, 3, 0xff, 5};
+
+    TEST_ASSERT_EQUAL_UINT8(0, eeq_write(100, data, sizeof(data)));
+    eeq_flush();
+    TEST_ASSERT_FALSE(eeq_busy());
+    TEST_ASSERT_EQUAL_UINT8(EEQ_SIZE, eeq_free());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, &mock_eeprom[100], sizeof(data));
+    TEST_ASSERT_EQUAL_HEX8(0xff, mock_eeprom[99]);
+    TEST_ASSERT_EQUAL_HEX8(0xff, mock_eeprom[105]);
+}
+
+
+void test_full_queue_takes_nothing(void)
+{
+    uint8_t data[EEQ_SIZE + 1];
+
+    memset(data, 0x5a, sizeof(data));
+    // Without interrupts nothing is written
+    cli();
+    TEST_ASSERT_EQUAL_UINT8(1, eeq_write(0, data, EEQ_SIZE + 1));
+    TEST_ASSERT_EQUAL_UINT8(EEQ_SIZE, eeq_free());
+    TEST_ASSERT_EQUAL_UINT8(0, eeq_write(0, data, EEQ_SIZE - 1));
+    TEST_ASSERT_EQUAL_UINT8(1, eeq_free());
+    TEST_ASSERT_EQUAL_UINT8(1, eeq_write(0, data, 2));
+    TEST_ASSERT_EQUAL_UINT8(0, eeq_write(EEQ_SIZE - 1, data, 1));
+    TEST_ASSERT_EQUAL_UINT8(0, eeq_free());
+    TEST_ASSERT_EQUAL_HEX8(0xff, mock_eeprom[0]);
+
+    sei();
+    eeq_flush();
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, mock_eeprom, EEQ_SIZE);
+}
+
+
+void test_queue_wraps_around(void)
+{
+    uint8_t data[EEQ_SIZE / 2 + 3];
+
+    // Several times the queue size, writes cross the end of the buffer
+    for (uint8_t n = 0; n < 8; n++) {
+        memset(data, n, sizeof(data));
+        TEST_ASSERT_EQUAL_UINT8(0, eeq_write(n * sizeof(data), data,
+                                             sizeof(data)));
+    }
+    eeq_flush();
+    for (uint16_t i = 0; i < 8 * sizeof(data); i++)
+        TEST_ASSERT_EQUAL_HEX8(i / sizeof(data), mock_eeprom[i]);
+}
+
+
+void test_read_after_flush(void)
+{
+    const uint8_t data[] = {0x12, 0x34, 0x56};
+    uint8_t buf[3];
+
+    eeq_write(1000, data, sizeof(data));
+    eeq_flush();
+    eeq_read(1000, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, buf, sizeof(data));
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_write_is_done_by_interrupt);
+    RUN_TEST(test_full_queue_takes_nothing);
+    RUN_TEST(test_queue_wraps_around);
+    RUN_TEST(test_read_after_flush);
+    return UNITY_END();
+}
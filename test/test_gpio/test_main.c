@@ -0,0 +1,74 @@
+/*
+ * Host unit tests of the GPIO library against the register mock.
+ * (c) 2024 MIT license
+ */
+
+// -- Includes -------------------------------------------------------
+#include <unity.h>
+#include <mock_avr.h>
+#include "gpio.h"
+
+
+// -- Function definitions -------------------------------------------
+void setUp(void)
+{
+    mock_reset();
+}
+
+
+void tearDown(void)
+{
+}
+
+
+void test_output_and_write(void)
+{
+    GPIO_mode_output(&DDRB, PB5);
+    TEST_ASSERT_EQUAL_HEX8(1<<PB5, DDRB);
+
+    GPIO_write_high(&PORTB, PB5);
+    GPIO_write_high(&PORTB, PB0);
+    TEST_ASSERT_EQUAL_HEX8((1<<PB5) | (1<<PB0), PORTB);
+    GPIO_write_low(&PORTB, PB5);
+    TEST_ASSERT_EQUAL_HEX8(1<<PB0, PORTB);
+}
+
+
+void test_toggle(void)
+{
+    GPIO_toggle(&PORTD, PD3);
+    TEST_ASSERT_EQUAL_HEX8(1<<PD3, PORTD);
+    GPIO_toggle(&PORTD, PD3);
+    TEST_ASSERT_EQUAL_HEX8(0, PORTD);
+}
+
+
+void test_input_modes_change_port_after_ddr(void)
+{
+    DDRC = 0xff;
+    GPIO_mode_input_pullup(&DDRC, PC2);
+    TEST_ASSERT_EQUAL_HEX8(0xff & ~(1<<PC2), DDRC);
+    TEST_ASSERT_EQUAL_HEX8(1<<PC2, PORTC);
+
+    GPIO_mode_input_nopull(&DDRC, PC2);
+    TEST_ASSERT_EQUAL_HEX8(0, PORTC);
+}
+
+
+void test_read(void)
+{
+    PIND = (1<<PD2);
+    TEST_ASSERT_EQUAL_UINT8(1, GPIO_read(&PIND, PD2));
+    TEST_ASSERT_EQUAL_UINT8(0, GPIO_read(&PIND, PD7));
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_output_and_write);
+    RUN_TEST(test_toggle);
+    RUN_TEST(test_input_modes_change_port_after_ddr);
+    RUN_TEST(test_read);
+    return UNITY_END();
+}
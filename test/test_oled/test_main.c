@@ -0,0 +1,136 @@
+/*
+ * Host unit tests and micro-benchmarks of the OLED library against the
+ * register mock.
+ * (c) 2024 MIT license
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdio.h>
+#include <unity.h>
+#include <mock_avr.h>
+#include "oled.h"
+
+
+// -- Defines --------------------------------------------------------
+#define PAGES (DISPLAY_HEIGHT/8)
+#define GOTO_BYTES 7            // Address, control byte, 5 commands
+#define PAGE_BYTES (2 + DISPLAY_WIDTH)
+
+
+// -- Function definitions -------------------------------------------
+void setUp(void)
+{
+    mock_reset();
+    mock_twi_attach(OLED_I2C_ADR, 0, 0);
+    oled_init(OLED_DISP_ON);
+    mock_run();
+    mock_log_clear(&mock_twi_log);
+    mock_twi_stats.starts = 0;
+    mock_twi_stats.stops = 0;
+}
+
+
+void tearDown(void)
+{
+}
+
+
+void test_init_sends_commands(void)
+{
+    mock_reset();
+    mock_twi_attach(OLED_I2C_ADR, 0, 0);
+    oled_init(OLED_DISP_ON);
+    mock_run();
+
+    TEST_ASSERT_EQUAL_HEX8(OLED_I2C_ADR<<1, mock_twi_log.data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, mock_twi_log.data[1]);  // Commands follow
+    TEST_ASSERT_EQUAL_HEX8(OLED_DISP_OFF, mock_twi_log.data[2]);
+    TEST_ASSERT_EQUAL_UINT16(0, mock_twi_stats.nacks);
+    // Init sequence, every page cleared, cursor home
+    TEST_ASSERT_EQUAL_UINT16(1 + 2*PAGES + 1, mock_twi_stats.starts);
+    TEST_ASSERT_EQUAL_UINT16(mock_twi_stats.starts, mock_twi_stats.stops);
+}
+
+
+void test_display_sends_all_pages(void)
+{
+    oled_display();
+    mock_run();
+
+    TEST_ASSERT_EQUAL_UINT16(2*PAGES, mock_twi_stats.starts);
+    TEST_ASSERT_EQUAL_UINT16(PAGES * (GOTO_BYTES + PAGE_BYTES),
+                             mock_twi_log.len);
+    // Data of the first page follows the control byte 0x40
+    TEST_ASSERT_EQUAL_HEX8(0x40, mock_twi_log.data[GOTO_BYTES + 1]);
+}
+
+
+void test_putc_draws_into_buffer_only(void)
+{
+    uint8_t pixels = 0;
+
+    oled_gotoxy(1, 0);
+    mock_log_clear(&mock_twi_log);
+    oled_putc('A');
+    for (uint8_t x = 0; x < 6; x++)
+        for (uint8_t y = 0; y < 8; y++)
+            pixels += oled_check_buffer(6 + x, y) != 0;
+
+    TEST_ASSERT_GREATER_THAN(5, pixels);
+    TEST_ASSERT_EQUAL_UINT8(0, oled_check_buffer(0, 0));
+    TEST_ASSERT_EQUAL_UINT16(0, mock_twi_log.len);
+}
+
+
+void test_display_block_sends_part_of_line(void)
+{
+    oled_display_block(120, 2, 20);     // Cut at the right edge
+    mock_run();
+    TEST_ASSERT_EQUAL_UINT16(GOTO_BYTES + 2 + 8, mock_twi_log.len);
+    TEST_ASSERT_EQUAL_HEX8(0xb2, mock_twi_log.data[2]);
+}
+
+
+/*
+ * Function: test_bench_register_accesses()
+ * Purpose:  Count register accesses of display functions, a measure of
+ *           their cost that does not depend on the host. Fails if the
+ *           cost of one byte sent to the display grows.
+ */
+void test_bench_register_accesses(void)
+{
+    char msg[80];
+    uint32_t display, putc;
+
+    mock_reg_accesses = 0;
+    oled_display();
+    mock_run();
+    display = mock_reg_accesses;
+
+    oled_gotoxy(0, 0);
+    mock_reg_accesses = 0;
+    for (uint8_t i = 0; i < 20; i++)
+        oled_putc('0' + i % 10);
+    putc = mock_reg_accesses;
+
+    snprintf(msg, sizeof(msg),
+             "oled_display %lu accesses (%lu per byte), oled_putc %lu",
+             (unsigned long)display,
+             (unsigned long)(display / mock_twi_log.len),
+             (unsigned long)(putc / 20));
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_OR_EQUAL(5UL * mock_twi_log.len, display);
+    TEST_ASSERT_EQUAL_UINT32(0, putc);
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_init_sends_commands);
+    RUN_TEST(test_display_sends_all_pages);
+    RUN_TEST(test_putc_draws_into_buffer_only);
+    RUN_TEST(test_display_block_sends_part_of_line);
+    RUN_TEST(test_bench_register_accesses);
+    return UNITY_END();
+}
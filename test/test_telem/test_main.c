@@ -0,0 +1,189 @@
+/*
+ * Host unit tests of the telemetry frames: COBS framing, record layout,
+ * CRC and sequence numbers of dropped records.
+ * (c) 2024 MIT license
+ */
+
+// -- Includes -------------------------------------------------------
+#include <unity.h>
+#include <avr/interrupt.h>
+#include <mock_avr.h>
+#include "telem.h"
+#include "uart.h"
+
+
+// -- Defines --------------------------------------------------------
+#define RECORD_MAX (TELEM_HEADER + 2*TELEM_MAX_CHANNELS + 2)
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: crc16()
+ * Purpose:  CRC-16/MODBUS bit by bit, independent of util/crc16.h.
+ * Returns:  CRC
+ */
+static uint16_t crc16(const uint8_t *data, uint8_t len)
+{
+    uint16_t crc = 0xffff;
+
+    while (len--) {
+        crc ^= *data++;
+        for (uint8_t i = 0; i < 8; i++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xa001 : crc >> 1;
+    }
+    return crc;
+}
+
+
+/*
+ * Function: decode()
+ * Purpose:  Undo COBS of one frame in the UART log, from the delimiter
+ *           at pos to the next one.
+ * Input(s): pos - Pointer to position of opening delimiter, moved to
+ *                 the closing one
+ *           rec - Buffer of RECORD_MAX bytes
+ * Returns:  Length of record with CRC, 0 if the frame is malformed
+ */
+static uint8_t decode(uint16_t *pos, uint8_t *rec)
+{
+    const uint8_t *log = mock_uart_log.data;
+    uint16_t i = *pos;
+    uint8_t len = 0;
+    uint8_t code;
+
+    if (i >= mock_uart_log.len || log[i++] != 0)
+        return 0;
+    while (i < mock_uart_log.len && log[i] != 0) {
+        code = log[i++];
+        for (uint8_t n = 1; n < code; n++) {
+            if (i >= mock_uart_log.len || log[i] == 0 || len == RECORD_MAX)
+                return 0;
+            rec[len++] = log[i++];
+        }
+        // Block shorter than 254 bytes stands for a zero, except the last
+        if (code < 0xff && log[i] != 0 && len < RECORD_MAX)
+            rec[len++] = 0;
+    }
+    if (i >= mock_uart_log.len)
+        return 0;
+    *pos = i;
+    return len;
+}
+
+
+void setUp(void)
+{
+    mock_reset();
+    uart_init(UART_BAUD_SELECT_AUTO(38400, F_CPU));
+    sei();
+}
+
+
+void tearDown(void)
+{
+}
+
+
+void test_record_layout_and_crc(void)
+{
+    const int16_t values[] = {0x0102, -2, 0x7f00, 300};
+    uint8_t rec[RECORD_MAX];
+    uint16_t pos = 0;
+    uint8_t len;
+
+    TEST_ASSERT_EQUAL_UINT8(1, telem_send(TELEM_TYPE_VALUES, 0x00123456,
+                                          values, 4));
+    mock_run();
+    TEST_ASSERT_TRUE(mock_uart_log.len <= TELEM_FRAME_MAX(4));
+
+    len = decode(&pos, rec);
+    TEST_ASSERT_EQUAL_UINT8(TELEM_HEADER + 2*4 + 2, len);
+    TEST_ASSERT_EQUAL_UINT16(mock_uart_log.len - 1, pos);
+
+    TEST_ASSERT_EQUAL_UINT8(TELEM_TYPE_VALUES, rec[0]);
+    TEST_ASSERT_EQUAL_UINT32(0x00123456, rec[3] | rec[4] << 8 |
+                             (uint32_t)rec[5] << 16 | (uint32_t)rec[6] << 24);
+    TEST_ASSERT_EQUAL_UINT8(4, rec[7]);
+    for (uint8_t i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL_INT16(values[i],
+                                (int16_t)(rec[8 + 2*i] | rec[9 + 2*i] << 8));
+    TEST_ASSERT_EQUAL_HEX16(crc16(rec, len - 2),
+                            rec[len - 2] | rec[len - 1] << 8);
+}
+
+
+void test_zero_bytes_only_as_delimiters(void)
+{
+    const int16_t values[] = {0, 0, 0x0100, 0x0001};
+    uint8_t rec[RECORD_MAX];
+    uint16_t pos = 0;
+
+    telem_send(TELEM_TYPE_VALUES, 0, values, 4);
+    mock_run();
+
+    TEST_ASSERT_EQUAL_HEX8(0, mock_uart_log.data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0, mock_uart_log.data[mock_uart_log.len - 1]);
+    for (uint16_t i = 1; i < mock_uart_log.len - 1; i++)
+        TEST_ASSERT_TRUE(mock_uart_log.data[i] != 0);
+
+    TEST_ASSERT_EQUAL_UINT8(TELEM_HEADER + 2*4 + 2, decode(&pos, rec));
+    TEST_ASSERT_EQUAL_HEX8(0x00, rec[12]);
+    TEST_ASSERT_EQUAL_HEX8(0x01, rec[13]);
+    TEST_ASSERT_EQUAL_HEX8(0x01, rec[14]);
+    TEST_ASSERT_EQUAL_HEX8(0x00, rec[15]);
+}
+
+
+void test_dropped_record_leaves_sequence_gap(void)
+{
+    const int16_t values[] = {1, 2, 3, 4};
+    uint8_t rec[RECORD_MAX];
+    uint16_t seq = 0;
+    uint16_t pos = 0;
+    uint8_t sent = 0;
+
+    // Nothing drains the buffer without interrupts, until one is dropped
+    cli();
+    while (telem_send(TELEM_TYPE_VALUES, 0, values, 4))
+        sent++;
+    sei();
+    mock_run();
+    telem_send(TELEM_TYPE_VALUES, 0, values, 4);
+    mock_run();
+
+    TEST_ASSERT_TRUE(sent > 0);
+    for (uint8_t i = 0; i <= sent; i++) {
+        TEST_ASSERT_EQUAL_UINT8(TELEM_HEADER + 2*4 + 2, decode(&pos, rec));
+        if (i > 0)
+            TEST_ASSERT_EQUAL_UINT16(seq + (i == sent ? 2 : 1),
+                                     rec[1] | rec[2] << 8);
+        seq = rec[1] | rec[2] << 8;
+        pos++;
+    }
+    TEST_ASSERT_EQUAL_UINT16(mock_uart_log.len, pos);
+}
+
+
+void test_count_is_limited(void)
+{
+    int16_t values[TELEM_MAX_CHANNELS + 2] = {0};
+    uint8_t rec[RECORD_MAX];
+    uint16_t pos = 0;
+
+    telem_send(TELEM_TYPE_LOG, 0, values, TELEM_MAX_CHANNELS + 2);
+    mock_run();
+    TEST_ASSERT_EQUAL_UINT8(RECORD_MAX, decode(&pos, rec));
+    TEST_ASSERT_EQUAL_UINT8(TELEM_TYPE_LOG, rec[0]);
+    TEST_ASSERT_EQUAL_UINT8(TELEM_MAX_CHANNELS, rec[7]);
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_record_layout_and_crc);
+    RUN_TEST(test_zero_bytes_only_as_delimiters);
+    RUN_TEST(test_dropped_record_leaves_sequence_gap);
+    RUN_TEST(test_count_is_limited);
+    return UNITY_END();
+}
@@ -0,0 +1,151 @@
+/*
+ * Host unit tests of the TWI library against the register mock.
+ * (c) 2024 MIT license
+ */
+
+// -- Includes -------------------------------------------------------
+#include <unity.h>
+#include <avr/interrupt.h>
+#include <mock_avr.h>
+#include "twi.h"
+
+
+// -- Defines --------------------------------------------------------
+#define SLAVE_ADR 0x5c
+
+
+// -- Global variables -----------------------------------------------
+static uint8_t slave_mem[16];
+
+
+// -- Function definitions -------------------------------------------
+void setUp(void)
+{
+    mock_reset();
+    for (uint8_t i = 0; i < sizeof(slave_mem); i++)
+        slave_mem[i] = 0xa0 + i;
+    mock_twi_attach(SLAVE_ADR, slave_mem, sizeof(slave_mem));
+    twi_init();
+}
+
+
+void tearDown(void)
+{
+}
+
+
+void test_init_sets_bit_rate(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(TWI_BIT_RATE_REG, TWBR);
+    TEST_ASSERT_EQUAL_UINT8(0, TWSR & 0x03);
+}
+
+
+void test_start_write_stop_statuses(void)
+{
+    twi_start();
+    TEST_ASSERT_EQUAL_HEX8(0x08, TWSR & 0xf8);
+    TEST_ASSERT_EQUAL_UINT8(0, twi_write((SLAVE_ADR<<1) | TWI_WRITE));
+    TEST_ASSERT_EQUAL_HEX8(0x18, TWSR & 0xf8);
+    TEST_ASSERT_EQUAL_UINT8(0, twi_write(0x02));
+    TEST_ASSERT_EQUAL_UINT8(0, twi_write(0x55));
+    TEST_ASSERT_EQUAL_HEX8(0x28, TWSR & 0xf8);
+    twi_stop();
+    mock_run();     // Stop is executed at the next access
+
+    TEST_ASSERT_EQUAL_UINT16(1, mock_twi_stats.starts);
+    TEST_ASSERT_EQUAL_UINT16(1, mock_twi_stats.stops);
+    TEST_ASSERT_EQUAL_UINT16(3, mock_twi_log.len);
+    TEST_ASSERT_EQUAL_HEX8(SLAVE_ADR<<1, mock_twi_log.data[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x55, slave_mem[2]);
+}
+
+
+void test_absent_address_is_nacked(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(1, twi_test_address(0x3c));
+    TEST_ASSERT_EQUAL_UINT8(0, twi_test_address(SLAVE_ADR));
+    mock_run();
+    TEST_ASSERT_EQUAL_UINT16(1, mock_twi_stats.nacks);
+    TEST_ASSERT_EQUAL_UINT16(2, mock_twi_stats.stops);
+}
+
+
+void test_read_from_memory(void)
+{
+    uint8_t buf[4] = {0};
+    const uint8_t expected[4] = {0xa4, 0xa5, 0xa6, 0xa7};
+
+    TEST_ASSERT_EQUAL_UINT8(0, twi_readfrom_mem_into(SLAVE_ADR, 4, buf, 4));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, buf, 4);
+    // Start, repeated start; last byte answered by NACK
+    TEST_ASSERT_EQUAL_UINT16(2, mock_twi_stats.starts);
+    TEST_ASSERT_EQUAL_UINT16(4, mock_twi_stats.reads);
+    TEST_ASSERT_EQUAL_HEX8(0x58, TWSR & 0xf8);
+}
+
+
+void test_read_from_absent_slave_keeps_buffer(void)
+{
+    uint8_t buf[2] = {0x11, 0x22};
+
+    TEST_ASSERT_EQUAL_UINT8(1, twi_readfrom_mem_into(0x40, 0, buf, 2));
+    TEST_ASSERT_EQUAL_HEX8(0x11, buf[0]);
+    TEST_ASSERT_EQUAL_UINT16(0, mock_twi_stats.reads);
+}
+
+
+void test_async_transfer_runs_in_interrupt(void)
+{
+    const uint8_t reg = 1;
+    uint8_t buf[3] = {0};
+    const uint8_t expected[3] = {0xa1, 0xa2, 0xa3};
+
+    sei();
+    TEST_ASSERT_EQUAL_UINT8(TWI_ASYNC_BUSY,
+                            twi_async_start(SLAVE_ADR, &reg, 1, buf, 3));
+    mock_run();
+    TEST_ASSERT_EQUAL_UINT8(TWI_ASYNC_OK, twi_async_status());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, buf, 3);
+    TEST_ASSERT_EQUAL_UINT16(1, mock_twi_stats.stops);
+}
+
+
+void test_async_nack(void)
+{
+    uint8_t buf[1];
+
+    sei();
+    twi_async_start(0x41, 0, 0, buf, 1);
+    mock_run();
+    TEST_ASSERT_EQUAL_UINT8(TWI_ASYNC_NACK, twi_async_status());
+}
+
+
+void test_async_waits_for_interrupts_enabled(void)
+{
+    uint8_t buf[1];
+
+    cli();
+    twi_async_start(SLAVE_ADR, 0, 0, buf, 1);
+    mock_run();
+    TEST_ASSERT_EQUAL_UINT8(TWI_ASYNC_BUSY, twi_async_status());
+    sei();
+    mock_run();
+    TEST_ASSERT_EQUAL_UINT8(TWI_ASYNC_OK, twi_async_status());
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_init_sets_bit_rate);
+    RUN_TEST(test_start_write_stop_statuses);
+    RUN_TEST(test_absent_address_is_nacked);
+    RUN_TEST(test_read_from_memory);
+    RUN_TEST(test_read_from_absent_slave_keeps_buffer);
+    RUN_TEST(test_async_transfer_runs_in_interrupt);
+    RUN_TEST(test_async_nack);
+    RUN_TEST(test_async_waits_for_interrupts_enabled);
+    return UNITY_END();
+}
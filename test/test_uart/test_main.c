@@ -0,0 +1,119 @@
+/*
+ * Host unit tests of the UART library against the register mock.
+ * (c) 2024 MIT license
+ */
+
+// -- Includes -------------------------------------------------------
+#include <string.h>
+#include <unity.h>
+#include <avr/interrupt.h>
+#include <mock_avr.h>
+#include "uart.h"
+
+
+// -- Function definitions -------------------------------------------
+void setUp(void)
+{
+    mock_reset();
+    uart_init(UART_BAUD_SELECT_AUTO(115200, F_CPU));
+    uart_clear_stats();
+    sei();
+}
+
+
+void tearDown(void)
+{
+}
+
+
+void test_init_sets_divisor_and_double_speed(void)
+{
+    // 16 MHz, 115200 Bd: U2X0 and UBRR0 16, error 2.1 % instead of 3.5 %
+    TEST_ASSERT_EQUAL_UINT16(16, UBRR0);
+    TEST_ASSERT_TRUE(UCSR0A & (1<<U2X0));
+    TEST_ASSERT_TRUE(UCSR0B & (1<<RXCIE0));
+    TEST_ASSERT_TRUE(UCSR0B & (1<<TXEN0));
+
+    uart_init(UART_BAUD_SELECT(9600, F_CPU));
+    TEST_ASSERT_EQUAL_UINT16(103, UBRR0);
+    TEST_ASSERT_FALSE(UCSR0A & (1<<U2X0));
+}
+
+
+void test_puts_is_sent_by_interrupt(void)
+{
+    uart_puts("hello\r\n");
+    mock_run();
+    TEST_ASSERT_EQUAL_UINT16(7, mock_uart_log.len);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY("hello\r\n", mock_uart_log.data, 7);
+    TEST_ASSERT_FALSE(UCSR0B & (1<<UDRIE0));
+    TEST_ASSERT_TRUE(uart_tx_done());
+}
+
+
+void test_puts_waits_while_interrupts_disabled(void)
+{
+    cli();
+    uart_puts("abc");
+    mock_run();
+    TEST_ASSERT_EQUAL_UINT16(0, mock_uart_log.len);
+    TEST_ASSERT_EQUAL_UINT16(UART_TX_BUFFER_SIZE - 1 - 3, uart_tx_free());
+    sei();
+    mock_run();
+    TEST_ASSERT_EQUAL_UINT16(3, mock_uart_log.len);
+    TEST_ASSERT_EQUAL_UINT16(UART_TX_BUFFER_SIZE - 1, uart_tx_free());
+}
+
+
+void test_receive_and_getc(void)
+{
+    TEST_ASSERT_EQUAL_HEX16(UART_NO_DATA, uart_getc());
+    mock_uart_receive('x');
+    mock_uart_receive('y');
+    TEST_ASSERT_EQUAL_HEX16('x', uart_getc());
+    TEST_ASSERT_EQUAL_HEX16('y', uart_getc());
+    TEST_ASSERT_EQUAL_HEX16(UART_NO_DATA, uart_getc());
+}
+
+
+void test_receive_overflow_is_counted(void)
+{
+    uart_stats_t stats;
+
+    for (uint8_t i = 0; i < UART_RX_BUFFER_SIZE + 5; i++)
+        mock_uart_receive(i);
+    uart_get_stats(&stats);
+    // One slot of the ring buffer stays free
+    TEST_ASSERT_EQUAL_UINT16(6, stats.rx_dropped);
+    TEST_ASSERT_EQUAL_UINT16(UART_RX_BUFFER_SIZE - 1, stats.rx_peak);
+    // Error flag with the first byte, 0
+    TEST_ASSERT_EQUAL_HEX16(UART_BUFFER_OVERFLOW, uart_getc());
+}
+
+
+void test_write_then_tx_peak(void)
+{
+    uart_stats_t stats;
+    const char block[20] = "0123456789abcdefghi";
+
+    cli();
+    uart_write(block, sizeof(block));
+    sei();
+    mock_run();
+    uart_get_stats(&stats);
+    TEST_ASSERT_EQUAL_UINT16(sizeof(block), stats.tx_peak);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(block, mock_uart_log.data, sizeof(block));
+}
+
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_init_sets_divisor_and_double_speed);
+    RUN_TEST(test_puts_is_sent_by_interrupt);
+    RUN_TEST(test_puts_waits_while_interrupts_disabled);
+    RUN_TEST(test_receive_and_getc);
+    RUN_TEST(test_receive_overflow_is_counted);
+    RUN_TEST(test_write_then_tx_peak);
+    return UNITY_END();
+}
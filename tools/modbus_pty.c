@@ -0,0 +1,174 @@
+/*
+ * Host test of the Modbus RTU slave, see lib/modbus/modbus.h.
+ * (c) 2024 MIT license
+ *
+ * Runs the protocol part of the firmware (lib/modbus/modbus.c) behind
+ * a Linux pseudo terminal, so any Modbus master can talk to it:
+ *   cc -O2 -Ilib/modbus -o modbus_pty tools/modbus_pty.c lib/modbus/modbus.c
+ *   ./modbus_pty [address [gap_ms]]
+ *   mbpoll -m rtu -a 1 -t 3 -r 1 -c 16 -0 -1 /dev/pts/N
+ *
+ * The device name is printed at start. A pty has no baud rate, so the
+ * end of a frame is a silence of gap_ms (default 20 ms) instead of
+ * 3.5 characters. Input registers 0 to 15 return the register number
+ * plus a counter of requests, holding registers 0 to 15 are plain
+ * memory, values of 0x8000 and above are rejected as the firmware
+ * rejects values out of range. Each frame is logged on stderr.
+ */
+
+// -- Includes -------------------------------------------------------
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/select.h>
+#include <termios.h>
+#include <unistd.h>
+#include <modbus.h>
+
+
+// -- Defines --------------------------------------------------------
+#define REG_COUNT 16
+
+
+// -- Global variables -----------------------------------------------
+static uint16_t holding[REG_COUNT];
+static uint16_t n_requests = 0;
+
+
+// -- Function definitions -------------------------------------------
+static uint8_t read_input(uint16_t reg, uint16_t *value)
+{
+    if (reg >= REG_COUNT)
+        return MODBUS_ILLEGAL_ADDRESS;
+    *value = reg + n_requests;
+    return MODBUS_OK;
+}
+
+
+static uint8_t read_holding(uint16_t reg, uint16_t *value)
+{
+    if (reg >= REG_COUNT)
+        return MODBUS_ILLEGAL_ADDRESS;
+    *value = holding[reg];
+    return MODBUS_OK;
+}
+
+
+static uint8_t write_holding(uint16_t reg, uint16_t value)
+{
+    if (reg >= REG_COUNT)
+        return MODBUS_ILLEGAL_ADDRESS;
+    if (value >= 0x8000)
+        return MODBUS_ILLEGAL_VALUE;
+    holding[reg] = value;
+    return MODBUS_OK;
+}
+
+
+static const modbus_map_t map = {read_input, read_holding, write_holding};
+
+
+/*
+ * Function: dump()
+ * Purpose:  Log one frame in hex on stderr.
+ * Input(s): tag - Direction
+ *           frame - Bytes
+ *           len - Number of bytes
+ * Returns:  none
+ */
+static void dump(const char *tag, const uint8_t *frame, int len)
+{
+    fprintf(stderr, "%s", tag);
+    for (int i = 0; i < len; i++)
+        fprintf(stderr, " %02x", frame[i]);
+    fprintf(stderr, "\n");
+}
+
+
+/*
+ * Function: open_pty()
+ * Purpose:  Create pseudo terminal in raw mode, print its slave name.
+ * Input(s): slave - Returns file descriptor of slave side, kept open
+ *           so the master does not see a hangup between clients
+ * Returns:  File descriptor of master side, -1 on error
+ */
+static int open_pty(int *slave)
+{
+    struct termios tio;
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+        perror("posix_openpt");
+        return -1;
+    }
+    *slave = open(ptsname(fd), O_RDWR | O_NOCTTY);
+    if (*slave < 0) {
+        perror(ptsname(fd));
+        return -1;
+    }
+    tcgetattr(*slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(*slave, TCSANOW, &tio);
+    printf("%s\n", ptsname(fd));
+    fflush(stdout);
+    return fd;
+}
+
+
+int main(int argc, char *argv[])
+{
+    uint8_t address = argc > 1 ? atoi(argv[1]) : 1;
+    int gap_ms = argc > 2 ? atoi(argv[2]) : 20;
+    uint8_t frame[MODBUS_FRAME_MAX];
+    int fd, slave, len = 0, overlong = 0;
+
+    if (address < 1 || address > 247 || gap_ms < 1) {
+        fprintf(stderr, "usage: %s [address [gap_ms]]\n", argv[0]);
+        return 1;
+    }
+    fd = open_pty(&slave);
+    if (fd < 0)
+        return 1;
+
+    while (1) {
+        struct timeval tv = {0, gap_ms * 1000L};
+        fd_set rd;
+        uint8_t c;
+        int n;
+
+        FD_ZERO(&rd);
+        FD_SET(fd, &rd);
+        // Wait for the first byte without limit, then for the gap
+        n = select(fd + 1, &rd, NULL, NULL, len || overlong ? &tv : NULL);
+        if (n < 0) {
+            perror("select");
+            return 1;
+        }
+        if (n > 0) {
+            if (read(fd, &c, 1) != 1)
+                return 1;
+            if (len < MODBUS_FRAME_MAX)
+                frame[len++] = c;
+            else
+                overlong = 1;
+            continue;
+        }
+
+        // Silence: end of frame
+        dump(overlong ? "rx (too long)" : "rx", frame, len);
+        if (!overlong) {
+            n = modbus_process(address, &map, frame, len);
+            if (n > 0) {
+                n_requests++;
+                dump("tx", frame, n);
+                if (write(fd, frame, n) != n)
+                    return 1;
+            }
+        }
+        len = 0;
+        overlong = 0;
+    }
+}
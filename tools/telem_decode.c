@@ -0,0 +1,277 @@
+/*
+ * Host decoder of binary telemetry frames, see lib/telem/telem.h.
+ * (c) 2024 MIT license
+ *
+ * Build and run (serial port in raw mode, 38400 Bd):
+ *   cc -O2 -Iinclude -o telem_decode tools/telem_decode.c
+ *   stty -F /dev/ttyACM0 38400 raw -echo
+ *   ./telem_decode < /dev/ttyACM0 > values.csv
+ *
+ * Each valid record is printed to stdout as one CSV line: type,
+ * sequence, time in ms and values. Text lines sent between frames,
+ * lost records (gaps in sequence) and damaged frames are reported on
+ * stderr; totals are printed at end of input.
+ *
+ * Records of the deferred log (lib/dlog/dlog.h) are printed on stderr
+ * as text, with format strings of include/dlog_messages.def compiled
+ * in; rebuild the decoder when the messages change.
+ */
+
+// -- Includes -------------------------------------------------------
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+
+// -- Defines --------------------------------------------------------
+#define TELEM_HEADER 8
+#define TELEM_MAX_CHANNELS 8
+#define RECORD_MAX (TELEM_HEADER + 2*TELEM_MAX_CHANNELS + 2)
+#define FRAME_MAX 512  // Longer input without delimiter is dropped
+#define TELEM_TYPE_LOG 2
+#define LOG_VALUES 4   // Identifier, time and two arguments
+
+
+// -- Global variables -----------------------------------------------
+static unsigned long n_frames = 0;
+static unsigned long n_lost = 0;
+static unsigned long n_bad = 0;
+static int have_seq = 0;
+static uint16_t last_seq;
+
+// Format strings of log messages, indexed by identifier
+static const char *const log_formats[] = {
+    "%u records dropped",
+#define DLOG_MSG(name, format) format,
+#include "dlog_messages.def"
+#undef DLOG_MSG
+};
+#define LOG_MESSAGES (sizeof(log_formats) / sizeof(log_formats[0]))
+
+
+// -- Function definitions -------------------------------------------
+/*
+ * Function: crc16()
+ * Purpose:  CRC-16/MODBUS of a block, same as _crc16_update() of avr-libc.
+ * Input(s): data - Bytes
+ *           len - Number of bytes
+ * Returns:  CRC
+ */
+static uint16_t crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xffff;
+
+    while (len--) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xa001 : crc >> 1;
+    }
+    return crc;
+}
+
+
+/*
+ * Function: cobs_decode()
+ * Purpose:  Decode one COBS frame without delimiters.
+ * Input(s): in - Encoded bytes
+ *           len - Number of encoded bytes
+ *           out - Buffer for record
+ *           size - Size of buffer
+ * Returns:  Length of record, -1 if the frame is malformed
+ */
+static int cobs_decode(const uint8_t *in, size_t len, uint8_t *out,
+                       size_t size)
+{
+    size_t n = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        uint8_t code = in[i++];
+
+        if (code == 0 || i + code - 1 > len)
+            return -1;
+        for (uint8_t k = 1; k < code; k++) {
+            if (n == size)
+                return -1;
+            out[n++] = in[i++];
+        }
+        // Implied zero, except after full block and at end of frame
+        if (code != 0xff && i < len) {
+            if (n == size)
+                return -1;
+            out[n++] = 0;
+        }
+    }
+    return (int)n;
+}
+
+
+/*
+ * Function: is_text()
+ * Purpose:  Test if bytes between delimiters are printable text.
+ * Input(s): data - Bytes
+ *           len - Number of bytes
+ * Returns:  1 for text, 0 otherwise
+ */
+static int is_text(const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if ((data[i] < 0x20 || data[i] > 0x7e) &&
+            data[i] != '\r' && data[i] != '\n' && data[i] != '\t')
+            return 0;
+    }
+    return 1;
+}
+
+
+/*
+ * Function: print_log()
+ * Purpose:  Print one log record on stderr. Conversions %d and %i take
+ *           an argument as signed, the others as unsigned 16-bit value.
+ * Input(s): frame_time - Time of frame in ms
+ *           v - Identifier, low 16 bits of time and two arguments
+ * Returns:  none
+ */
+static void print_log(uint32_t frame_time, const uint16_t *v)
+{
+    // Record is older than its frame by less than 65.5 s
+    uint32_t time = frame_time - (uint16_t)(frame_time - v[1]);
+    const char *fmt;
+    char spec[16];
+    int arg = 0;
+
+    fprintf(stderr, "# %lu ", (unsigned long)time);
+    if (v[0] >= LOG_MESSAGES) {
+        fprintf(stderr, "unknown message %u (%u, %u)\n", v[0], v[2], v[3]);
+        return;
+    }
+
+    fmt = log_formats[v[0]];
+    while (*fmt) {
+        size_t n;
+
+        if (*fmt != '%') {
+            fputc(*fmt++, stderr);
+            continue;
+        }
+        // Flags, width and precision up to the conversion character
+        n = 1 + strspn(fmt + 1, "#0- +.123456789");
+        if (fmt[n] == '\0' || n + 2 > sizeof(spec))
+            break;
+        memcpy(spec, fmt, n + 1);
+        spec[n + 1] = '\0';
+        if (fmt[n] == '%')
+            fputc('%', stderr);
+        else if (arg == 2)
+            fputs("?", stderr);
+        else if (fmt[n] == 'd' || fmt[n] == 'i')
+            fprintf(stderr, spec, (int)(int16_t)v[2 + arg++]);
+        else
+            fprintf(stderr, spec, (unsigned)v[2 + arg++]);
+        fmt += n + 1;
+    }
+    fputc('\n', stderr);
+}
+
+
+/*
+ * Function: handle_frame()
+ * Purpose:  Check and print one frame, or pass text through to stderr.
+ * Input(s): frame - Bytes between two delimiters
+ *           len - Number of bytes
+ * Returns:  none
+ */
+static void handle_frame(const uint8_t *frame, size_t len)
+{
+    uint8_t rec[RECORD_MAX];
+    int n = cobs_decode(frame, len, rec, sizeof(rec));
+    uint16_t seq;
+    uint32_t time;
+    uint8_t count;
+
+    if (n < TELEM_HEADER + 2 ||
+        crc16(rec, n - 2) != (rec[n - 2] | rec[n - 1] << 8)) {
+        if (is_text(frame, len))
+            fwrite(frame, 1, len, stderr);
+        else {
+            n_bad++;
+            fprintf(stderr, "# bad frame, %zu bytes\n", len);
+        }
+        return;
+    }
+
+    count = rec[7];
+    if (count > TELEM_MAX_CHANNELS || n != TELEM_HEADER + 2*count + 2) {
+        n_bad++;
+        fprintf(stderr, "# bad length, %d bytes, %u values\n", n, count);
+        return;
+    }
+
+    seq = rec[1] | rec[2] << 8;
+    time = rec[3] | rec[4] << 8 | (uint32_t)rec[5] << 16 |
+           (uint32_t)rec[6] << 24;
+    if (have_seq && (uint16_t)(seq - last_seq) != 1) {
+        uint16_t gap = seq - last_seq - 1;
+
+        n_lost += gap;
+        fprintf(stderr, "# lost %u before %u\n", gap, seq);
+    }
+    have_seq = 1;
+    last_seq = seq;
+    n_frames++;
+
+    if (rec[0] == TELEM_TYPE_LOG) {
+        for (uint8_t i = 0; i + LOG_VALUES <= count; i += LOG_VALUES) {
+            uint16_t v[LOG_VALUES];
+
+            for (uint8_t k = 0; k < LOG_VALUES; k++)
+                v[k] = rec[8 + 2*(i + k)] | rec[9 + 2*(i + k)] << 8;
+            print_log(time, v);
+        }
+        return;
+    }
+
+    printf("%u,%u,%lu", rec[0], seq, (unsigned long)time);
+    for (uint8_t i = 0; i < count; i++)
+        printf(",%d", (int16_t)(rec[8 + 2*i] | rec[9 + 2*i] << 8));
+    printf("\n");
+    fflush(stdout);
+}
+
+
+int main(int argc, char *argv[])
+{
+    static uint8_t frame[FRAME_MAX];
+    FILE *in = stdin;
+    size_t len = 0;
+    int overflow = 0;
+    int c;
+
+    if (argc > 1 && (in = fopen(argv[1], "rb")) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    while ((c = fgetc(in)) != EOF) {
+        if (c != 0) {
+            if (len < FRAME_MAX)
+                frame[len++] = c;
+            else
+                overflow = 1;
+            continue;
+        }
+        // Delimiter; two in a row (end and start of frames) are empty
+        if (overflow) {
+            n_bad++;
+            fprintf(stderr, "# frame longer than %d bytes\n", FRAME_MAX);
+        }
+        else if (len > 0)
+            handle_frame(frame, len);
+        len = 0;
+        overflow = 0;
+    }
+
+    fprintf(stderr, "# %lu records, %lu lost, %lu bad frames\n",
+            n_frames, n_lost, n_bad);
+    return 0;
+}